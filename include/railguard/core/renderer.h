@@ -45,9 +45,6 @@ typedef struct rg_material rg_material;
 /** Abstract representation of a model that can be instantiated in the world. */
 typedef struct rg_model rg_model;
 
-/** Instance of a model */
-typedef struct rg_render_node rg_render_node;
-
 /**
  * The renderer is an opaque struct that contains all of the data used for rendering.
  * It exact contents depend on the used graphics API, which is why it is opaque an only handled with pointers.
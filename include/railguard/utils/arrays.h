@@ -1,9 +1,28 @@
 #pragma once
 
 #include <railguard/core/window.h>
+#include <railguard/utils/memory.h>
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+
+// --=== Constants ===--
+
+/** Number of elements in each page of a paged pool. Each page has a 64-bit occupancy mask. */
+#define RG_PAGED_POOL_PAGE_CAPACITY 64
+
+/** Factor by which the capacity of a vector is multiplied when it is full, if no other factor is set. */
+#define RG_VECTOR_DEFAULT_GROWTH_FACTOR 2.0f
+/** Bounds of the growth factor of a vector. */
+#define RG_VECTOR_MIN_GROWTH_FACTOR 1.125f
+#define RG_VECTOR_MAX_GROWTH_FACTOR 4.0f
+
+/** Number of low bits of a slot table id that hold the index of its slot. The high bits hold the generation of the slot. */
+#define RG_SLOT_TABLE_INDEX_BITS 24
+#define RG_SLOT_TABLE_INDEX_MASK ((1u << RG_SLOT_TABLE_INDEX_BITS) - 1)
+/** Id that never matches a slot. */
+#define RG_SLOT_TABLE_NULL_ID 0
 
 // --=== Types ===--
 
@@ -22,6 +41,10 @@ typedef struct rg_array
      * type of a single element.
      */
     void *data;
+    /** @brief Allocator of the data. If NULL, the global heap is used. */
+    const rg_allocator *allocator;
+    /** @brief Alignment of the data if it was created with rg_create_array_aligned, 0 otherwise. */
+    size_t alignment;
 } rg_array;
 
 /**
@@ -45,11 +68,25 @@ typedef struct rg_vector
      */
     void *data;
     /**
-     * Value defining by how much the vector should grow if a push doesn't have enough space.
+     * @brief Factor by which the capacity is multiplied when a push or an extension doesn't have enough space, so that n pushes only
+     * cost O(log n) reallocations. If 0, RG_VECTOR_DEFAULT_GROWTH_FACTOR is used. Set it with rg_vector_set_growth_factor.
      */
-    size_t growth_amount;
+    float growth_factor;
+    /** @brief Allocator of the data. If NULL, the global heap is used. */
+    const rg_allocator *allocator;
+    /** @brief Number of reallocations of the data since the vector was created, used to measure the growth policy. */
+    size_t realloc_count;
+    /** @brief Alignment kept by the data across reallocations if it was created with rg_create_vector_aligned, 0 otherwise. */
+    size_t alignment;
 } rg_vector;
 
+/**
+ * Function called for each move of a compaction.
+ * @param from place of the moved element.
+ * @param to place of the hole where it must be moved.
+ */
+typedef void (*rg_compaction_move_function)(size_t from, size_t to, void *user_data);
+
 typedef struct rg_vector_it
 {
     rg_vector *vector;
@@ -57,6 +94,104 @@ typedef struct rg_vector_it
     void      *value;
 } rg_vector_it;
 
+/**
+ * Vector whose first elements are stored inline, right after it in the struct that owns it, and that only allocates when it
+ * overflows. It is meant for the short lists of ids held by many objects, which would otherwise each need a tiny allocation.\n
+ * It must be declared with RG_SMALL_VECTOR, which reserves the inline elements, and used through its vector field.\n
+ * Since the data pointer is not stored while the elements are inline, the owner can be moved or copied with memcpy (but only one
+ * of the copies can be used and destroyed afterwards, since they share the heap allocation if there is one).
+ */
+typedef struct rg_small_vector
+{
+    /** @brief Number of elements in the vector. */
+    uint32_t count;
+    /** @brief Maximum number of elements that fit without reallocating. Equal to inline_capacity while the elements are inline. */
+    uint32_t capacity;
+    /** @brief Size of a single element. */
+    uint32_t element_size;
+    /** @brief Number of elements that fit in the inline storage that follows the vector. */
+    uint32_t inline_capacity;
+    /** @brief Elements on the heap once the inline storage has overflowed, NULL before that. */
+    void *heap_data;
+    /** @brief Allocator of the heap storage. If NULL, the global heap is used. */
+    const rg_allocator *allocator;
+} rg_small_vector;
+
+/**
+ * Declares a small vector type with the given number of inline elements.
+ * The elements can't be more aligned than the vector, so that they start right after it.
+ * @example RG_SMALL_VECTOR(rg_model_id, 4) models; RG_SMALL_VECTOR_CREATE(models); rg_small_vector_push_back(&models.vector, &id);
+ */
+#define RG_SMALL_VECTOR(element_type, inline_capacity)                                                                \
+    struct                                                                                                            \
+    {                                                                                                                 \
+        rg_small_vector vector;                                                                                       \
+        element_type    inline_elements[inline_capacity];                                                             \
+        _Static_assert(_Alignof(element_type) <= _Alignof(rg_small_vector), "Small vector elements are too aligned"); \
+    }
+
+/** Initializes a small vector declared with RG_SMALL_VECTOR, with the element size and inline capacity of its declaration. */
+#define RG_SMALL_VECTOR_CREATE(small_vector)                                                                   \
+    rg_create_small_vector(sizeof((small_vector).inline_elements[0]),                                          \
+                           sizeof((small_vector).inline_elements) / sizeof((small_vector).inline_elements[0]), \
+                           &(small_vector).vector)
+
+/** Initializes a small vector declared with RG_SMALL_VECTOR, whose heap storage will be allocated with the given allocator. */
+#define RG_SMALL_VECTOR_CREATE_WITH_ALLOCATOR(small_vector, allocator)                                                        \
+    rg_create_small_vector_with_allocator(sizeof((small_vector).inline_elements[0]),                                          \
+                                          sizeof((small_vector).inline_elements) / sizeof((small_vector).inline_elements[0]), \
+                                          (allocator),                                                                        \
+                                          &(small_vector).vector)
+
+typedef struct rg_small_vector_it
+{
+    rg_small_vector *vector;
+    size_t           index;
+    void            *value;
+} rg_small_vector_it;
+
+/**
+ * Pool of elements stored in fixed-size pages that are never moved, so that the address of an element stays valid until it is
+ * released. Each element is identified by an index, which is reused when the element is released.
+ */
+typedef struct rg_paged_pool
+{
+    /** @brief Number of used elements. */
+    size_t count;
+    /** @brief Distance in bytes between two elements of a page, which includes the alignment padding. */
+    size_t element_stride;
+    /** @brief Pointers to the pages. Each page starts with its occupancy mask, followed by its elements. */
+    rg_vector pages;
+    /** @brief Index of the first page that may have a free element. The pages before it are full. */
+    size_t first_free_page;
+    /** @brief Alignment of the pages if it is bigger than the fundamental one, in which case they are allocated on the heap, or 0. */
+    size_t alignment;
+} rg_paged_pool;
+
+typedef struct rg_slot
+{
+    /** @brief If the slot is used, value given by the owner of the table. Otherwise, index of the next free slot. */
+    uint32_t value;
+    /**
+     * @brief Incremented when the slot is acquired and when it is released, so it is odd exactly when the slot is used.
+     * That way, an id never matches a free slot, even after the generation wraps, and the null id never matches any slot.
+     */
+    uint32_t generation;
+} rg_slot;
+
+/**
+ * Array of generation-checked slots, which gives stable 32-bit ids to elements stored elsewhere, for example in packed arrays.
+ * An id holds the index of its slot in its low RG_SLOT_TABLE_INDEX_BITS bits, and the generation of the slot in its high bits.
+ * Finding an id is a direct indexing followed by a generation check. The released slots are reused first, but with a new generation,
+ * so that their old ids don't match them anymore until the generation wraps. There can be at most 2^24 slots.
+ */
+typedef struct rg_slot_table
+{
+    rg_vector slots;
+    /** @brief Head of the list of free slots, which are linked by their values. */
+    uint32_t first_free_slot;
+} rg_slot_table;
+
 // --=== Arrays ===--
 
 /**
@@ -75,6 +210,22 @@ rg_array rg_create_array(size_t size, size_t element_size);
  * @return The array struct
  */
 rg_array rg_create_array_zeroed(size_t size, size_t element_size);
+/**
+ * @brief Creates an array whose data is allocated with the given allocator, and set each byte to zero.
+ * @param allocator Allocator of the data. If NULL, the global heap is used.
+ */
+rg_array rg_create_array_zeroed_with_allocator(size_t size, size_t element_size, const rg_allocator *allocator);
+/**
+ * @brief Creates an array whose data is allocated with the given allocator, but do NOT set each element to zero.
+ * @param allocator Allocator of the data. If NULL, the global heap is used.
+ */
+rg_array rg_create_array_with_allocator(size_t size, size_t element_size, const rg_allocator *allocator);
+/**
+ * @brief Creates an array whose data starts at a multiple of the given alignment, but do NOT set each element to zero.
+ * It can be used for aligned SIMD loads, or to give each thread its own cache lines.
+ * @param alignment Power of 2, for example RG_CACHE_LINE_SIZE.
+ */
+rg_array rg_create_array_aligned(size_t size, size_t element_size, size_t alignment);
 void     rg_destroy_array(rg_array *p_array);
 
 // --=== Vectors ===---
@@ -86,18 +237,44 @@ void     rg_destroy_array(rg_array *p_array);
  * @param p_dest_vector is a pointer to the vector that will be allocated. It must be an unallocated vector.
  */
 bool rg_create_vector(size_t initial_capacity, size_t element_size, rg_vector *p_dest_vector);
+/**
+ * Allocates the given unallocated vector with an allocator, which is also used by all of its reallocations.
+ * @param allocator Allocator of the data. If NULL, the global heap is used.
+ */
+bool rg_create_vector_with_allocator(size_t              initial_capacity,
+                                     size_t              element_size,
+                                     const rg_allocator *allocator,
+                                     rg_vector          *p_dest_vector);
+/**
+ * Allocates the given unallocated vector so that its data starts at a multiple of the given alignment, even after reallocations.
+ * @param alignment Power of 2, for example RG_CACHE_LINE_SIZE.
+ * @return false if the allocation failed or if the alignment is not a power of 2.
+ */
+bool rg_create_vector_aligned(size_t initial_capacity, size_t element_size, size_t alignment, rg_vector *p_dest_vector);
 /**
  * Cleans up the given p_vector. It will become unallocated and unusable without a new call to rg_create_vector.
  * @param p_vector is the p_vector that will be deleted.
  */
 void rg_destroy_vector(rg_vector *p_vector);
 /**
- * Ensures that the p_vector has enough allocated memory for the given capacity. Resizes it if necessary.
+ * Ensures that the p_vector has enough allocated memory for the given capacity. If it doesn't, the capacity is multiplied by the
+ * growth factor, or set to the required capacity if that is not enough.
  * @param p_vector is a pointer to the p_vector that is acted on.
- * @param required_minimum_capacity is the number of bytes that must be able to fit in the p_vector after the function call.
- * @warning If the p_vector is not allocated (capacity == 0 or data == NULL), rg_create_vector should be called instead.
+ * @param required_minimum_capacity is the number of elements that must be able to fit in the p_vector after the function call.
+ * @return false if the reallocation failed. In that case, the vector is unchanged.
+ */
+bool rg_vector_ensure_capacity(rg_vector *p_vector, size_t required_minimum_capacity);
+/**
+ * Reallocates the vector so that it can hold exactly the given number of elements, if it can't already. Contrary to
+ * rg_vector_ensure_capacity, the growth factor is not applied, so it should be used when the final count is known in advance.
+ * @return false if the reallocation failed. In that case, the vector is unchanged.
  */
-void rg_vector_ensure_capacity(rg_vector *p_vector, size_t required_minimum_capacity);
+bool rg_vector_reserve(rg_vector *p_vector, size_t capacity);
+/**
+ * Sets the factor by which the capacity is multiplied when the vector is full. It is clamped between RG_VECTOR_MIN_GROWTH_FACTOR and
+ * RG_VECTOR_MAX_GROWTH_FACTOR. A smaller factor wastes less memory, a bigger one reallocates less often.
+ */
+void rg_vector_set_growth_factor(rg_vector *p_vector, float growth_factor);
 /**
  * Pushes a new p_data at the end of the p_vector. Resizes it if necessary.
  * @param p_vector is a pointer to the p_vector that is acted on.
@@ -160,8 +337,246 @@ bool rg_vector_copy(rg_vector *p_vector, size_t srcPos, size_t dstPos);
  * @param p_vector The vector to clear
  */
 void rg_vector_clear(rg_vector *p_vector);
+/**
+ * Reallocates the vector so that its capacity matches its count, to release the memory that is not used anymore.
+ * @param p_vector The vector to shrink
+ * @return false if the reallocation failed. In that case, the vector is unchanged.
+ */
+bool rg_vector_shrink_to_fit(rg_vector *p_vector);
 
 rg_vector_it rg_vector_iterator(rg_vector *p_vector);
 bool         rg_vector_next(rg_vector_it *it);
 
-void *rg_vector_extend(rg_vector *vector, void* data, size_t count);
\ No newline at end of file
+void *rg_vector_extend(rg_vector *vector, void* data, size_t count);
+/**
+ * Inserts count elements at the given position, after moving the following elements with a single memmove.
+ * @param pos position of the first inserted element, at most the count of the vector.
+ * @param data elements to copy in the vector. If NULL, the inserted elements are left uninitialized.
+ * @return a pointer to the first inserted element, or NULL if the position is out of bounds or the reallocation failed.
+ */
+void *rg_vector_insert_range(rg_vector *p_vector, size_t pos, const void *data, size_t count);
+/**
+ * Removes count elements starting at the given position, and moves the following ones back with a single memmove.
+ * The order of the remaining elements is kept.
+ * @return false if the range is out of bounds. In that case, the vector is unchanged.
+ */
+bool rg_vector_erase_range(rg_vector *p_vector, size_t pos, size_t count);
+/**
+ * Copies count elements starting at srcPos to the elements starting at dstPos. The ranges may overlap.
+ * @return false if one of the ranges is out of bounds.
+ */
+bool rg_vector_copy_range(rg_vector *p_vector, size_t srcPos, size_t dstPos, size_t count);
+/**
+ * Removes an element in constant time, by moving the last element in its place. The order of the elements is not kept.
+ * @return false if the position is out of bounds.
+ */
+bool rg_vector_swap_remove(rg_vector *p_vector, size_t pos);
+/**
+ * Finds the first element whose bytes are equal to the given value. Vectors of 32-bit elements are searched with SIMD when it is
+ * available.
+ * @return the index of the element, or SIZE_MAX if there is none.
+ */
+size_t rg_vector_find(const rg_vector *p_vector, const void *p_value);
+/**
+ * Changes the number of elements of the vector. The new elements are set to zero.
+ * @return false if the reallocation failed. In that case, the vector is unchanged.
+ */
+bool rg_vector_resize(rg_vector *p_vector, size_t new_count);
+
+// --=== Small vectors ===--
+
+/**
+ * Initializes an empty small vector, which uses its inline storage. It doesn't allocate anything.
+ * @see RG_SMALL_VECTOR_CREATE, which gets the parameters from the declaration of the vector.
+ * @param inline_capacity number of elements of the inline storage that follows the vector.
+ */
+void rg_create_small_vector(size_t element_size, size_t inline_capacity, rg_small_vector *p_dest_vector);
+/**
+ * Initializes an empty small vector whose heap storage, if it overflows, will be allocated with the given allocator.
+ * @see RG_SMALL_VECTOR_CREATE_WITH_ALLOCATOR
+ * @param allocator Allocator of the heap storage. If NULL, the global heap is used. It must outlive the vector.
+ */
+void rg_create_small_vector_with_allocator(size_t              element_size,
+                                           size_t              inline_capacity,
+                                           const rg_allocator *allocator,
+                                           rg_small_vector    *p_dest_vector);
+/**
+ * Frees the heap storage of the vector if it overflowed, and empties it. It can be used again afterwards.
+ */
+void rg_destroy_small_vector(rg_small_vector *p_vector);
+/**
+ * @return a pointer to the first element, which is in the inline storage or on the heap. It is invalidated by the next push.
+ */
+void *rg_small_vector_data(rg_small_vector *p_vector);
+/**
+ * Pushes a copy of the data at the end of the vector. It is moved to the heap if the inline storage is full.
+ * @returns a pointer to the new element if it worked, NULL otherwise.
+ */
+void *rg_small_vector_push_back(rg_small_vector *p_vector, const void *p_data);
+/**
+ * Pushes a new uninitialized element at the end of the vector.
+ * @returns a pointer to the new element if it worked, NULL otherwise.
+ */
+void *rg_small_vector_push_back_no_data(rg_small_vector *p_vector);
+void  rg_small_vector_pop_back(rg_small_vector *p_vector);
+/**
+ * @return a pointer to the element at the given position, or NULL if it is out of bounds.
+ */
+void *rg_small_vector_get_element(rg_small_vector *p_vector, size_t pos);
+/**
+ * Copies the element at srcPos in the element at dstPos.
+ * @return true if it worked, false otherwise
+ */
+bool rg_small_vector_copy(rg_small_vector *p_vector, size_t srcPos, size_t dstPos);
+/**
+ * Removes an element in constant time, by moving the last element in its place.
+ * @return false if the position is out of bounds.
+ */
+bool rg_small_vector_swap_remove(rg_small_vector *p_vector, size_t pos);
+/**
+ * @return the index of the first element whose bytes are equal to the given value, or SIZE_MAX if there is none.
+ * @see rg_vector_find
+ */
+size_t rg_small_vector_find(rg_small_vector *p_vector, const void *p_value);
+/**
+ * Empties the vector without freeing its heap storage.
+ */
+void rg_small_vector_clear(rg_small_vector *p_vector);
+/**
+ * Appends count elements copied from data at the end of the vector.
+ * @return a pointer to the first added element, or NULL if an allocation failed.
+ */
+void *rg_small_vector_extend(rg_small_vector *p_vector, const void *data, size_t count);
+
+rg_small_vector_it rg_small_vector_iterator(rg_small_vector *p_vector);
+bool               rg_small_vector_next(rg_small_vector_it *it);
+
+// --=== Compaction ===--
+
+/**
+ * Plans the removal of several elements from packed arrays, by moving the last remaining elements in the holes below the new count.
+ * Each element moves at most once, and the holes are filled in order. The caller does the moves, and can then truncate its arrays.
+ * @param count number of elements in the arrays.
+ * @param places array of the erased_count places to remove, all different and lower than count. It is reordered.
+ * @param pfn_move called for each move that must be done.
+ * @param allocator allocator of the temporary bitmap used for the large erasures, usually the one of the container. If NULL, the
+ * global heap is used.
+ * @return the new count of the arrays.
+ */
+size_t rg_compact_places(size_t                      count,
+                         size_t                     *places,
+                         size_t                      erased_count,
+                         rg_compaction_move_function pfn_move,
+                         void                       *user_data,
+                         const rg_allocator         *allocator);
+
+// --=== Paged pools ===--
+
+/**
+ * Allocates the given unallocated paged pool. No page is allocated until the first acquisition.
+ * @param element_alignment power of 2, for example RG_CACHE_LINE_SIZE. If 0, the elements are packed without padding.
+ * @return false if an allocation failed or if the alignment is not a power of 2.
+ */
+bool rg_create_paged_pool(size_t element_size, size_t element_alignment, rg_paged_pool *p_dest_pool);
+/**
+ * Allocates the given unallocated paged pool, whose pages will be allocated with the given allocator.
+ * @param allocator Allocator of the pages. If NULL, the global heap is used. The allocators only guarantee the fundamental alignment,
+ * so an element_alignment bigger than alignof(max_align_t) is only supported with the global heap.
+ */
+bool rg_create_paged_pool_with_allocator(size_t              element_size,
+                                         size_t              element_alignment,
+                                         const rg_allocator *allocator,
+                                         rg_paged_pool      *p_dest_pool);
+void rg_destroy_paged_pool(rg_paged_pool *p_pool);
+/**
+ * Finds a free element, allocating a new page if all of them are full, and marks it as used. The lowest free indices are used first.
+ * @param p_index receives the index of the element.
+ * @return a pointer to the uninitialized element, or NULL if an allocation failed.
+ */
+void *rg_paged_pool_acquire(rg_paged_pool *p_pool, size_t *p_index);
+/**
+ * Marks the element as free, so that its index and memory can be reused by the next acquisition.
+ */
+void rg_paged_pool_release(rg_paged_pool *p_pool, size_t index);
+/**
+ * @return a pointer to the element at the given index. The index must have been acquired and not released since.
+ */
+void *rg_paged_pool_get(rg_paged_pool *p_pool, size_t index);
+/**
+ * Finds the first used element whose index is at least *p_index. The iteration skips full pages of free elements at once.
+ * @param p_index index where the search starts, which receives the index of the found element.
+ * @return a pointer to the found element, or NULL if there is none.
+ */
+void *rg_paged_pool_next(rg_paged_pool *p_pool, size_t *p_index);
+/**
+ * Allocates enough pages to hold the given number of elements without allocating anything else.
+ * @return false if an allocation failed.
+ */
+bool rg_paged_pool_reserve(rg_paged_pool *p_pool, size_t count);
+/**
+ * Releases the empty pages at the end of the pool. The other pages can't be released, since their elements may still be pointed to.
+ * @return false if an allocation failed.
+ */
+bool rg_paged_pool_shrink_to_fit(rg_paged_pool *p_pool);
+
+// --=== Slot tables ===--
+
+/**
+ * Allocates the given unallocated slot table, without any slot.
+ * @param allocator Allocator of the slots. If NULL, the global heap is used.
+ */
+bool rg_create_slot_table(const rg_allocator *allocator, rg_slot_table *p_dest_table);
+void rg_destroy_slot_table(rg_slot_table *p_table);
+/**
+ * Makes sure that there is a free slot, creating one if needed, and returns the id that the next acquisition will give.
+ * This lets the owner prepare its element with the final id, and only acquire the slot once nothing can fail anymore.
+ * @return RG_SLOT_TABLE_NULL_ID if the table is full or if an allocation failed.
+ */
+uint32_t rg_slot_table_prepare(rg_slot_table *p_table);
+/**
+ * Takes a free slot and stores the value in it. It can't fail if rg_slot_table_prepare succeeded since the last acquisition.
+ * @return the id of the slot, or RG_SLOT_TABLE_NULL_ID if the table is full or if an allocation failed.
+ */
+uint32_t rg_slot_table_acquire(rg_slot_table *p_table, uint32_t value);
+/**
+ * Frees the slot of an id that exists, so that it doesn't match any id until it is acquired again.
+ */
+void rg_slot_table_release(rg_slot_table *p_table, uint32_t id);
+
+static inline uint32_t rg_slot_table_index(uint32_t id)
+{
+    return id & RG_SLOT_TABLE_INDEX_MASK;
+}
+
+/**
+ * @return the value of the slot of the id, or UINT32_MAX if the id doesn't exist (anymore).
+ */
+static inline uint32_t rg_slot_table_find(const rg_slot_table *p_table, uint32_t id)
+{
+    uint32_t slot_index = rg_slot_table_index(id);
+    if (slot_index >= p_table->slots.count)
+    {
+        return UINT32_MAX;
+    }
+
+    rg_slot slot = ((const rg_slot *) p_table->slots.data)[slot_index];
+    return (slot.generation & 1) != 0 && slot.generation == id >> RG_SLOT_TABLE_INDEX_BITS ? slot.value : UINT32_MAX;
+}
+
+/**
+ * @return the id of the slot at the given index if it is used, or RG_SLOT_TABLE_NULL_ID if it is free. It allows to iterate on the
+ * used slots.
+ */
+static inline uint32_t rg_slot_table_id(const rg_slot_table *p_table, uint32_t slot_index)
+{
+    uint32_t generation = ((const rg_slot *) p_table->slots.data)[slot_index].generation;
+    return (generation & 1) != 0 ? (generation << RG_SLOT_TABLE_INDEX_BITS) | slot_index : RG_SLOT_TABLE_NULL_ID;
+}
+
+/**
+ * Changes the value of the slot of an id that exists, for example when its element was moved.
+ */
+static inline void rg_slot_table_set_value(rg_slot_table *p_table, uint32_t id, uint32_t value)
+{
+    ((rg_slot *) p_table->slots.data)[rg_slot_table_index(id)].value = value;
+}
\ No newline at end of file
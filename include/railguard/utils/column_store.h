@@ -0,0 +1,95 @@
+#pragma once
+
+#include <railguard/utils/memory.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// --=== Constants ===--
+
+#define RG_COLUMN_STORE_NULL_ID 0
+
+// --=== Types ===--
+
+/**
+ * A column store holds rows of several components, but stores each component in its own packed array (a column) instead of
+ * interleaving them in a single struct. That way, a pass that only reads one component, like culling on the bounds, only loads the
+ * bytes of that component, and can process it with SIMD.\n
+ * • The row of an element is found from its id with a direct indexing in an array of slots, followed by a generation check\n
+ * • The columns are always packed: an erasure moves the last row in the hole, in every column at once\n
+ * • The ids come from a rg_slot_table like the ids of the slot map storages, so there can be at most 2^24 rows at the same time
+ */
+typedef struct rg_column_store rg_column_store;
+
+typedef uint32_t rg_column_store_id;
+
+typedef struct rg_column_store_it
+{
+    rg_column_store   *store;
+    size_t             column;
+    size_t             next_row;
+    rg_column_store_id id;
+    void              *value;
+} rg_column_store_it;
+
+// --=== Functions ===--
+
+/**
+ * Creates a new column store.
+ * @param column_count number of columns of each row.
+ * @param column_sizes array of column_count sizes, where the size of the elements of each column is given.
+ * @return The new column store, or NULL if there was an error.
+ */
+rg_column_store *rg_create_column_store(size_t column_count, const size_t *column_sizes);
+/**
+ * Creates a new column store whose memory is allocated with the given allocator.
+ * @param allocator The allocator of the store. If NULL, the global heap is used. It must outlive the store.
+ * @return The new column store, or NULL if there was an error.
+ */
+rg_column_store *rg_create_column_store_with_allocator(size_t column_count, const size_t *column_sizes, const rg_allocator *allocator);
+void             rg_destroy_column_store(rg_column_store **p_store);
+
+/**
+ * Adds a new row to the store and generates a new id for it.
+ * @param values array of one pointer per column, to the data that will be copied in that column. If the array or one of its pointers
+ * is NULL, the corresponding elements are zeroed.
+ * @return the id of the new row, or RG_COLUMN_STORE_NULL_ID if there was an error.
+ */
+rg_column_store_id rg_column_store_push(rg_column_store *store, const void *const *values);
+/**
+ * Erases a row by moving the last row in its place, in every column.
+ */
+void rg_column_store_erase(rg_column_store *store, rg_column_store_id id);
+bool rg_column_store_exists(rg_column_store *store, rg_column_store_id id);
+size_t rg_column_store_count(rg_column_store *store);
+size_t rg_column_store_column_count(rg_column_store *store);
+/**
+ * @return the row of the given id, or SIZE_MAX if it does not exist. It is only valid until the next erasure.
+ */
+size_t rg_column_store_row(rg_column_store *store, rg_column_store_id id);
+/**
+ * @return a pointer to the element of the given id in the given column, or NULL if it does not exist. It is invalidated by the next
+ * push or erasure.
+ */
+void *rg_column_store_get(rg_column_store *store, rg_column_store_id id, size_t column);
+/**
+ * Gets the packed array of a column, which contains rg_column_store_count elements in the order of the rows.
+ * It is invalidated by the next push or erasure.
+ */
+void *rg_column_store_column(rg_column_store *store, size_t column);
+/**
+ * Gets the packed array of the ids of the rows, which is in the same order as the columns.
+ */
+const rg_column_store_id *rg_column_store_ids(rg_column_store *store);
+/**
+ * Makes sure that the given number of rows can be stored without reallocation.
+ * @return false if an allocation failed.
+ */
+bool rg_column_store_reserve(rg_column_store *store, size_t count);
+
+/**
+ * Gets an iterator on the elements of a single column, which only touches the memory of that column and of the ids.
+ */
+rg_column_store_it rg_column_store_iterator(rg_column_store *store, size_t column);
+bool               rg_column_store_next(rg_column_store_it *it);
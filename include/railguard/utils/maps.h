@@ -1,5 +1,7 @@
 #pragma once
 
+#include <railguard/utils/memory.h>
+
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -17,6 +19,92 @@ typedef struct rg_hash_map rg_hash_map;
 
 typedef uint64_t rg_hash_map_key_t;
 
+/**
+ * @brief Memory layout used by a hash map to store its entries. It is chosen when the map is created and cannot be changed afterwards.
+ */
+typedef enum rg_hash_map_layout
+{
+    /**
+     * Key-value entries are stored in a single array, and probed one by one by comparing the full keys. A byte per slot stores the
+     * distance of the entry from its ideal slot, which the insertions and erasures use to reorder the clusters.
+     */
+    RG_HASH_MAP_LAYOUT_LINEAR = 0,
+    /**
+     * A separate array of 1-byte control tags is stored beside the entries. Slots are probed in groups of 16 by comparing 7 bits of
+     * the hash with all the tags of the group at once (using SSE2 when available), so full keys are only compared for likely matches.
+     */
+    RG_HASH_MAP_LAYOUT_GROUPED = 1,
+} rg_hash_map_layout;
+
+/**
+ * @brief Function used to hash the keys of a hash map.
+ * @param key the key to hash. It is never RG_HASH_MAP_NULL_KEY.
+ * @return a 64-bit hash of the key. All of its bits are used, so they should all depend on the key.
+ */
+typedef uint64_t (*rg_hash_map_hash_function)(rg_hash_map_key_t key);
+
+/**
+ * @brief Parameters used to create a hash map. Zero-initialize it to get the default values.
+ */
+typedef struct rg_hash_map_create_info
+{
+    /** Layout of the entries in memory. */
+    rg_hash_map_layout layout;
+    /**
+     * Function used to hash the keys. If NULL, rg_hash_map_hash is used. It is called about once per operation on a key, and once per
+     * entry when the map is resized. The keys that are already in the map are not hashed again by insertions and erasures.
+     */
+    rg_hash_map_hash_function pfn_hash;
+    /** Number of entries that can be stored before the first rehash. */
+    size_t initial_capacity;
+    /**
+     * Maximum ratio of filled slots before the map grows. Lower values use more memory but shorten the probes.
+     * If 0, the default of the layout is used (0.85 for linear, 0.875 for grouped). Otherwise, it is clamped to [0.25, 0.95].
+     */
+    float max_load_factor;
+    /**
+     * If true, when the map grows, the entries are moved to the new arrays a few at a time by the following sets and erasures,
+     * instead of all at once. That bounds the cost of a single operation, at the price of slightly slower operations during the
+     * migration. Reads never migrate entries, so it is still possible to get values while iterating the map.
+     */
+    bool incremental_resize;
+    /**
+     * If true, the keys and the values are stored on 32 bits, which halves the memory used by the map. It is well suited for maps
+     * of ids to indices. If a key or a value that doesn't fit is set, the map is converted to regular entries, once and for all.
+     */
+    bool compact;
+    /**
+     * By default, a map created with an initial capacity of at most 4 stores its first 4 entries in its own struct, and searches them
+     * linearly without hashing the keys. The arrays are only allocated when a 5th entry is added. The entries reuse the memory of the
+     * pointers to the arrays, so they don't make the map bigger. If true, the arrays are always used.
+     */
+    bool disable_inline_entries;
+    /**
+     * Allocator of the map and of its arrays. For a struct map, it also allocates the values and the keys. If NULL, the global heap
+     * is used. It must stay alive until the map is destroyed.
+     */
+    const rg_allocator *allocator;
+} rg_hash_map_create_info;
+
+/** Size of the probe length histogram of rg_hash_map_stats. */
+#define RG_HASH_MAP_PROBE_HISTOGRAM_SIZE 16
+
+/**
+ * @brief Statistics about the distribution of the keys in a hash map, used to evaluate hash functions and layouts.
+ */
+typedef struct rg_hash_map_stats
+{
+    size_t count;
+    size_t capacity;
+    /**
+     * Number of keys for each probe length. The probe length of a key is the number of steps between its ideal position and its actual
+     * position: slots for the linear layout, groups of 16 slots for the grouped layout. The last bucket also counts longer probes.
+     */
+    size_t probe_length_histogram[RG_HASH_MAP_PROBE_HISTOGRAM_SIZE];
+    size_t max_probe_length;
+    double mean_probe_length;
+} rg_hash_map_stats;
+
 typedef union
 {
     void  *as_ptr;
@@ -29,6 +117,10 @@ typedef struct rg_hash_map_it
     rg_hash_map_value_t value;
     rg_hash_map        *hash_map;
     size_t              next_index;
+    // Occupied slots of the current chunk of slots that haven't been returned yet, one bit per slot.
+    // They are loaded once per chunk, so that the iteration doesn't have to look at the empty slots.
+    uint64_t            pending_slots;
+    size_t              chunk_start;
 } rg_hash_map_it;
 
 typedef struct rg_hash_map_get_result
@@ -38,19 +130,55 @@ typedef struct rg_hash_map_get_result
 } rg_hash_map_get_result;
 
 // Functions
-rg_hash_map           *rg_create_hash_map(void);
+rg_hash_map *rg_create_hash_map(void);
+/**
+ * @brief Creates a new hash map with the given parameters.
+ * @param create_info parameters of the map. If NULL, the default values are used, and the result is the same as rg_create_hash_map.
+ * @return the created map, or NULL if an error occurred.
+ */
+rg_hash_map *rg_create_hash_map_with_info(const rg_hash_map_create_info *create_info);
+/**
+ * @brief Creates a new hash map with the default parameters, that can hold the given number of entries without rehashing.
+ * @return the created map, or NULL if an error occurred.
+ */
+rg_hash_map           *rg_create_hash_map_with_capacity(size_t capacity);
 void                   rg_destroy_hash_map(rg_hash_map **p_hash_map);
 rg_hash_map_get_result rg_hash_map_get(rg_hash_map *hash_map, rg_hash_map_key_t key);
+/**
+ * @brief Gets the values of several keys at once. The slots of the next keys are prefetched while the current one is looked up, so
+ * that the memory latency of the lookups overlaps. It is faster than calling rg_hash_map_get in a loop when the map is big.
+ * @param keys array of count keys to look up. It can contain duplicates and null keys.
+ * @param results array of at least count results, where the result of keys[i] is written at index i.
+ */
+void rg_hash_map_get_many(rg_hash_map *hash_map, const rg_hash_map_key_t *keys, size_t count, rg_hash_map_get_result *results);
 bool                   rg_hash_map_set(rg_hash_map *hash_map, rg_hash_map_key_t key, rg_hash_map_value_t value);
 size_t                 rg_hash_map_count(rg_hash_map *hash_map);
 void                   rg_hash_map_erase(rg_hash_map *hash_map, rg_hash_map_key_t key);
 rg_hash_map_it         rg_hash_map_iterator(rg_hash_map *hash_map);
 bool                   rg_hash_map_next(rg_hash_map_it *it);
 void                   rg_hash_map_clear(rg_hash_map *hash_map);
+/**
+ * @brief Grows the map so that it can hold at least the given number of entries without rehashing. Never shrinks the map.
+ * @return false if the allocation failed. In that case, the map is unchanged.
+ */
+bool rg_hash_map_reserve(rg_hash_map *hash_map, size_t count);
+/**
+ * @brief Reallocates the map with the smallest capacity that can hold its entries, and forgets the previous reservations.
+ * Maps also shrink automatically when they become less than a quarter full, but this function releases all the unused memory.
+ * @return false if the allocation failed. In that case, the map is unchanged.
+ */
+bool rg_hash_map_shrink_to_fit(rg_hash_map *hash_map);
+/**
+ * @brief Computes statistics about the distribution of the keys in the map. It iterates over the whole map, so it is slow.
+ * If an incremental resize is in progress, it is finished first.
+ */
+rg_hash_map_stats rg_hash_map_get_stats(rg_hash_map *hash_map);
 
-#ifdef UNIT_TESTS
+/**
+ * @brief Default hash function of the hash maps: the 64-bit finalizer of MurmurHash3, which mixes every bit of the key in a few
+ * instructions.
+ */
 uint64_t rg_hash_map_hash(uint64_t key);
-#endif
 
 // endregion
 
@@ -80,6 +208,32 @@ typedef struct rg_struct_map_it
  * @return the created map, or NULL if an error occurred.
  */
 rg_struct_map *rg_create_struct_map(size_t value_size);
+/**
+ * @brief Creates a new struct map whose hash map uses the given parameters.
+ * @param value_size The size of the structs that will be stored in the map.
+ * @param hash_map_info parameters of the hash map that indexes the values. If NULL, a compact map is used.
+ * @return the created map, or NULL if an error occurred.
+ */
+rg_struct_map *rg_create_struct_map_with_info(size_t value_size, const rg_hash_map_create_info *hash_map_info);
+/**
+ * @brief Creates a new struct map whose values are aligned. The values are stored in a dense array, apart from the keys, and each
+ * one starts at a multiple of the alignment.
+ * @param value_alignment power of 2, for example RG_CACHE_LINE_SIZE. If 0, the values are packed without padding. An alignment
+ * bigger than alignof(max_align_t) is only supported without a custom allocator.
+ * @param hash_map_info parameters of the hash map that indexes the values. If NULL, a compact map is used.
+ * @return the created map, or NULL if an error occurred or if the alignment is not supported.
+ */
+rg_struct_map *rg_create_struct_map_aligned(size_t value_size, size_t value_alignment, const rg_hash_map_create_info *hash_map_info);
+/**
+ * @brief Creates a new struct map whose values are stored in fixed-size pages that are never moved. The pointer to a value thus stays
+ * valid until the value is erased, even if other values are added or erased, so it can be kept instead of looking the key up again.
+ * The erasures leave holes in the pages, which are filled by the next insertions and skipped by the iterators.
+ * @param value_alignment power of 2, for example RG_CACHE_LINE_SIZE. If 0, the values are packed without padding. An alignment
+ * bigger than alignof(max_align_t) is only supported without a custom allocator.
+ * @param hash_map_info parameters of the hash map that indexes the values. If NULL, a compact map is used.
+ * @return the created map, or NULL if an error occurred or if the alignment is not supported.
+ */
+rg_struct_map *rg_create_struct_map_paged(size_t value_size, size_t value_alignment, const rg_hash_map_create_info *hash_map_info);
 void           rg_destroy_struct_map(rg_struct_map **p_struct_map);
 /**
  * Gets a value in the map.
@@ -88,14 +242,20 @@ void           rg_destroy_struct_map(rg_struct_map **p_struct_map);
  * @return the value, or NULL if the key does not exist.
  */
 void *rg_struct_map_get(rg_struct_map *p_struct_map, rg_hash_map_key_t key);
+/**
+ * @brief Gets the values of several keys at once, and prefetches them. See rg_hash_map_get_many.
+ * @param keys array of count keys to look up.
+ * @param values array of at least count pointers, where the value of keys[i], or NULL if it does not exist, is written at index i.
+ */
+void rg_struct_map_get_many(rg_struct_map *struct_map, const rg_hash_map_key_t *keys, size_t count, void **values);
 /**
  * @brief Sets the value of a p_key.
  * @param p_struct_map is the struct map to be accessed
  * @param key is the p_key of the data in the map.
  * @param p_data is a pointer to the data. It must be at least value_size bytes long. The data will be copied inside the map.
- * @returns the address of the data in the storage if the affectation was successful, NULL otherwise. This pointer will thus stay valid
- * while the element is still stored in the map and the map is still valid, even if the pointer passed to the p_data parameter is not
- * valid anymore.
+ * @returns the address of the data in the storage if the affectation was successful, NULL otherwise. This pointer stays valid even if
+ * the pointer passed to the p_data parameter is not valid anymore. In a paged map, it stays valid until the element is erased,
+ * otherwise it is invalidated by the next set or erasure.
  */
 void            *rg_struct_map_set(rg_struct_map *p_struct_map, rg_hash_map_key_t key, void *p_data);
 size_t           rg_struct_map_count(rg_struct_map *struct_map);
@@ -103,5 +263,35 @@ void             rg_struct_map_erase(rg_struct_map *struct_map, rg_hash_map_key_
 rg_struct_map_it rg_struct_map_iterator(rg_struct_map *struct_map);
 bool             rg_struct_map_next(rg_struct_map_it *it);
 bool             rg_struct_map_exists(rg_struct_map *struct_map, rg_hash_map_key_t key);
+/**
+ * @brief Erases several keys at once. The unknown keys and the duplicates are ignored.
+ * Instead of moving the last value in the place of each erased one, the erased places are sorted, and the holes below the final count
+ * are filled in one pass with the last remaining values, so that each value is moved at most once.
+ * @param keys array of count keys. It is reordered so that the keys that were really erased are at the beginning.
+ * @return the number of keys that were really erased.
+ */
+size_t rg_struct_map_erase_many(rg_struct_map *struct_map, rg_hash_map_key_t *keys, size_t count);
+/**
+ * @brief Returns the dense array of the values, in the iteration order, so that they can be scanned without loading the keys.
+ * @param p_stride if not NULL, receives the distance in bytes between two values, which includes the alignment padding.
+ * @return the first of rg_struct_map_count values. It is invalidated by the next set or erasure. Paged maps return NULL, since their
+ * values are not contiguous: use an iterator instead.
+ */
+void *rg_struct_map_values(rg_struct_map *struct_map, size_t *p_stride);
+/**
+ * @brief Returns the number of places in the storage of the map, which is the count plus the holes left by the erasures in a paged
+ * map. The iterators give the values in the order of their places, and their next_index is the place after the current value.
+ */
+size_t rg_struct_map_place_count(rg_struct_map *struct_map);
+/**
+ * @brief Grows the map and its storage so that it can hold at least the given number of values without rehashing or reallocating.
+ * @return false if an allocation failed.
+ */
+bool rg_struct_map_reserve(rg_struct_map *struct_map, size_t count);
+/**
+ * @brief Releases the unused memory of the map and of its storage. See rg_hash_map_shrink_to_fit.
+ * @return false if an allocation failed.
+ */
+bool rg_struct_map_shrink_to_fit(rg_struct_map *struct_map);
 
 // endregion
\ No newline at end of file
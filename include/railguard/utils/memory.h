@@ -39,6 +39,25 @@
  */
 #define rg_free free
 
+/**
+ * @brief Allocates memory whose address is a multiple of the given alignment, for example a cache line or a SIMD register size.
+ * @param alignment A power of 2. Alignments smaller than a pointer are rounded up to the size of a pointer.
+ * @return A pointer to the allocated memory, or NULL if the allocation failed or the alignment is not a power of 2.
+ * @warning The memory must be freed with rg_aligned_free, not rg_free.
+ */
+void *rg_aligned_malloc(size_t size, size_t alignment);
+
+/**
+ * @brief Reallocates memory allocated by rg_aligned_malloc, and keeps the alignment.
+ * @return A pointer to the reallocated memory, or NULL if the reallocation failed. In that case, the memory is untouched.
+ */
+void *rg_aligned_realloc(void *ptr, size_t size, size_t alignment);
+
+/**
+ * @brief Frees memory allocated by rg_aligned_malloc or rg_aligned_realloc.
+ */
+void rg_aligned_free(void *ptr);
+
 #else
 
 // --=== Memory watcher ===--
@@ -92,6 +111,22 @@ bool rg_mem_watcher_print_leaks(void);
  */
 #define rg_free(ptr)           rg_mem_watcher_free(ptr, __FILE__, __LINE__)
 
+/**
+ * @brief Allocates memory whose address is a multiple of the given alignment.
+ * @warning The memory must be freed with rg_aligned_free, not rg_free.
+ */
+#define rg_aligned_malloc(size, alignment)       rg_mem_watcher_aligned_malloc(size, alignment, __FILE__, __LINE__)
+
+/**
+ * @brief Reallocates memory allocated by rg_aligned_malloc, and keeps the alignment.
+ */
+#define rg_aligned_realloc(ptr, size, alignment) rg_mem_watcher_aligned_realloc(ptr, size, alignment, __FILE__, __LINE__)
+
+/**
+ * @brief Frees memory allocated by rg_aligned_malloc or rg_aligned_realloc.
+ */
+#define rg_aligned_free(ptr)                     rg_mem_watcher_aligned_free(ptr, __FILE__, __LINE__)
+
 // --=== Override memory functions ===--
 
 void *rg_mem_watcher_malloc(size_t size, const char *file, size_t line);
@@ -102,4 +137,80 @@ void *rg_mem_watcher_realloc(void *ptr, size_t size, const char *file, size_t li
 
 void rg_mem_watcher_free(void *ptr, const char *file, size_t line);
 
+void *rg_mem_watcher_aligned_malloc(size_t size, size_t alignment, const char *file, size_t line);
+
+void *rg_mem_watcher_aligned_realloc(void *ptr, size_t size, size_t alignment, const char *file, size_t line);
+
+void rg_mem_watcher_aligned_free(void *ptr, const char *file, size_t line);
+
+#endif
+
+// --=== Allocators ===--
+
+/**
+ * @brief Set of functions used by a container to manage its memory, instead of the global heap.
+ * It can be given to the containers when they are created, for example to back them with a per-frame arena, a per-level heap or a
+ * per-thread pool. The allocator must stay alive as long as the containers using it.
+ */
+typedef struct rg_allocator
+{
+    /** Allocates a block of the given size, aligned for any type, or returns NULL if it fails. */
+    void *(*pfn_alloc)(void *context, size_t size);
+    /**
+     * Resizes a block allocated by this allocator, moving it if needed, or returns NULL if it fails and leaves the block untouched.
+     * The old size is given so that allocators that don't track their blocks can copy them.
+     */
+    void *(*pfn_realloc)(void *context, void *ptr, size_t old_size, size_t new_size);
+    /** Frees a block allocated by this allocator. It is never called with NULL. */
+    void (*pfn_free)(void *context, void *ptr);
+    /** Pointer given to each function, for example to the state of an arena. */
+    void *context;
+} rg_allocator;
+
+/**
+ * @brief Allocates memory with an allocator, or with rg_malloc if the allocator is NULL.
+ */
+#define rg_allocator_alloc(allocator, size) \
+    ((allocator) != NULL ? (allocator)->pfn_alloc((allocator)->context, (size)) : rg_malloc(size))
+
+/**
+ * @brief Allocates zeroed memory with an allocator, or with rg_calloc if the allocator is NULL.
+ */
+#define rg_allocator_calloc(allocator, count, size) \
+    ((allocator) != NULL ? rg_allocator_alloc_zeroed((allocator), (count), (size)) : rg_calloc((count), (size)))
+
+/**
+ * @brief Reallocates memory with an allocator, or with rg_realloc if the allocator is NULL.
+ */
+#define rg_allocator_realloc(allocator, ptr, old_size, new_size)                                          \
+    ((allocator) != NULL ? (allocator)->pfn_realloc((allocator)->context, (ptr), (old_size), (new_size)) \
+                         : rg_realloc((ptr), (new_size)))
+
+/**
+ * @brief Frees memory with an allocator, or with rg_free if the allocator is NULL.
+ */
+#define rg_allocator_free(allocator, ptr) ((allocator) != NULL ? (allocator)->pfn_free((allocator)->context, (ptr)) : rg_free(ptr))
+
+/**
+ * @brief Allocates count * size bytes with the allocator and sets them to zero.
+ * @return A pointer to the allocated memory, or NULL if the allocation failed or the size overflows.
+ */
+void *rg_allocator_alloc_zeroed(const rg_allocator *allocator, size_t count, size_t size);
+
+// --=== Cache ===--
+
+/** @brief Size of a cache line on the supported CPUs. Data written by different threads should be at least this far apart. */
+#define RG_CACHE_LINE_SIZE 64
+
+/**
+ * @brief Hints the CPU to load an address in the cache, so that the memory latency overlaps with other work.
+ * It never faults, so it can be used on addresses that will not be read in the end.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define RG_PREFETCH(address) __builtin_prefetch(address)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#define RG_PREFETCH(address) _mm_prefetch((const char *) (address), _MM_HINT_T0)
+#else
+#define RG_PREFETCH(address) ((void) (address))
 #endif
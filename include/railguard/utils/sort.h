@@ -0,0 +1,74 @@
+#pragma once
+
+#include <railguard/utils/arrays.h>
+#include <railguard/utils/threads.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// --=== Constants ===--
+
+/** Number of keys from which the parallel radix sorts split the work between the threads of the pool. */
+#define RG_SORT_PARALLEL_MIN_COUNT (1u << 20)
+
+// --=== Types ===--
+
+/**
+ * 32-bit sort key with its payload, for example a draw key packing the pipeline and the material of a batch, and the index of that
+ * batch. Only the key is compared.
+ */
+typedef struct rg_sort_key32
+{
+    uint32_t key;
+    uint32_t index;
+} rg_sort_key32;
+
+/**
+ * 64-bit sort key with its payload. Only the key is compared.
+ */
+typedef struct rg_sort_key64
+{
+    uint64_t key;
+    uint64_t index;
+} rg_sort_key64;
+
+/**
+ * Function comparing two elements for rg_sort.
+ * @return a negative value if a goes before b, a positive value if a goes after b, and 0 if they are equivalent.
+ */
+typedef int (*rg_sort_compare_function)(const void *a, const void *b, void *user_data);
+
+// --=== Radix sorts ===--
+
+/**
+ * Sorts a vector of rg_sort_key32 by ascending key, with a least significant digit radix sort. It is stable: the elements with the
+ * same key keep their order. It runs in O(n), and skips the digits that are the same for all the keys.
+ * @return false if the temporary buffer couldn't be allocated with the allocator of the vector. In that case, the vector is unchanged.
+ */
+bool rg_sort_keys32(rg_vector *keys);
+/**
+ * Sorts a vector of rg_sort_key64 by ascending key.
+ * @see rg_sort_keys32
+ */
+bool rg_sort_keys64(rg_vector *keys);
+/**
+ * Sorts a vector of rg_sort_key32 like rg_sort_keys32, but splits each pass between the threads of the pool if there are at least
+ * RG_SORT_PARALLEL_MIN_COUNT keys. Below that, the synchronization costs more than it saves. The result is the same, and still stable.
+ * @param pool the pool that runs the passes. If NULL, the sort runs on the calling thread.
+ */
+bool rg_sort_keys32_parallel(rg_vector *keys, rg_thread_pool *pool);
+/**
+ * Sorts a vector of rg_sort_key64 in parallel.
+ * @see rg_sort_keys32_parallel
+ */
+bool rg_sort_keys64_parallel(rg_vector *keys, rg_thread_pool *pool);
+
+// --=== Comparison sort ===--
+
+/**
+ * Sorts an array of any type with a comparator, for the elements that can't be reduced to an integer key. It is an introsort: a
+ * quicksort that switches to a heapsort when it recurses too deep, and to an insertion sort for the small partitions, so it runs in
+ * O(n log n) even in the worst case. It is not stable.
+ */
+void rg_sort(void *data, size_t count, size_t element_size, rg_sort_compare_function pfn_compare, void *user_data);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <railguard/utils/maps.h>
+#include <railguard/utils/threads.h>
 
 #include <stdbool.h>
 #include <stddef.h>
@@ -19,20 +20,113 @@
  * • New elements can be pushed in the storage, which returns a new unique id for the element\n
  * • Using the id, the element can be read, updated or deleted\n
  * • The allocation of the data is handled by the storage (data is copied inside it from the pointer when pushed)\n
- * • Inside the storage, the data is kept tightly packed, even if elements are deleted\n
+ * • Inside the storage, the data is kept tightly packed, even if elements are deleted, unless stable addresses are requested\n
  * • With an iterator, it is possible to read all the elements in the storage
  */
 typedef struct rg_storage rg_storage;
 
 typedef uint32_t rg_storage_id;
 
+/**
+ * @brief Way a storage finds its elements from their ids.
+ */
+typedef enum rg_storage_mode
+{
+    /** The ids are generated by a counter, and a hash map gives the index of each element in the packed array. */
+    RG_STORAGE_MODE_HASHED = 0,
+    /**
+     * Each id contains the index of a slot, which gives the index of the element in the packed array, and the generation of the
+     * slot. A lookup is a direct indexing followed by a generation check, without any hashing. The slots of the erased elements are
+     * reused, but with a new generation, so that the old ids stay invalid. There can be at most 2^24 elements at the same time.
+     */
+    RG_STORAGE_MODE_SLOT_MAP = 1,
+} rg_storage_mode;
+
+/**
+ * @brief Parameters used to create a storage.
+ */
+typedef struct rg_storage_create_info
+{
+    /** Size of the elements that will be stored. */
+    size_t          element_size;
+    rg_storage_mode mode;
+    /**
+     * Hashed mode only, slot maps always recycle their ids.
+     * If true, the ids of the erased elements are reused by the next pushes, so that the ids stay small. Otherwise, the ids are
+     * unique until the 32-bit range is exhausted, then the counter starts again and skips the ids that are still used.
+     */
+    bool recycle_ids;
+    /**
+     * Hashed mode with recycled ids only. Number of high bits of the ids used as a generation, at most 16. It is incremented each time
+     * an id is recycled, so that an old id doesn't match the new element until the generation wraps. The other bits are the index of
+     * the id, so there can be at most 2^(32 - generation_bits) - 1 elements at the same time.
+     */
+    uint32_t generation_bits;
+    /**
+     * If true, the elements are stored in fixed-size pages that are never moved, so that the pointer to an element stays valid until
+     * the element is erased, and can be kept instead of getting the element again. The erasures leave holes in the pages, which are
+     * filled by the next pushes and skipped by the iterators. Otherwise, the elements are always packed, but the pointers to them are
+     * invalidated by the next push or erasure.
+     */
+    bool stable_addresses;
+    /** Pool that runs the chunks of rg_storage_parallel_for. If NULL, they are run on the calling thread. */
+    rg_thread_pool *thread_pool;
+    /**
+     * If true, the storage keeps a journal of the ids that were created, modified or erased, which can be read with
+     * rg_storage_changes_since. Since the elements are modified through pointers, the modifications must be reported with
+     * rg_storage_mark_modified. Otherwise, nothing is recorded and the storage operations don't pay for it.
+     */
+    bool track_changes;
+    /** Allocator of the storage and of all of its arrays. If NULL, the global heap is used. It must outlive the storage. */
+    const rg_allocator *allocator;
+} rg_storage_create_info;
+
+typedef enum rg_storage_change_type
+{
+    RG_STORAGE_CHANGE_CREATED  = 0,
+    RG_STORAGE_CHANGE_MODIFIED = 1,
+    RG_STORAGE_CHANGE_ERASED   = 2,
+} rg_storage_change_type;
+
+typedef struct rg_storage_change
+{
+    rg_storage_id          id;
+    rg_storage_change_type type;
+    /** Epoch of the storage when the change was made. */
+    uint64_t epoch;
+} rg_storage_change;
+
+/**
+ * Changes of a storage since an epoch, in the order in which they were made.
+ * An id can appear several times, but it is modified at most once per epoch: the modifications that follow its creation or its first
+ * modification in the same epoch are not recorded again. The current state of an element must be read from the storage.
+ */
+typedef struct rg_storage_changes
+{
+    const rg_storage_change *changes;
+    size_t                   count;
+    /** False if a change couldn't be recorded because an allocation failed. The whole storage should then be considered changed. */
+    bool complete;
+} rg_storage_changes;
+
 typedef struct rg_storage_it
 {
     rg_struct_map_it map_it;
-    rg_storage_id    id;
-    void            *value;
+    rg_storage      *storage;
+    size_t           next_index;
+    // The iteration stops before this place of the storage. It is used to split the storage in chunks.
+    size_t        end_index;
+    rg_storage_id id;
+    void         *value;
 } rg_storage_it;
 
+/**
+ * Function run for each chunk of rg_storage_parallel_for.
+ * @param it iterator that gives the elements of the chunk with rg_storage_next.
+ * @param chunk_index index of the chunk, between 0 and rg_storage_chunk_count.
+ */
+typedef void (*rg_storage_chunk_function)(rg_storage_it *it, size_t chunk_index, void *user_data);
+
 // --=== Functions ===--
 
 /**
@@ -40,6 +134,11 @@ typedef struct rg_storage_it
  * @return The new storage, or NULL if there was an error.
  */
 rg_storage *rg_create_storage(size_t element_size);
+/**
+ * Creates a new storage with the given parameters.
+ * @return The new storage, or NULL if there was an error.
+ */
+rg_storage *rg_create_storage_with_info(const rg_storage_create_info *create_info);
 void        rg_destroy_storage(rg_storage **storage);
 
 /**
@@ -50,11 +149,69 @@ void        rg_destroy_storage(rg_storage **storage);
  */
 rg_storage_id rg_storage_push(rg_storage *storage, void *data);
 void         *rg_storage_get(rg_storage *storage, rg_storage_id id);
+/**
+ * Gets several elements at once. It is faster than calling rg_storage_get in a loop, since the lookups are pipelined and the
+ * elements are prefetched.
+ * @param ids array of count ids to look up.
+ * @param values array of at least count pointers, where the element of ids[i], or NULL if it does not exist, is written at index i.
+ */
+void          rg_storage_get_many(rg_storage *storage, const rg_storage_id *ids, size_t count, void **values);
 void          rg_storage_erase(rg_storage *storage, rg_storage_id id);
+/**
+ * Queues the erasure of an element until the next call to rg_storage_commit_erases. The element stays in the storage until then, so
+ * it can be called while iterating on the storage, without skipping or revisiting elements.
+ */
+void rg_storage_erase_deferred(rg_storage *storage, rg_storage_id id);
+/**
+ * Erases all the queued elements at once. The places of the erased elements are sorted, and the storage is compacted in one pass where
+ * each element moves at most once. The ids that don't exist or were queued twice are ignored.
+ * It must not be called while iterating on the storage.
+ */
+void rg_storage_commit_erases(rg_storage *storage);
 rg_storage_it rg_storage_iterator(rg_storage *storage);
 bool          rg_storage_next(rg_storage_it *it);
 size_t        rg_storage_count(rg_storage *storage);
 bool          rg_storage_exists(rg_storage *storage, rg_storage_id id);
+/**
+ * @return the number of chunks that rg_storage_parallel_for will run with the given grain.
+ */
+size_t rg_storage_chunk_count(rg_storage *storage, size_t grain);
+/**
+ * Splits the storage in chunks of consecutive elements, and runs the function on each chunk with the thread pool of the storage.
+ * The chunks only depend on the elements of the storage and on the grain, not on the threads. To compute a deterministic reduction,
+ * write the result of each chunk at its index in an array of rg_storage_chunk_count results, then combine them in order.
+ * The elements can be modified, but no element can be pushed or erased until it returns.
+ * @param grain number of places in each chunk, which may contain fewer elements if stable addresses are used. If 0, a default is used.
+ */
+void rg_storage_parallel_for(rg_storage *storage, rg_storage_chunk_function pfn_chunk, void *user_data, size_t grain);
+/**
+ * Releases the memory that is not used anymore, for example after a lot of elements were erased.
+ * @return false if an allocation failed.
+ */
+bool rg_storage_shrink_to_fit(rg_storage *storage);
+/**
+ * Records a modification of an existing element, if the storage tracks its changes.
+ */
+void rg_storage_mark_modified(rg_storage *storage, rg_storage_id id);
+/**
+ * @return the epoch of the next changes, or 0 if the storage doesn't track its changes.
+ */
+uint64_t rg_storage_current_epoch(rg_storage *storage);
+/**
+ * Starts a new epoch, so that the next changes are recorded after the previous ones, and the elements can be modified again.
+ * A consumer of the changes should start an epoch once it has read them, and keep the returned epoch to read the next ones.
+ * @return the new epoch, or 0 if the storage doesn't track its changes.
+ */
+uint64_t rg_storage_begin_epoch(rg_storage *storage);
+/**
+ * Gets the changes made since the beginning of the given epoch.
+ * The result is valid until the next change, or the next call to rg_storage_discard_changes_before.
+ */
+rg_storage_changes rg_storage_changes_since(rg_storage *storage, uint64_t epoch);
+/**
+ * Forgets the changes made before the given epoch, once every consumer has read them, so that the journal doesn't grow forever.
+ */
+void rg_storage_discard_changes_before(rg_storage *storage, uint64_t epoch);
 
 // endregion
 
@@ -65,7 +222,10 @@ bool          rg_storage_exists(rg_storage *storage, rg_storage_id id);
 /**
  * A handle storage is a storage that can be used to store handles.
  * Since handles are pointer, we do not need to manage the allocation of the pointed data.
- * Thus, the underlying implementation will use a hash map instead of a struct map, which is simpler.
+ * Thus, the handles are stored directly in an array indexed by the slots of the ids, which come from a rg_slot_table like the ids of
+ * the slot map storages. An id also contains the generation of its slot, which changes when the slot is freed, so that the ids of the
+ * erased handles don't match the next handle stored in the slot. Getting a handle is a single indexed load followed by a generation
+ * check. There can be at most 2^24 handles at the same time.
  */
 typedef struct rg_handle_storage rg_handle_storage;
 
@@ -76,9 +236,10 @@ typedef struct rg_handle_storage_get_result {
 
 typedef struct rg_handle_storage_it
 {
-    rg_hash_map_it map_it;
-    rg_storage_id  id;
-    void          *value;
+    rg_handle_storage *storage;
+    size_t             next_index;
+    rg_storage_id      id;
+    void              *value;
 } rg_handle_storage_it;
 
 // --=== Functions ===--
@@ -89,6 +250,13 @@ typedef struct rg_handle_storage_it
  */
 rg_handle_storage *rg_create_handle_storage(void);
 
+/**
+ * Creates a new handle storage whose memory is allocated with the given allocator.
+ * @param allocator The allocator of the storage. If NULL, the global heap is used. It must outlive the storage.
+ * @return The new handle storage, or NULL if there was an error.
+ */
+rg_handle_storage *rg_create_handle_storage_with_allocator(const rg_allocator *allocator);
+
 /**
  * Destroys a handle storage.
  * @param storage The handle storage to destroy.
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "arrays.h"
+#include "memory.h"
 
 #include <stdbool.h>
 #include <stddef.h>
@@ -59,6 +60,14 @@ rg_string rg_create_string_from_cstr(const char *cstr);
  */
 rg_string rg_clone_string(rg_string string);
 
+/**
+ * Clones a rg_string into memory allocated with the given allocator.
+ * @param string The string to clone.
+ * @param allocator The allocator of the new data. If NULL, the global heap is used.
+ * @return a new rg_string with the same data and length, but at a different memory location.
+ */
+rg_string rg_clone_string_with_allocator(rg_string string, const rg_allocator *allocator);
+
 /**
  * Creates a new string from a buffer and a length. The buffer is not a null-terminated string.
  * @param buffer the buffer to create the string from.
@@ -67,6 +76,12 @@ rg_string rg_clone_string(rg_string string);
  */
 rg_string rg_create_string_from_buffer(void *buffer, size_t length);
 
+/**
+ * Creates a new string from a buffer and a length, with memory allocated with the given allocator.
+ * @param allocator The allocator of the new data. If NULL, the global heap is used.
+ */
+rg_string rg_create_string_from_buffer_with_allocator(void *buffer, size_t length, const rg_allocator *allocator);
+
 /**
  * Checks if the given rg_string is empty (equal to EMPTY_STRING).
  * @param string the string to check.
@@ -85,6 +100,18 @@ static inline bool rg_string_is_empty(rg_string string)
  */
 rg_string rg_string_concat(rg_string a, rg_string b);
 
+/**
+ * Creates a new string containing the concatenation of a and b, with memory allocated with the given allocator.
+ * @param allocator The allocator of the new data. If NULL, the global heap is used.
+ */
+rg_string rg_string_concat_with_allocator(rg_string a, rg_string b, const rg_allocator *allocator);
+
+/**
+ * Frees a string created by one of the functions above with the same allocator. Empty strings are not allocated, so they are ignored.
+ * @param allocator The allocator that was used to create the string. If NULL, the global heap is used.
+ */
+void rg_free_string(rg_string string, const rg_allocator *allocator);
+
 /**
  * Check if two strings are equal.
  * @param a a rg_string.
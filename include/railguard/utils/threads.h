@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// --=== Types ===--
+
+/**
+ * A thread pool keeps worker threads alive between the jobs, so that running tasks in parallel doesn't cost a thread creation each
+ * time. A job is a number of tasks that are distributed between the workers and the calling thread, which waits until all of them are
+ * done.
+ */
+typedef struct rg_thread_pool rg_thread_pool;
+
+/**
+ * Function run for each task of a job.
+ * Tasks may allocate with rg_malloc and the related functions, even with MEMORY_CHECKS: the memory watcher is thread safe.
+ * @param task_index index of the task in the job, between 0 and the task count. The tasks are started in order, but may run in
+ * parallel and finish in any order.
+ */
+typedef void (*rg_thread_pool_task_function)(size_t task_index, void *user_data);
+
+// --=== Functions ===--
+
+/**
+ * Creates a new thread pool and starts its workers.
+ * @param worker_count number of worker threads. If 0, one worker is started for each processor except one, since the calling thread
+ * also runs tasks.
+ * @return The new thread pool, or NULL if there was an error.
+ */
+rg_thread_pool *rg_create_thread_pool(size_t worker_count);
+/**
+ * Stops the workers and destroys the thread pool. It must not be running a job.
+ */
+void rg_destroy_thread_pool(rg_thread_pool **p_pool);
+/**
+ * @return the number of threads that run the tasks of a job, which is the number of workers plus the calling thread.
+ */
+size_t rg_thread_pool_thread_count(rg_thread_pool *pool);
+/**
+ * Runs the given number of tasks on the workers and on the calling thread, and returns when all of them are done.
+ * Only one job can run at a time: this function must not be called from a task, or from several threads at once.
+ * @param pool the pool that runs the tasks. If NULL, the tasks are all run on the calling thread.
+ */
+void rg_thread_pool_run(rg_thread_pool *pool, size_t task_count, rg_thread_pool_task_function pfn_task, void *user_data);
@@ -2,6 +2,7 @@
 #ifdef RENDERER_VULKAN
 
 #include "railguard/core/renderer.h"
+#include <railguard/utils/column_store.h>
 #include <railguard/utils/event_sender.h>
 #include <railguard/utils/storage.h>
 
@@ -26,6 +27,8 @@
 #define WAIT_FOR_FENCES_TIMEOUT 1000000000
 #define SEMAPHORE_TIMEOUT       1000000000
 #define RENDER_STAGE_COUNT      2
+/// \brief Number of ids kept inline in the lists of models of a material and of instances of a model, before they spill to the heap.
+#define RG_RENDERER_INLINE_ID_COUNT 4
 
 // endregion
 
@@ -84,7 +87,9 @@ typedef struct rg_swapchain
     rg_hash_map *pipelines;
     uint64_t     built_effects_version;
     // Render stages
+    // Their batches only change when the effects, templates or materials change, so they are only rebuilt then
     rg_array render_stages;
+    bool     stage_cache_valid;
     // Pointer to renderer so that we can go back to it from the swapchain
     rg_renderer *renderer;
 } rg_swapchain;
@@ -136,21 +141,27 @@ typedef struct rg_material
 {
     /** Template this material is based on. Defines the available shader effects for this material. */
     rg_material_template_id material_template_id;
-    rg_vector               models_using_material;
+    /** Most materials are used by a few models, so their ids are stored inline. */
+    RG_SMALL_VECTOR(rg_model_id, RG_RENDERER_INLINE_ID_COUNT) models_using_material;
 } rg_material;
 
 typedef struct rg_model
 {
     /** Material used by this model. */
     rg_material_id material_id;
-    rg_vector      instances;
-
+    /** Most models have a few instances, so their ids are stored inline. */
+    RG_SMALL_VECTOR(rg_render_node_id, RG_RENDERER_INLINE_ID_COUNT) instances;
 } rg_model;
 
-typedef struct rg_render_node
+/**
+ * Components of the render nodes. Each one is stored in its own column, so that a pass only loads the components it needs.
+ */
+typedef enum rg_render_node_column
 {
-    rg_model_id model_id;
-} rg_render_node;
+    /** rg_model_id of the instantiated model. */
+    RG_RENDER_NODE_COLUMN_MODEL_ID = 0,
+    RG_RENDER_NODE_COLUMN_COUNT,
+} rg_render_node_column;
 
 // endregion
 
@@ -201,8 +212,8 @@ typedef struct rg_renderer
     rg_storage *shader_effects;
     rg_storage *material_templates;
     rg_storage *materials;
-    rg_storage *models;
-    rg_storage *render_nodes;
+    rg_storage      *models;
+    rg_column_store *render_nodes;
 
     // Number incremented at each created shader effect
     // It is stored in the swapchain when effects are built
@@ -1142,6 +1153,9 @@ void rg_renderer_clear_pipelines(rg_swapchain *swapchain)
 
     // Reset the version
     swapchain->built_effects_version = 0;
+
+    // The batches point to the destroyed pipelines
+    swapchain->stage_cache_valid = false;
 }
 
 void rg_renderer_recreate_pipelines(rg_swapchain *swapchain)
@@ -1540,6 +1554,7 @@ void rg_renderer_add_window(rg_renderer *renderer, uint32_t window_index, rg_win
 
     swapchain->pipelines             = rg_create_hash_map();
     swapchain->built_effects_version = 0;
+    swapchain->stage_cache_valid     = false;
 
     swapchain->swapchain_image_format = rg_select_surface_format(renderer, window);
 
@@ -1775,15 +1790,9 @@ rg_material_id rg_renderer_create_material(rg_renderer *renderer, rg_material_te
     // Create material
     rg_material material = {
         .material_template_id = material_template_id,
-        .models_using_material =
-            {
-                .data     = NULL,
-                .count    = 0,
-                .capacity = 0,
-            },
     };
     // Init vector
-    rg_renderer_check(rg_create_vector(10, sizeof(rg_model_id), &material.models_using_material), NULL);
+    RG_SMALL_VECTOR_CREATE(material.models_using_material);
 
     // Store material
     rg_material_id material_id = rg_storage_push(renderer->materials, &material);
@@ -1799,7 +1808,7 @@ void rg_renderer_destroy_material(rg_renderer *renderer, rg_material_id material
     if (material != NULL)
     {
         // Destroy vector
-        rg_destroy_vector(&material->models_using_material);
+        rg_destroy_small_vector(&material->models_using_material.vector);
 
         // Remove from map
         rg_storage_erase(renderer->materials, material_id);
@@ -1816,7 +1825,7 @@ void rg_renderer_clear_materials(rg_renderer *renderer)
         {
             rg_material *material = it.value;
 
-            rg_destroy_vector(&material->models_using_material);
+            rg_destroy_small_vector(&material->models_using_material.vector);
         }
 
         // Clean storage itself
@@ -1830,7 +1839,8 @@ bool rg_renderer_material_register_model(rg_renderer *renderer, rg_material_id m
     rg_material *material = rg_storage_get(renderer->materials, material_id);
     if (material != NULL)
     {
-        rg_vector_push_back(&material->models_using_material, &model_id);
+        rg_small_vector_push_back(&material->models_using_material.vector, &model_id);
+        rg_storage_mark_modified(renderer->materials, material_id);
 
         return true;
     }
@@ -1844,34 +1854,11 @@ bool rg_renderer_material_unregister_model(rg_renderer *renderer, rg_material_id
     rg_material *material = rg_storage_get(renderer->materials, material_id);
     if (material != NULL)
     {
-        bool found = false;
-
-        // Find the model
-        rg_vector_it it = rg_vector_iterator(&material->models_using_material);
-        while (rg_vector_next(&it))
+        // Find the model and replace it with the last one
+        size_t index = rg_small_vector_find(&material->models_using_material.vector, &model_id);
+        if (rg_small_vector_swap_remove(&material->models_using_material.vector, index))
         {
-            rg_model_id *id = it.value;
-
-            if (*id == model_id)
-            {
-                found = true;
-                break;
-            }
-        }
-
-        if (found)
-        {
-            size_t index      = it.index;
-            size_t last_index = rg_vector_last_index(&material->models_using_material);
-
-            if (index < last_index)
-            {
-                // Copy last element to deleted slot
-                rg_vector_copy(&material->models_using_material, last_index, index);
-            }
-
-            // Remove last element
-            rg_vector_pop_back(&material->models_using_material);
+            rg_storage_mark_modified(renderer->materials, material_id);
         }
 
         return true;
@@ -1893,16 +1880,10 @@ rg_model_id rg_renderer_create_model(rg_renderer *renderer, rg_material_id mater
     // Create model
     rg_model model = {
         .material_id = material_id,
-        .instances =
-            {
-                .data     = NULL,
-                .count    = 0,
-                .capacity = 0,
-            },
     };
 
     // Init vector
-    rg_renderer_check(rg_create_vector(10, sizeof(rg_render_node_id), &model.instances), NULL);
+    RG_SMALL_VECTOR_CREATE(model.instances);
 
     // Store model
     rg_model_id model_id = rg_storage_push(renderer->models, &model);
@@ -1921,7 +1902,7 @@ void rg_renderer_destroy_model(rg_renderer *renderer, rg_model_id model_id)
     if (model != NULL)
     {
         // Destroy vector
-        rg_destroy_vector(&model->instances);
+        rg_destroy_small_vector(&model->instances.vector);
 
         // Remove from map
         rg_storage_erase(renderer->models, model_id);
@@ -1941,7 +1922,7 @@ void rg_renderer_clear_models(rg_renderer *renderer)
         {
             rg_model *model = it.value;
 
-            rg_destroy_vector(&model->instances);
+            rg_destroy_small_vector(&model->instances.vector);
         }
 
         // Clean storage itself
@@ -1955,7 +1936,7 @@ void rg_renderer_model_register_instance(rg_renderer *renderer, rg_model_id mode
     rg_model *model = rg_storage_get(renderer->models, model_id);
     if (model != NULL)
     {
-        rg_vector_push_back(&model->instances, &render_node_id);
+        rg_small_vector_push_back(&model->instances.vector, &render_node_id);
     }
 }
 
@@ -1965,35 +1946,9 @@ void rg_renderer_model_unregister_instance(rg_renderer *renderer, rg_model_id mo
     rg_model *model = rg_storage_get(renderer->models, model_id);
     if (model != NULL)
     {
-        bool found = false;
-
-        // Find the model
-        rg_vector_it it = rg_vector_iterator(&model->instances);
-        while (rg_vector_next(&it))
-        {
-            rg_render_node_id *id = it.value;
-
-            if (*id == render_node_id)
-            {
-                found = true;
-                break;
-            }
-        }
-
-        if (found)
-        {
-            size_t index      = it.index;
-            size_t last_index = rg_vector_last_index(&model->instances);
-
-            if (index < last_index)
-            {
-                // Copy last element to deleted slot
-                rg_vector_copy(&model->instances, last_index, index);
-            }
-
-            // Remove last element
-            rg_vector_pop_back(&model->instances);
-        }
+        // Find the instance and replace it with the last one
+        size_t index = rg_small_vector_find(&model->instances.vector, &render_node_id);
+        rg_small_vector_swap_remove(&model->instances.vector, index);
     }
 }
 
@@ -2007,13 +1962,9 @@ rg_render_node_id rg_renderer_create_render_node(rg_renderer *renderer, rg_model
     rg_renderer_check(renderer != NULL, NULL);
     rg_renderer_check(model_id != RG_STORAGE_NULL_ID, NULL);
 
-    // Create render node
-    rg_render_node node = {
-        .model_id = model_id,
-    };
-
     // Store render node
-    rg_render_node_id render_node_id = rg_storage_push(renderer->render_nodes, &node);
+    const void       *node[RG_RENDER_NODE_COLUMN_COUNT] = {[RG_RENDER_NODE_COLUMN_MODEL_ID] = &model_id};
+    rg_render_node_id render_node_id                    = rg_column_store_push(renderer->render_nodes, node);
 
     // Register it in the model
     rg_renderer_model_register_instance(renderer, model_id, render_node_id);
@@ -2024,14 +1975,14 @@ rg_render_node_id rg_renderer_create_render_node(rg_renderer *renderer, rg_model
 void rg_renderer_destroy_render_node(rg_renderer *renderer, rg_render_node_id render_node_id)
 {
     // Get render node
-    rg_render_node *node = rg_storage_get(renderer->render_nodes, render_node_id);
-    if (node != NULL)
+    rg_model_id *model_id = rg_column_store_get(renderer->render_nodes, render_node_id, RG_RENDER_NODE_COLUMN_MODEL_ID);
+    if (model_id != NULL)
     {
         // Unregister it
-        rg_renderer_model_unregister_instance(renderer, node->model_id, render_node_id);
+        rg_renderer_model_unregister_instance(renderer, *model_id, render_node_id);
 
-        // Remove from storage
-        rg_storage_erase(renderer->render_nodes, render_node_id);
+        // Remove from store
+        rg_column_store_erase(renderer->render_nodes, render_node_id);
     }
 }
 
@@ -2039,8 +1990,8 @@ void rg_renderer_clear_render_nodes(rg_renderer *renderer)
 {
     if (renderer->render_nodes != NULL)
     {
-        // Clean storage itself
-        rg_destroy_storage(&renderer->render_nodes);
+        // Clean store itself
+        rg_destroy_column_store(&renderer->render_nodes);
     }
 }
 
@@ -2049,6 +2000,19 @@ void rg_renderer_clear_render_nodes(rg_renderer *renderer)
 
 // region Stages functions
 
+/**
+ * Reads and forgets the changes of a tracked storage since the last call.
+ * @return true if the storage changed.
+ */
+bool rg_renderer_consume_changes(rg_storage *storage)
+{
+    // The renderer is the only consumer of the changes, so they can be discarded as soon as they are read
+    rg_storage_changes changes = rg_storage_changes_since(storage, rg_storage_current_epoch(storage));
+    bool               changed = changes.count > 0 || !changes.complete;
+    rg_storage_discard_changes_before(storage, rg_storage_begin_epoch(storage));
+    return changed;
+}
+
 void rg_renderer_update_stage_cache(rg_swapchain *swapchain)
 {
     rg_renderer *renderer = swapchain->renderer;
@@ -2063,7 +2027,7 @@ void rg_renderer_update_stage_cache(rg_swapchain *swapchain)
         rg_vector_clear(&stage->batches);
 
         // Find the models using the materials using a template using an effect matching the stage
-        rg_vector models = {0, 0, 0, NULL, 0};
+        rg_vector models = {0};
         rg_renderer_check(rg_create_vector(5, sizeof(rg_model_id), &models), NULL);
 
         rg_storage_it effects_it = rg_storage_iterator(renderer->shader_effects);
@@ -2096,7 +2060,7 @@ void rg_renderer_update_stage_cache(rg_swapchain *swapchain)
 
                                     // Add a batch
                                     rg_render_batch batch = {
-                                        .count    = material->models_using_material.count,
+                                        .count    = material->models_using_material.vector.count,
                                         .offset   = models.count,
                                         .pipeline = pipeline_get_result.value.as_ptr,
                                     };
@@ -2104,8 +2068,8 @@ void rg_renderer_update_stage_cache(rg_swapchain *swapchain)
 
                                     // Add the models using that material
                                     rg_vector_extend(&models,
-                                                     &material->models_using_material.data,
-                                                     material->models_using_material.count);
+                                                     rg_small_vector_data(&material->models_using_material.vector),
+                                                     material->models_using_material.vector.count);
 
                                     break;
                                 }
@@ -2152,8 +2116,6 @@ void rg_renderer_update_stage_cache(rg_swapchain *swapchain)
 
             for (uint32_t j = 0; j < models.count; j++)
             {
-                rg_model *model = rg_vector_get_element(&models, j);
-
                 indirect_commands[j].vertexCount   = 3; // TODO when mesh is added
                 indirect_commands[j].firstVertex   = 0;
                 indirect_commands[j].instanceCount = 1; // TODO when instances are added
@@ -2535,14 +2497,31 @@ rg_renderer *rg_create_renderer(rg_window  *example_window,
 
     // --=== Init various storages ===--
 
-    // Init shader_modules map
-    renderer->shader_modules     = rg_create_storage(sizeof(rg_shader_module));
-    renderer->shader_effects     = rg_create_storage(sizeof(rg_shader_effect));
-    renderer->material_templates = rg_create_storage(sizeof(rg_material_template));
-    renderer->materials          = rg_create_storage(sizeof(rg_material));
-    renderer->models             = rg_create_storage(sizeof(rg_model));
-    renderer->render_nodes       = rg_create_storage(sizeof(rg_render_node));
-    renderer->effects_version    = 0;
+    // The ids of the renderer objects are resolved every frame, so use slot maps: a lookup is a direct indexing, without hashing
+    // The changes of the effects, templates and materials are tracked, so that the render stages are only rebuilt when needed
+    rg_storage_create_info storage_info = {
+        .mode = RG_STORAGE_MODE_SLOT_MAP,
+    };
+    storage_info.element_size    = sizeof(rg_shader_module);
+    renderer->shader_modules     = rg_create_storage_with_info(&storage_info);
+    storage_info.track_changes   = true;
+    storage_info.element_size    = sizeof(rg_shader_effect);
+    renderer->shader_effects     = rg_create_storage_with_info(&storage_info);
+    storage_info.element_size    = sizeof(rg_material_template);
+    renderer->material_templates = rg_create_storage_with_info(&storage_info);
+    storage_info.element_size    = sizeof(rg_material);
+    renderer->materials          = rg_create_storage_with_info(&storage_info);
+    storage_info.track_changes   = false;
+    storage_info.element_size    = sizeof(rg_model);
+    renderer->models             = rg_create_storage_with_info(&storage_info);
+
+    // The render nodes will be processed by passes that only need some of their components, so store them by columns
+    size_t render_node_column_sizes[RG_RENDER_NODE_COLUMN_COUNT] = {
+        [RG_RENDER_NODE_COLUMN_MODEL_ID] = sizeof(rg_model_id),
+    };
+    renderer->render_nodes = rg_create_column_store(RG_RENDER_NODE_COLUMN_COUNT, render_node_column_sizes);
+
+    renderer->effects_version = 0;
 
     // --=== Init frames ===--
 
@@ -2688,17 +2667,33 @@ void rg_renderer_draw(rg_renderer *renderer)
     // Wait for the fence
     rg_renderer_wait_for_fence(renderer, current_frame->render_fence);
 
+    // Check if the render stages need to be rebuilt
+    // Use a bitwise or so that the changes of every storage are consumed
+    bool scene_changed = rg_renderer_consume_changes(renderer->shader_effects);
+    scene_changed |= rg_renderer_consume_changes(renderer->material_templates);
+    scene_changed |= rg_renderer_consume_changes(renderer->materials);
+
     for (uint32_t i = 0; i < renderer->swapchains.count; i++)
     {
         rg_swapchain *swapchain = &((rg_swapchain *) renderer->swapchains.data)[i];
 
+        // Also invalidate the disabled swapchains, since they won't see these changes anymore when they are enabled again
+        if (scene_changed)
+        {
+            swapchain->stage_cache_valid = false;
+        }
+
         if (swapchain->enabled)
         {
             // Update pipelines if needed
             rg_renderer_build_out_of_date_effects(swapchain);
 
-            // Update render stages cache
-            rg_renderer_update_stage_cache(swapchain);
+            // Update render stages cache if needed
+            if (!swapchain->stage_cache_valid)
+            {
+                rg_renderer_update_stage_cache(swapchain);
+                swapchain->stage_cache_valid = true;
+            }
 
             // Begin recording
             rg_renderer_begin_recording(renderer);
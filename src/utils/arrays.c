@@ -3,25 +3,150 @@
 #include <railguard/utils/memory.h>
 
 #include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
+// Use SSE2 to search vectors of 32-bit elements when it is available
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RG_VECTOR_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// --=== Constants ===--
+
+// The elements of a page start after a header that keeps the fundamental alignment, or the alignment of the pool if it is bigger
+#define RG_PAGED_POOL_HEADER_SIZE _Alignof(max_align_t)
+#define RG_PAGED_POOL_FULL_PAGE   UINT64_MAX
+
+#define RG_SLOT_TABLE_MAX_GENERATION (UINT32_MAX >> RG_SLOT_TABLE_INDEX_BITS)
+// Marks the end of the free list
+#define RG_SLOT_TABLE_NO_FREE_SLOT UINT32_MAX
+
+// --=== Bits ===--
+
+static inline uint32_t rg_count_trailing_zeros(uint64_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (uint32_t) index;
+#else
+    return (uint32_t) __builtin_ctzll(mask);
+#endif
+}
+
+static inline uint32_t rg_count_leading_zeros(uint64_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, mask);
+    return 63 - (uint32_t) index;
+#else
+    return (uint32_t) __builtin_clzll(mask);
+#endif
+}
+
+// --=== Element search ===--
+
+/** Returns the index of the first element of the packed array that is equal to value, or SIZE_MAX if there is none. */
+static size_t rg_find_element(const void *data, size_t count, size_t element_size, const void *value)
+{
+    size_t i = 0;
+    if (element_size == sizeof(uint32_t))
+    {
+        // Most id lists hold 32-bit ids, compare 4 of them at once
+        const uint32_t *elements = data;
+        uint32_t        needle;
+        memcpy(&needle, value, sizeof(needle));
+#ifdef RG_VECTOR_USE_SSE2
+        __m128i needles = _mm_set1_epi32((int) needle);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i block = _mm_loadu_si128((const __m128i *) (elements + i));
+            int     mask  = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(block, needles)));
+            if (mask != 0)
+            {
+                return i + rg_count_trailing_zeros((uint64_t) mask);
+            }
+        }
+#endif
+        for (; i < count; i++)
+        {
+            if (elements[i] == needle)
+            {
+                return i;
+            }
+        }
+        return SIZE_MAX;
+    }
+
+    if (element_size == sizeof(uint64_t))
+    {
+        const uint64_t *elements = data;
+        uint64_t        needle;
+        memcpy(&needle, value, sizeof(needle));
+        for (; i < count; i++)
+        {
+            if (elements[i] == needle)
+            {
+                return i;
+            }
+        }
+        return SIZE_MAX;
+    }
+
+    const char *element = data;
+    for (; i < count; i++, element += element_size)
+    {
+        if (memcmp(element, value, element_size) == 0)
+        {
+            return i;
+        }
+    }
+    return SIZE_MAX;
+}
+
 // --=== Arrays ===--
 
 rg_array rg_create_array(size_t size, size_t element_size)
+{
+    return rg_create_array_with_allocator(size, element_size, NULL);
+}
+
+rg_array rg_create_array_zeroed(size_t size, size_t element_size)
+{
+    return rg_create_array_zeroed_with_allocator(size, element_size, NULL);
+}
+
+rg_array rg_create_array_with_allocator(size_t size, size_t element_size, const rg_allocator *allocator)
 {
     rg_array array = {
-        .count = size,
-        .data  = rg_malloc(size * element_size),
+        .count     = size,
+        .data      = rg_allocator_alloc(allocator, size * element_size),
+        .allocator = allocator,
     };
     assert(array.data != NULL);
     return array;
 }
 
-rg_array rg_create_array_zeroed(size_t size, size_t element_size)
+rg_array rg_create_array_zeroed_with_allocator(size_t size, size_t element_size, const rg_allocator *allocator)
+{
+    rg_array array = {
+        .count     = size,
+        .data      = rg_allocator_calloc(allocator, size, element_size),
+        .allocator = allocator,
+    };
+    assert(array.data != NULL);
+    return array;
+}
+
+rg_array rg_create_array_aligned(size_t size, size_t element_size, size_t alignment)
 {
     rg_array array = {
-        .count = size,
-        .data  = rg_calloc(size, element_size),
+        .count     = size,
+        .data      = rg_aligned_malloc(size * element_size, alignment),
+        .alignment = alignment,
     };
     assert(array.data != NULL);
     return array;
@@ -30,7 +155,14 @@ rg_array rg_create_array_zeroed(size_t size, size_t element_size)
 void rg_destroy_array(rg_array *p_array)
 {
     // Free pointer and set values to NULL
-    rg_free(p_array->data);
+    if (p_array->alignment != 0)
+    {
+        rg_aligned_free(p_array->data);
+    }
+    else
+    {
+        rg_allocator_free(p_array->allocator, p_array->data);
+    }
     p_array->data  = NULL;
     p_array->count = 0;
 }
@@ -38,13 +170,24 @@ void rg_destroy_array(rg_array *p_array)
 // --=== Vectors ===--
 
 bool rg_create_vector(size_t initial_capacity, size_t element_size, rg_vector *p_dest_vector)
+{
+    return rg_create_vector_with_allocator(initial_capacity, element_size, NULL, p_dest_vector);
+}
+
+bool rg_create_vector_with_allocator(size_t              initial_capacity,
+                                     size_t              element_size,
+                                     const rg_allocator *allocator,
+                                     rg_vector          *p_dest_vector)
 {
     // Init default fields
     p_dest_vector->capacity      = initial_capacity;
     p_dest_vector->element_size  = element_size;
-    p_dest_vector->growth_amount = 1;
+    p_dest_vector->growth_factor = RG_VECTOR_DEFAULT_GROWTH_FACTOR;
     p_dest_vector->count         = 0;
-    p_dest_vector->data          = rg_malloc(element_size * initial_capacity);
+    p_dest_vector->allocator     = allocator;
+    p_dest_vector->realloc_count = 0;
+    p_dest_vector->alignment     = 0;
+    p_dest_vector->data          = rg_allocator_alloc(allocator, element_size * initial_capacity);
 
     if (p_dest_vector->data == NULL)
     {
@@ -53,44 +196,109 @@ bool rg_create_vector(size_t initial_capacity, size_t element_size, rg_vector *p
     return true;
 }
 
+bool rg_create_vector_aligned(size_t initial_capacity, size_t element_size, size_t alignment, rg_vector *p_dest_vector)
+{
+    p_dest_vector->capacity      = initial_capacity;
+    p_dest_vector->element_size  = element_size;
+    p_dest_vector->growth_factor = RG_VECTOR_DEFAULT_GROWTH_FACTOR;
+    p_dest_vector->count         = 0;
+    p_dest_vector->allocator     = NULL;
+    p_dest_vector->realloc_count = 0;
+    p_dest_vector->alignment     = alignment;
+    p_dest_vector->data          = rg_aligned_malloc(element_size * initial_capacity, alignment);
+
+    return p_dest_vector->data != NULL;
+}
+
 void rg_destroy_vector(rg_vector *p_vector)
 {
     p_vector->capacity = 0;
     p_vector->count    = 0;
-    rg_free(p_vector->data);
+    if (p_vector->alignment != 0)
+    {
+        rg_aligned_free(p_vector->data);
+    }
+    else
+    {
+        rg_allocator_free(p_vector->allocator, p_vector->data);
+    }
     p_vector->data = NULL;
 }
 
-void rg_vector_ensure_capacity(rg_vector *p_vector, size_t required_minimum_capacity)
+/** Reallocates the data with the given capacity. If it fails, the vector is unchanged. */
+static bool rg_vector_reallocate(rg_vector *p_vector, size_t new_capacity)
 {
-    // Resize if smaller than required capacity
-    if (p_vector->capacity < required_minimum_capacity)
+    void *new_data;
+    if (p_vector->alignment != 0)
     {
-        // Grow with the growth amount, except if it does not reach the required capacity
-        size_t new_capacity = p_vector->count + p_vector->growth_amount;
-        if (required_minimum_capacity > new_capacity)
-        {
-            new_capacity = required_minimum_capacity;
-        }
-        else
-        {
-            // Multiply the growth amount, that way the more we push in a vector, the more it will try to anticipate
-            // Same behavior as cpp vector
-            p_vector->growth_amount *= 2;
-        }
+        new_data = rg_aligned_realloc(p_vector->data, new_capacity * p_vector->element_size, p_vector->alignment);
+    }
+    else
+    {
+        new_data = rg_allocator_realloc(p_vector->allocator,
+                                        p_vector->data,
+                                        p_vector->capacity * p_vector->element_size,
+                                        new_capacity * p_vector->element_size);
+    }
+    if (new_data == NULL)
+    {
+        return false;
+    }
+    p_vector->data     = new_data;
+    p_vector->capacity = new_capacity;
+    p_vector->realloc_count++;
+    return true;
+}
 
-        p_vector->data     = rg_realloc(p_vector->data, new_capacity * p_vector->element_size);
-        p_vector->capacity = new_capacity;
+bool rg_vector_ensure_capacity(rg_vector *p_vector, size_t required_minimum_capacity)
+{
+    if (p_vector->capacity >= required_minimum_capacity)
+    {
+        return true;
+    }
 
+    // Grow geometrically, so that a sequence of pushes or extensions only reallocates O(log n) times
+    // A big extension can require more than that, then there is no need to anticipate further
+    float  growth_factor = p_vector->growth_factor > 0.0f ? p_vector->growth_factor : RG_VECTOR_DEFAULT_GROWTH_FACTOR;
+    size_t new_capacity  = (size_t) ((double) p_vector->capacity * growth_factor);
+    if (new_capacity <= p_vector->capacity)
+    {
+        // Small capacities must grow by at least one element
+        new_capacity = p_vector->capacity + 1;
+    }
+    if (new_capacity < required_minimum_capacity)
+    {
+        new_capacity = required_minimum_capacity;
     }
+    return rg_vector_reallocate(p_vector, new_capacity);
+}
 
+bool rg_vector_reserve(rg_vector *p_vector, size_t capacity)
+{
+    return p_vector->capacity >= capacity || rg_vector_reallocate(p_vector, capacity);
+}
+
+void rg_vector_set_growth_factor(rg_vector *p_vector, float growth_factor)
+{
+    if (growth_factor < RG_VECTOR_MIN_GROWTH_FACTOR)
+    {
+        growth_factor = RG_VECTOR_MIN_GROWTH_FACTOR;
+    }
+    else if (growth_factor > RG_VECTOR_MAX_GROWTH_FACTOR)
+    {
+        growth_factor = RG_VECTOR_MAX_GROWTH_FACTOR;
+    }
+    p_vector->growth_factor = growth_factor;
 }
 
 void *rg_vector_push_back(rg_vector *p_vector, void *p_data)
 {
     // Make sure that there is enough room in the allocation for this new p_data
     size_t new_count = p_vector->count + 1;
-    rg_vector_ensure_capacity(p_vector, new_count);
+    if (!rg_vector_ensure_capacity(p_vector, new_count))
+    {
+        return NULL;
+    }
 
     // Add the p_data:
     void *p_element = ((char *) p_vector->data) + (p_vector->count * p_vector->element_size);
@@ -113,7 +321,10 @@ void *rg_vector_push_back_no_data(rg_vector *p_vector)
 
     // Make sure that there is enough room in the allocation for this new p_data
     size_t new_count = p_vector->count + 1;
-    rg_vector_ensure_capacity(p_vector, new_count);
+    if (!rg_vector_ensure_capacity(p_vector, new_count))
+    {
+        return NULL;
+    }
 
     void *p_element = ((char *) p_vector->data) + (p_vector->count * p_vector->element_size);
 
@@ -218,9 +429,24 @@ void rg_vector_clear(rg_vector *p_vector)
     p_vector->count = 0;
 }
 
+bool rg_vector_shrink_to_fit(rg_vector *p_vector)
+{
+    // Keep at least one element, so that the vector stays allocated
+    size_t new_capacity = p_vector->count > 0 ? p_vector->count : 1;
+    if (new_capacity >= p_vector->capacity)
+    {
+        return true;
+    }
+
+    return rg_vector_reallocate(p_vector, new_capacity);
+}
+
 void *rg_vector_extend(rg_vector *vector, void* data, size_t count) {
     // Ensure that the vector is big enough to hold the new data
-    rg_vector_ensure_capacity(vector, vector->count + count);
+    if (!rg_vector_ensure_capacity(vector, vector->count + count))
+    {
+        return NULL;
+    }
 
     // Add the values
     void *element = ((char *) vector->data) + (vector->count * vector->element_size);
@@ -231,4 +457,677 @@ void *rg_vector_extend(rg_vector *vector, void* data, size_t count) {
         return element;
     }
     return NULL;
-}
\ No newline at end of file
+}
+
+void *rg_vector_insert_range(rg_vector *p_vector, size_t pos, const void *data, size_t count)
+{
+    if (pos > p_vector->count || !rg_vector_ensure_capacity(p_vector, p_vector->count + count))
+    {
+        return NULL;
+    }
+
+    // Shift the tail in a single move to open the gap
+    char *gap = (char *) p_vector->data + pos * p_vector->element_size;
+    memmove(gap + count * p_vector->element_size, gap, (p_vector->count - pos) * p_vector->element_size);
+    if (data != NULL)
+    {
+        memcpy(gap, data, count * p_vector->element_size);
+    }
+    p_vector->count += count;
+    return gap;
+}
+
+bool rg_vector_erase_range(rg_vector *p_vector, size_t pos, size_t count)
+{
+    if (pos > p_vector->count || count > p_vector->count - pos)
+    {
+        return false;
+    }
+
+    // Shift the tail in a single move to close the gap
+    char *gap = (char *) p_vector->data + pos * p_vector->element_size;
+    memmove(gap, gap + count * p_vector->element_size, (p_vector->count - pos - count) * p_vector->element_size);
+    p_vector->count -= count;
+    return true;
+}
+
+bool rg_vector_copy_range(rg_vector *p_vector, size_t srcPos, size_t dstPos, size_t count)
+{
+    if (srcPos > p_vector->count || count > p_vector->count - srcPos || dstPos > p_vector->count || count > p_vector->count - dstPos)
+    {
+        return false;
+    }
+
+    char *data = p_vector->data;
+    memmove(data + dstPos * p_vector->element_size, data + srcPos * p_vector->element_size, count * p_vector->element_size);
+    return true;
+}
+
+bool rg_vector_swap_remove(rg_vector *p_vector, size_t pos)
+{
+    if (pos >= p_vector->count)
+    {
+        return false;
+    }
+
+    size_t last_index = p_vector->count - 1;
+    if (pos < last_index)
+    {
+        char *data = p_vector->data;
+        memcpy(data + pos * p_vector->element_size, data + last_index * p_vector->element_size, p_vector->element_size);
+    }
+    p_vector->count--;
+    return true;
+}
+
+size_t rg_vector_find(const rg_vector *p_vector, const void *p_value)
+{
+    return rg_find_element(p_vector->data, p_vector->count, p_vector->element_size, p_value);
+}
+
+bool rg_vector_resize(rg_vector *p_vector, size_t new_count)
+{
+    if (new_count > p_vector->count)
+    {
+        if (!rg_vector_ensure_capacity(p_vector, new_count))
+        {
+            return false;
+        }
+        memset((char *) p_vector->data + p_vector->count * p_vector->element_size,
+               0,
+               (new_count - p_vector->count) * p_vector->element_size);
+    }
+    p_vector->count = new_count;
+    return true;
+}
+
+// --=== Small vectors ===--
+
+/** The inline elements are declared right after the vector by RG_SMALL_VECTOR. */
+static inline void *rg_small_vector_inline_data(rg_small_vector *p_vector)
+{
+    return (char *) p_vector + sizeof(rg_small_vector);
+}
+
+/** Moves the elements to a bigger heap storage. If it fails, the vector is unchanged. */
+static bool rg_small_vector_grow(rg_small_vector *p_vector, size_t required_capacity)
+{
+    if (required_capacity > UINT32_MAX)
+    {
+        return false;
+    }
+
+    size_t new_capacity = (size_t) ((double) p_vector->capacity * RG_VECTOR_DEFAULT_GROWTH_FACTOR);
+    if (new_capacity < required_capacity)
+    {
+        new_capacity = required_capacity;
+    }
+    if (new_capacity > UINT32_MAX)
+    {
+        new_capacity = UINT32_MAX;
+    }
+
+    void *new_data;
+    if (p_vector->heap_data == NULL)
+    {
+        // First overflow: the inline elements are copied in the new storage
+        new_data = rg_allocator_alloc(p_vector->allocator, new_capacity * p_vector->element_size);
+        if (new_data == NULL)
+        {
+            return false;
+        }
+        memcpy(new_data, rg_small_vector_inline_data(p_vector), (size_t) p_vector->count * p_vector->element_size);
+    }
+    else
+    {
+        new_data = rg_allocator_realloc(p_vector->allocator,
+                                        p_vector->heap_data,
+                                        (size_t) p_vector->capacity * p_vector->element_size,
+                                        new_capacity * p_vector->element_size);
+        if (new_data == NULL)
+        {
+            return false;
+        }
+    }
+    p_vector->heap_data = new_data;
+    p_vector->capacity  = (uint32_t) new_capacity;
+    return true;
+}
+
+void rg_create_small_vector(size_t element_size, size_t inline_capacity, rg_small_vector *p_dest_vector)
+{
+    rg_create_small_vector_with_allocator(element_size, inline_capacity, NULL, p_dest_vector);
+}
+
+void rg_create_small_vector_with_allocator(size_t              element_size,
+                                           size_t              inline_capacity,
+                                           const rg_allocator *allocator,
+                                           rg_small_vector    *p_dest_vector)
+{
+    p_dest_vector->count           = 0;
+    p_dest_vector->capacity        = (uint32_t) inline_capacity;
+    p_dest_vector->element_size    = (uint32_t) element_size;
+    p_dest_vector->inline_capacity = (uint32_t) inline_capacity;
+    p_dest_vector->heap_data       = NULL;
+    p_dest_vector->allocator       = allocator;
+}
+
+void rg_destroy_small_vector(rg_small_vector *p_vector)
+{
+    if (p_vector->heap_data != NULL)
+    {
+        rg_allocator_free(p_vector->allocator, p_vector->heap_data);
+        p_vector->heap_data = NULL;
+    }
+    p_vector->count    = 0;
+    p_vector->capacity = p_vector->inline_capacity;
+}
+
+void *rg_small_vector_data(rg_small_vector *p_vector)
+{
+    return p_vector->heap_data != NULL ? p_vector->heap_data : rg_small_vector_inline_data(p_vector);
+}
+
+void *rg_small_vector_push_back(rg_small_vector *p_vector, const void *p_data)
+{
+    void *p_element = rg_small_vector_push_back_no_data(p_vector);
+    if (p_element != NULL)
+    {
+        memcpy(p_element, p_data, p_vector->element_size);
+    }
+    return p_element;
+}
+
+void *rg_small_vector_push_back_no_data(rg_small_vector *p_vector)
+{
+    if (p_vector->count == p_vector->capacity && !rg_small_vector_grow(p_vector, (size_t) p_vector->count + 1))
+    {
+        return NULL;
+    }
+
+    void *p_element = (char *) rg_small_vector_data(p_vector) + (size_t) p_vector->count * p_vector->element_size;
+    p_vector->count++;
+    return p_element;
+}
+
+void rg_small_vector_pop_back(rg_small_vector *p_vector)
+{
+    if (p_vector->count > 0)
+    {
+        p_vector->count--;
+    }
+}
+
+void *rg_small_vector_get_element(rg_small_vector *p_vector, size_t pos)
+{
+    if (pos >= p_vector->count)
+    {
+        return NULL;
+    }
+    return (char *) rg_small_vector_data(p_vector) + pos * p_vector->element_size;
+}
+
+bool rg_small_vector_copy(rg_small_vector *p_vector, size_t srcPos, size_t dstPos)
+{
+    if (srcPos >= p_vector->count || dstPos >= p_vector->count)
+    {
+        return false;
+    }
+
+    char *data = rg_small_vector_data(p_vector);
+    memcpy(data + dstPos * p_vector->element_size, data + srcPos * p_vector->element_size, p_vector->element_size);
+    return true;
+}
+
+bool rg_small_vector_swap_remove(rg_small_vector *p_vector, size_t pos)
+{
+    if (pos >= p_vector->count)
+    {
+        return false;
+    }
+
+    size_t last_index = p_vector->count - 1;
+    if (pos < last_index)
+    {
+        rg_small_vector_copy(p_vector, last_index, pos);
+    }
+    p_vector->count--;
+    return true;
+}
+
+size_t rg_small_vector_find(rg_small_vector *p_vector, const void *p_value)
+{
+    return rg_find_element(rg_small_vector_data(p_vector), p_vector->count, p_vector->element_size, p_value);
+}
+
+void rg_small_vector_clear(rg_small_vector *p_vector)
+{
+    p_vector->count = 0;
+}
+
+void *rg_small_vector_extend(rg_small_vector *p_vector, const void *data, size_t count)
+{
+    size_t new_count = (size_t) p_vector->count + count;
+    if (new_count > p_vector->capacity && !rg_small_vector_grow(p_vector, new_count))
+    {
+        return NULL;
+    }
+
+    void *p_element = (char *) rg_small_vector_data(p_vector) + (size_t) p_vector->count * p_vector->element_size;
+    memcpy(p_element, data, count * p_vector->element_size);
+    p_vector->count = (uint32_t) new_count;
+    return p_element;
+}
+
+rg_small_vector_it rg_small_vector_iterator(rg_small_vector *p_vector)
+{
+    return (rg_small_vector_it) {
+        .index  = -1,
+        .vector = p_vector,
+    };
+}
+
+bool rg_small_vector_next(rg_small_vector_it *it)
+{
+    it->index++;
+
+    rg_small_vector *vec = it->vector;
+    if (it->index < vec->count)
+    {
+        it->value = (char *) rg_small_vector_data(vec) + it->index * vec->element_size;
+        return true;
+    }
+
+    it->value = NULL;
+    return false;
+}
+
+// --=== Compaction ===--
+
+static int rg_compare_places(const void *p_a, const void *p_b)
+{
+    size_t a = *(const size_t *) p_a;
+    size_t b = *(const size_t *) p_b;
+    return (a > b) - (a < b);
+}
+
+/** Compaction for a few erasures: sort them, then fill the holes from the end. */
+static void rg_compact_sorted_places(size_t                      count,
+                                     size_t                     *places,
+                                     size_t                      erased_count,
+                                     rg_compaction_move_function pfn_move,
+                                     void                       *user_data)
+{
+    qsort(places, erased_count, sizeof(size_t), rg_compare_places);
+
+    size_t new_count     = count - erased_count;
+    size_t tail          = count;
+    size_t tail_erasures = erased_count;
+    for (size_t i = 0; i < erased_count && places[i] < new_count; i++)
+    {
+        // Find the last remaining element, skipping the erased ones at the end
+        tail--;
+        while (tail_erasures > 0 && places[tail_erasures - 1] == tail)
+        {
+            tail_erasures--;
+            tail--;
+        }
+        pfn_move(tail, places[i], user_data);
+    }
+}
+
+/** Compaction for a lot of erasures: a bitmap of the erased places is cheaper than a sort. */
+static bool rg_compact_marked_places(size_t                      count,
+                                     const size_t               *places,
+                                     size_t                      erased_count,
+                                     rg_compaction_move_function pfn_move,
+                                     void                       *user_data,
+                                     const rg_allocator         *allocator)
+{
+    size_t    word_count = (count + 63) / 64;
+    uint64_t *erased     = rg_allocator_calloc(allocator, word_count, sizeof(uint64_t));
+    if (erased == NULL)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < erased_count; i++)
+    {
+        erased[places[i] / 64] |= 1ULL << (places[i] % 64);
+    }
+
+    // The holes are the erased places below the new count, and the moved elements are the remaining ones above it
+    // Walk the holes upwards and the remaining elements downwards, a word at a time
+    size_t   new_count  = count - erased_count;
+    size_t   hole_word  = 0;
+    uint64_t holes      = erased[0];
+    size_t   tail_word  = word_count - 1;
+    uint64_t tail_valid = count % 64 == 0 ? UINT64_MAX : (1ULL << (count % 64)) - 1;
+    uint64_t remaining  = ~erased[tail_word] & tail_valid;
+    while (true)
+    {
+        while (holes == 0)
+        {
+            hole_word++;
+            if (hole_word >= word_count)
+            {
+                break;
+            }
+            holes = erased[hole_word];
+        }
+        if (hole_word >= word_count)
+        {
+            break;
+        }
+        size_t hole = hole_word * 64 + rg_count_trailing_zeros(holes);
+        if (hole >= new_count)
+        {
+            break;
+        }
+        holes &= holes - 1;
+
+        // There are as many remaining elements above the new count as holes below it, so one is always found
+        while (remaining == 0)
+        {
+            tail_word--;
+            remaining = ~erased[tail_word];
+        }
+        uint32_t bit = 63 - rg_count_leading_zeros(remaining);
+        remaining &= ~(1ULL << bit);
+        pfn_move(tail_word * 64 + bit, hole, user_data);
+    }
+
+    rg_allocator_free(allocator, erased);
+    return true;
+}
+
+size_t rg_compact_places(size_t                      count,
+                         size_t                     *places,
+                         size_t                      erased_count,
+                         rg_compaction_move_function pfn_move,
+                         void                       *user_data,
+                         const rg_allocator         *allocator)
+{
+    if (erased_count == 0)
+    {
+        return count;
+    }
+
+    // A sort costs about log2(erased_count) operations per erasure, and the bitmap about one per 64 elements
+    // The sort doesn't allocate, so it is also used if the bitmap can't be allocated
+    size_t log2_erased_count = 64 - rg_count_leading_zeros(erased_count);
+    if (erased_count * log2_erased_count * 64 < count
+        || !rg_compact_marked_places(count, places, erased_count, pfn_move, user_data, allocator))
+    {
+        rg_compact_sorted_places(count, places, erased_count, pfn_move, user_data);
+    }
+    return count - erased_count;
+}
+
+// --=== Paged pools ===--
+
+/** The occupancy mask of a page is its first word: the bit i is set if the element i is used. */
+static inline uint64_t *rg_paged_pool_page(rg_paged_pool *p_pool, size_t page_index)
+{
+    return ((uint64_t **) p_pool->pages.data)[page_index];
+}
+
+static inline size_t rg_paged_pool_header_size(const rg_paged_pool *p_pool)
+{
+    return p_pool->alignment != 0 ? p_pool->alignment : RG_PAGED_POOL_HEADER_SIZE;
+}
+
+static inline void *rg_paged_pool_element(rg_paged_pool *p_pool, uint64_t *page, size_t index_in_page)
+{
+    return (char *) page + rg_paged_pool_header_size(p_pool) + index_in_page * p_pool->element_stride;
+}
+
+static void rg_paged_pool_free_page(rg_paged_pool *p_pool, uint64_t *page)
+{
+    if (p_pool->alignment != 0)
+    {
+        rg_aligned_free(page);
+    }
+    else
+    {
+        rg_allocator_free(p_pool->pages.allocator, page);
+    }
+}
+
+/** Allocates a new empty page at the end of the pool. */
+static bool rg_paged_pool_add_page(rg_paged_pool *p_pool)
+{
+    // The pages are allocated with the same allocator as the vector of their pointers, unless they need a bigger alignment
+    size_t    page_size = rg_paged_pool_header_size(p_pool) + RG_PAGED_POOL_PAGE_CAPACITY * p_pool->element_stride;
+    uint64_t *page      = p_pool->alignment != 0 ? rg_aligned_malloc(page_size, p_pool->alignment)
+                                                 : rg_allocator_alloc(p_pool->pages.allocator, page_size);
+    if (page == NULL)
+    {
+        return false;
+    }
+    *page = 0;
+
+    uint64_t **p_page = rg_vector_push_back_no_data(&p_pool->pages);
+    if (p_page == NULL)
+    {
+        rg_paged_pool_free_page(p_pool, page);
+        return false;
+    }
+    *p_page = page;
+    return true;
+}
+
+bool rg_create_paged_pool(size_t element_size, size_t element_alignment, rg_paged_pool *p_dest_pool)
+{
+    return rg_create_paged_pool_with_allocator(element_size, element_alignment, NULL, p_dest_pool);
+}
+
+bool rg_create_paged_pool_with_allocator(size_t              element_size,
+                                         size_t              element_alignment,
+                                         const rg_allocator *allocator,
+                                         rg_paged_pool      *p_dest_pool)
+{
+    if (element_alignment == 0)
+    {
+        element_alignment = 1;
+    }
+    if ((element_alignment & (element_alignment - 1)) != 0)
+    {
+        return false;
+    }
+
+    // The allocators only guarantee the fundamental alignment, so the pages that need more are allocated on the heap
+    bool over_aligned = element_alignment > _Alignof(max_align_t);
+    if (over_aligned && allocator != NULL)
+    {
+        return false;
+    }
+
+    p_dest_pool->count           = 0;
+    p_dest_pool->element_stride  = (element_size + element_alignment - 1) & ~(element_alignment - 1);
+    p_dest_pool->first_free_page = 0;
+    p_dest_pool->alignment       = over_aligned ? element_alignment : 0;
+    return rg_create_vector_with_allocator(2, sizeof(uint64_t *), allocator, &p_dest_pool->pages);
+}
+
+void rg_destroy_paged_pool(rg_paged_pool *p_pool)
+{
+    for (size_t i = 0; i < p_pool->pages.count; i++)
+    {
+        rg_paged_pool_free_page(p_pool, rg_paged_pool_page(p_pool, i));
+    }
+    rg_destroy_vector(&p_pool->pages);
+    p_pool->count           = 0;
+    p_pool->first_free_page = 0;
+}
+
+void *rg_paged_pool_acquire(rg_paged_pool *p_pool, size_t *p_index)
+{
+    // Skip the full pages
+    while (p_pool->first_free_page < p_pool->pages.count
+           && *rg_paged_pool_page(p_pool, p_pool->first_free_page) == RG_PAGED_POOL_FULL_PAGE)
+    {
+        p_pool->first_free_page++;
+    }
+    if (p_pool->first_free_page == p_pool->pages.count && !rg_paged_pool_add_page(p_pool))
+    {
+        return NULL;
+    }
+
+    // Take the first free element of the page
+    uint64_t *page          = rg_paged_pool_page(p_pool, p_pool->first_free_page);
+    uint32_t  index_in_page = rg_count_trailing_zeros(~*page);
+    *page |= 1ULL << index_in_page;
+    p_pool->count++;
+
+    *p_index = p_pool->first_free_page * RG_PAGED_POOL_PAGE_CAPACITY + index_in_page;
+    return rg_paged_pool_element(p_pool, page, index_in_page);
+}
+
+void rg_paged_pool_release(rg_paged_pool *p_pool, size_t index)
+{
+    size_t    page_index = index / RG_PAGED_POOL_PAGE_CAPACITY;
+    uint64_t  bit        = 1ULL << (index % RG_PAGED_POOL_PAGE_CAPACITY);
+    uint64_t *page       = rg_paged_pool_page(p_pool, page_index);
+    if ((*page & bit) == 0)
+    {
+        return;
+    }
+
+    *page &= ~bit;
+    p_pool->count--;
+    if (page_index < p_pool->first_free_page)
+    {
+        p_pool->first_free_page = page_index;
+    }
+}
+
+void *rg_paged_pool_get(rg_paged_pool *p_pool, size_t index)
+{
+    uint64_t *page = rg_paged_pool_page(p_pool, index / RG_PAGED_POOL_PAGE_CAPACITY);
+    return rg_paged_pool_element(p_pool, page, index % RG_PAGED_POOL_PAGE_CAPACITY);
+}
+
+void *rg_paged_pool_next(rg_paged_pool *p_pool, size_t *p_index)
+{
+    size_t page_index = *p_index / RG_PAGED_POOL_PAGE_CAPACITY;
+    if (page_index >= p_pool->pages.count)
+    {
+        return NULL;
+    }
+
+    // Ignore the elements before the index in the first page
+    uint64_t *page          = rg_paged_pool_page(p_pool, page_index);
+    uint64_t  occupied_mask = *page & (RG_PAGED_POOL_FULL_PAGE << (*p_index % RG_PAGED_POOL_PAGE_CAPACITY));
+    while (occupied_mask == 0)
+    {
+        page_index++;
+        if (page_index >= p_pool->pages.count)
+        {
+            return NULL;
+        }
+        page          = rg_paged_pool_page(p_pool, page_index);
+        occupied_mask = *page;
+    }
+
+    uint32_t index_in_page = rg_count_trailing_zeros(occupied_mask);
+    *p_index               = page_index * RG_PAGED_POOL_PAGE_CAPACITY + index_in_page;
+    return rg_paged_pool_element(p_pool, page, index_in_page);
+}
+
+bool rg_paged_pool_reserve(rg_paged_pool *p_pool, size_t count)
+{
+    size_t page_count = (count + RG_PAGED_POOL_PAGE_CAPACITY - 1) / RG_PAGED_POOL_PAGE_CAPACITY;
+    while (p_pool->pages.count < page_count)
+    {
+        if (!rg_paged_pool_add_page(p_pool))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool rg_paged_pool_shrink_to_fit(rg_paged_pool *p_pool)
+{
+    while (p_pool->pages.count > 0 && *rg_paged_pool_page(p_pool, rg_vector_last_index(&p_pool->pages)) == 0)
+    {
+        rg_paged_pool_free_page(p_pool, rg_paged_pool_page(p_pool, rg_vector_last_index(&p_pool->pages)));
+        rg_vector_pop_back(&p_pool->pages);
+    }
+    if (p_pool->first_free_page > p_pool->pages.count)
+    {
+        p_pool->first_free_page = p_pool->pages.count;
+    }
+    return rg_vector_shrink_to_fit(&p_pool->pages);
+}
+
+// --=== Slot tables ===--
+
+static inline uint32_t rg_slot_table_next_generation(uint32_t generation)
+{
+    return (generation + 1) & RG_SLOT_TABLE_MAX_GENERATION;
+}
+
+bool rg_create_slot_table(const rg_allocator *allocator, rg_slot_table *p_dest_table)
+{
+    p_dest_table->first_free_slot = RG_SLOT_TABLE_NO_FREE_SLOT;
+    return rg_create_vector_with_allocator(2, sizeof(rg_slot), allocator, &p_dest_table->slots);
+}
+
+void rg_destroy_slot_table(rg_slot_table *p_table)
+{
+    rg_destroy_vector(&p_table->slots);
+    p_table->first_free_slot = RG_SLOT_TABLE_NO_FREE_SLOT;
+}
+
+uint32_t rg_slot_table_prepare(rg_slot_table *p_table)
+{
+    // Reuse a free slot if there is one, otherwise create a new one
+    if (p_table->first_free_slot == RG_SLOT_TABLE_NO_FREE_SLOT)
+    {
+        if (p_table->slots.count > RG_SLOT_TABLE_INDEX_MASK)
+        {
+            return RG_SLOT_TABLE_NULL_ID;
+        }
+        rg_slot *new_slot = rg_vector_push_back_no_data(&p_table->slots);
+        if (new_slot == NULL)
+        {
+            return RG_SLOT_TABLE_NULL_ID;
+        }
+
+        // The generation 0 is even, so the new slot is free
+        new_slot->generation     = 0;
+        new_slot->value          = RG_SLOT_TABLE_NO_FREE_SLOT;
+        p_table->first_free_slot = (uint32_t) rg_vector_last_index(&p_table->slots);
+    }
+
+    uint32_t       slot_index = p_table->first_free_slot;
+    const rg_slot *slot       = (const rg_slot *) p_table->slots.data + slot_index;
+    return (rg_slot_table_next_generation(slot->generation) << RG_SLOT_TABLE_INDEX_BITS) | slot_index;
+}
+
+uint32_t rg_slot_table_acquire(rg_slot_table *p_table, uint32_t value)
+{
+    uint32_t id = rg_slot_table_prepare(p_table);
+    if (id == RG_SLOT_TABLE_NULL_ID)
+    {
+        return RG_SLOT_TABLE_NULL_ID;
+    }
+
+    // Remove the slot from the free list and mark it as used
+    rg_slot *slot            = (rg_slot *) p_table->slots.data + rg_slot_table_index(id);
+    p_table->first_free_slot = slot->value;
+    slot->value              = value;
+    slot->generation         = id >> RG_SLOT_TABLE_INDEX_BITS;
+    return id;
+}
+
+void rg_slot_table_release(rg_slot_table *p_table, uint32_t id)
+{
+    // Invalidate the id and put the slot in the free list
+    uint32_t slot_index      = rg_slot_table_index(id);
+    rg_slot *slot            = (rg_slot *) p_table->slots.data + slot_index;
+    slot->generation         = rg_slot_table_next_generation(slot->generation);
+    slot->value              = p_table->first_free_slot;
+    p_table->first_free_slot = slot_index;
+}
@@ -0,0 +1,277 @@
+#include "railguard/utils/column_store.h"
+
+#include <railguard/utils/arrays.h>
+#include <railguard/utils/memory.h>
+
+#include <string.h>
+
+// --=== Type Definitions ===--
+
+typedef struct rg_column_store
+{
+    // ids[i] is the id of the row i, so that the slot of the last row can be updated when it is moved by an erasure
+    rg_vector ids;
+    // The value of a used slot is the row of its element
+    rg_slot_table slots;
+    size_t        column_count;
+    // One packed vector per column, all with the same count as the ids
+    rg_vector columns[];
+} rg_column_store;
+
+// --=== Utils functions ===--
+
+/** Returns the row of the id, or UINT32_MAX if it doesn't exist (anymore). */
+static inline uint32_t rg_column_store_find(const rg_column_store *store, rg_column_store_id id)
+{
+    return rg_slot_table_find(&store->slots, id);
+}
+
+// --=== Functions ===--
+
+rg_column_store *rg_create_column_store(size_t column_count, const size_t *column_sizes)
+{
+    return rg_create_column_store_with_allocator(column_count, column_sizes, NULL);
+}
+
+rg_column_store *rg_create_column_store_with_allocator(size_t column_count, const size_t *column_sizes, const rg_allocator *allocator)
+{
+    if (column_count == 0 || column_sizes == NULL)
+    {
+        return NULL;
+    }
+
+    rg_column_store *store = rg_allocator_calloc(allocator, 1, sizeof(rg_column_store) + column_count * sizeof(rg_vector));
+    if (store == NULL)
+    {
+        return NULL;
+    }
+
+    // The allocator is kept by the vectors, so it can be found again when the store is destroyed
+    if (!rg_create_vector_with_allocator(2, sizeof(rg_column_store_id), allocator, &store->ids))
+    {
+        rg_allocator_free(allocator, store);
+        return NULL;
+    }
+    if (!rg_create_slot_table(allocator, &store->slots))
+    {
+        rg_destroy_vector(&store->ids);
+        rg_allocator_free(allocator, store);
+        return NULL;
+    }
+
+    // The column count is only set once the column is created, so that the store can be destroyed if one of them fails
+    for (size_t i = 0; i < column_count; i++)
+    {
+        if (column_sizes[i] == 0 || !rg_create_vector_with_allocator(2, column_sizes[i], allocator, &store->columns[i]))
+        {
+            rg_destroy_column_store(&store);
+            return NULL;
+        }
+        store->column_count++;
+    }
+
+    return store;
+}
+
+void rg_destroy_column_store(rg_column_store **p_store)
+{
+    if (p_store == NULL || *p_store == NULL)
+    {
+        return;
+    }
+
+    rg_column_store    *store     = *p_store;
+    const rg_allocator *allocator = store->ids.allocator;
+    for (size_t i = 0; i < store->column_count; i++)
+    {
+        rg_destroy_vector(&store->columns[i]);
+    }
+    rg_destroy_vector(&store->ids);
+    rg_destroy_slot_table(&store->slots);
+
+    rg_allocator_free(allocator, store);
+    *p_store = NULL;
+}
+
+rg_column_store_id rg_column_store_push(rg_column_store *store, const void *const *values)
+{
+    if (store == NULL)
+    {
+        return RG_COLUMN_STORE_NULL_ID;
+    }
+
+    // Get the id of a free slot, but only take the slot when nothing can fail anymore
+    rg_column_store_id id = rg_slot_table_prepare(&store->slots);
+    if (id == RG_SLOT_TABLE_NULL_ID)
+    {
+        return RG_COLUMN_STORE_NULL_ID;
+    }
+
+    // Add the row at the end of every column
+    rg_column_store_id *p_id = rg_vector_push_back_no_data(&store->ids);
+    if (p_id == NULL)
+    {
+        return RG_COLUMN_STORE_NULL_ID;
+    }
+    *p_id = id;
+    for (size_t i = 0; i < store->column_count; i++)
+    {
+        void *value = rg_vector_push_back_no_data(&store->columns[i]);
+        if (value == NULL)
+        {
+            // Remove the row from the columns where it was already added
+            for (size_t j = 0; j < i; j++)
+            {
+                rg_vector_pop_back(&store->columns[j]);
+            }
+            rg_vector_pop_back(&store->ids);
+            return RG_COLUMN_STORE_NULL_ID;
+        }
+
+        size_t element_size = store->columns[i].element_size;
+        if (values != NULL && values[i] != NULL)
+        {
+            memcpy(value, values[i], element_size);
+        }
+        else
+        {
+            memset(value, 0, element_size);
+        }
+    }
+
+    return rg_slot_table_acquire(&store->slots, (uint32_t) rg_vector_last_index(&store->ids));
+}
+
+void rg_column_store_erase(rg_column_store *store, rg_column_store_id id)
+{
+    if (store == NULL)
+    {
+        return;
+    }
+    uint32_t row = rg_column_store_find(store, id);
+    if (row == UINT32_MAX)
+    {
+        return;
+    }
+
+    // Move the last row in the hole to keep the columns packed, and update its slot
+    uint32_t last_row = (uint32_t) rg_vector_last_index(&store->ids);
+    if (row < last_row)
+    {
+        for (size_t i = 0; i < store->column_count; i++)
+        {
+            rg_vector_copy(&store->columns[i], last_row, row);
+        }
+        rg_vector_copy(&store->ids, last_row, row);
+
+        rg_column_store_id moved_id = ((rg_column_store_id *) store->ids.data)[row];
+        rg_slot_table_set_value(&store->slots, moved_id, row);
+    }
+    for (size_t i = 0; i < store->column_count; i++)
+    {
+        rg_vector_pop_back(&store->columns[i]);
+    }
+    rg_vector_pop_back(&store->ids);
+
+    rg_slot_table_release(&store->slots, id);
+}
+
+bool rg_column_store_exists(rg_column_store *store, rg_column_store_id id)
+{
+    return store != NULL && rg_column_store_find(store, id) != UINT32_MAX;
+}
+
+size_t rg_column_store_count(rg_column_store *store)
+{
+    return store != NULL ? store->ids.count : 0;
+}
+
+size_t rg_column_store_column_count(rg_column_store *store)
+{
+    return store != NULL ? store->column_count : 0;
+}
+
+size_t rg_column_store_row(rg_column_store *store, rg_column_store_id id)
+{
+    if (store == NULL)
+    {
+        return SIZE_MAX;
+    }
+    uint32_t row = rg_column_store_find(store, id);
+    return row != UINT32_MAX ? row : SIZE_MAX;
+}
+
+void *rg_column_store_get(rg_column_store *store, rg_column_store_id id, size_t column)
+{
+    if (store == NULL || column >= store->column_count)
+    {
+        return NULL;
+    }
+    uint32_t row = rg_column_store_find(store, id);
+    if (row == UINT32_MAX)
+    {
+        return NULL;
+    }
+    return (char *) store->columns[column].data + (size_t) row * store->columns[column].element_size;
+}
+
+void *rg_column_store_column(rg_column_store *store, size_t column)
+{
+    if (store == NULL || column >= store->column_count)
+    {
+        return NULL;
+    }
+    return store->columns[column].data;
+}
+
+const rg_column_store_id *rg_column_store_ids(rg_column_store *store)
+{
+    return store != NULL ? store->ids.data : NULL;
+}
+
+bool rg_column_store_reserve(rg_column_store *store, size_t count)
+{
+    if (store == NULL)
+    {
+        return false;
+    }
+
+    bool success = rg_vector_reserve(&store->ids, count);
+    for (size_t i = 0; i < store->column_count && success; i++)
+    {
+        success = rg_vector_reserve(&store->columns[i], count);
+    }
+    return success;
+}
+
+rg_column_store_it rg_column_store_iterator(rg_column_store *store, size_t column)
+{
+    if (store == NULL || column >= store->column_count)
+    {
+        return (rg_column_store_it) {0};
+    }
+
+    return (rg_column_store_it) {
+        .store  = store,
+        .column = column,
+    };
+}
+
+bool rg_column_store_next(rg_column_store_it *it)
+{
+    if (it == NULL || it->store == NULL || it->next_row >= it->store->ids.count)
+    {
+        if (it != NULL)
+        {
+            it->id    = RG_COLUMN_STORE_NULL_ID;
+            it->value = NULL;
+        }
+        return false;
+    }
+
+    rg_vector *column = &it->store->columns[it->column];
+    it->id            = ((rg_column_store_id *) it->store->ids.data)[it->next_row];
+    it->value         = (char *) column->data + it->next_row * column->element_size;
+    it->next_row++;
+    return true;
+}
@@ -6,137 +6,1232 @@
 #include <stdint.h>
 #include <string.h>
 
+// Use SSE2 to match control groups when it is available
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RG_HASH_MAP_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 // --=== Hash Maps ===--
 
-// region Hash Map
+// region Hash Map
+
+// --=== Constants ===--
+
+#define FMIX_MULTIPLIER_1 0xFF51AFD7ED558CCDULL
+#define FMIX_MULTIPLIER_2 0xC4CEB9FE1A85EC53ULL
+
+// Load factors
+#define RG_HASH_MAP_LINEAR_DEFAULT_MAX_LOAD_FACTOR  0.85f
+#define RG_HASH_MAP_GROUPED_DEFAULT_MAX_LOAD_FACTOR 0.875f
+#define RG_HASH_MAP_MIN_MAX_LOAD_FACTOR             0.25f
+#define RG_HASH_MAP_MAX_MAX_LOAD_FACTOR             0.95f
+
+// Linear layout
+// Probe distances from this one don't fit in the control byte of a slot, and are computed from the hash instead
+#define RG_HASH_MAP_LINEAR_LONG_DISTANCE INT8_MAX
+
+// Grouped layout
+#define RG_HASH_MAP_GROUP_WIDTH  16
+#define RG_HASH_MAP_CTRL_EMPTY   ((int8_t) -128) // 0b10000000
+#define RG_HASH_MAP_CTRL_DELETED ((int8_t) -2)   // 0b11111110
+#define RG_HASH_MAP_NOT_FOUND    SIZE_MAX
+
+// Incremental resize
+// Maximum number of slots of the old arrays that are processed by each operation while a resize is in progress
+#define RG_HASH_MAP_MIGRATION_STEPS 16
+
+// Shrinking
+// Maps that are not bigger than this are never shrunk automatically, since they don't use much memory anyway
+#define RG_HASH_MAP_MIN_SHRINK_CAPACITY 64
+
+// Inline entries
+// Maximum number of entries that a small map stores in its own struct before allocating the arrays
+// They take the place of the pointers and sizes of the arrays, which are 64 bytes: as many entries as fit there
+#define RG_HASH_MAP_INLINE_CAPACITY 4
+
+// Batched lookups
+// Number of keys between the one that is looked up and the one whose slot is prefetched. Must be a power of 2.
+#define RG_HASH_MAP_PREFETCH_DISTANCE 8
+// Maximum number of keys resolved at once by struct maps and storages, to be able to use buffers on the stack
+#define RG_STRUCT_MAP_BATCH_SIZE 64
+
+// --=== Types ===--
+
+typedef struct rg_hash_map_entry
+{
+    rg_hash_map_key_t   key;
+    rg_hash_map_value_t value;
+} rg_hash_map_entry;
+
+typedef struct rg_hash_map_compact_entry
+{
+    uint32_t key;
+    uint32_t value;
+} rg_hash_map_compact_entry;
+
+typedef struct rg_hash_map
+{
+    size_t                    capacity;
+    size_t                    count;
+    rg_hash_map_layout        layout;
+    rg_hash_map_hash_function pfn_hash;
+    float                     max_load_factor;
+    bool                      compact;
+    // Number of slots that can still be filled before a rehash is needed (tombstones of the grouped layout are not reusable for free)
+    size_t growth_left;
+    // Capacity under which the map is never shrunk automatically, set by the initial capacity and the reservations
+    size_t min_capacity;
+    // Incremental resize only
+    // While a resize is in progress, the entries that were not migrated yet stay in the old arrays.
+    // Every slot before the migration index is empty, and old_capacity is 0 when there is no resize in progress.
+    bool   incremental_resize;
+    size_t migration_index;
+    // Small maps only
+    // While the capacity is 0, the first count entries are stored in inline_entries instead of in the arrays, and are searched
+    // linearly. That way, a map with a handful of entries doesn't need any allocation, and doesn't even hash the keys.
+    bool use_inline_entries;
+    // The arrays and the resize in progress only exist while the capacity is not 0, so the inline entries reuse their memory
+    union
+    {
+        struct
+        {
+            // Array of rg_hash_map_entry, or of rg_hash_map_compact_entry if the map is compact
+            void *data;
+            // Linear layout only
+            // One bit per slot, set if the slot contains an entry.
+            // It allows the iteration to skip the empty slots without loading them.
+            uint64_t *occupancy;
+            // One control byte per slot
+            // Grouped layout: either EMPTY, DELETED, or the 7 low bits of the hash of the key stored in that slot.
+            // Linear layout: the probe distance of the key stored in that slot, if there is one.
+            int8_t *control;
+            // Incremental resize only
+            void     *old_data;
+            int8_t   *old_control;
+            uint64_t *old_occupancy;
+            size_t    old_capacity;
+            size_t    old_count;
+        };
+        rg_hash_map_entry inline_entries[RG_HASH_MAP_INLINE_CAPACITY];
+    };
+    // Allocator of the arrays, and of the map itself if it was created with rg_create_hash_map_with_info. NULL for the global heap.
+    const rg_allocator *allocator;
+} rg_hash_map;
+
+_Static_assert(sizeof(((rg_hash_map *) NULL)->inline_entries)
+                   <= offsetof(rg_hash_map, old_count) + sizeof(size_t) - offsetof(rg_hash_map, data),
+               "The inline entries must not make the map bigger");
+
+// --=== Utils functions ===--
+
+// Finalizer of MurmurHash3 (fmix64)
+// Contrary to a byte-wise hash, it only needs two multiplications, and every bit of the key affects every bit of the hash.
+// That way, sequential keys like storage ids are spread uniformly.
+// Related page: https://github.com/aappleby/smhasher/wiki/MurmurHash3
+uint64_t rg_hash_map_hash(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= FMIX_MULTIPLIER_1;
+    key ^= key >> 33;
+    key *= FMIX_MULTIPLIER_2;
+    key ^= key >> 33;
+    return key;
+}
+
+/** Hashes a key with the hash function of the map. */
+static inline uint64_t rg_hash_map_hash_key(const rg_hash_map *hash_map, rg_hash_map_key_t key)
+{
+    // Call the default function directly so that it can be inlined
+    return hash_map->pfn_hash == NULL ? rg_hash_map_hash(key) : hash_map->pfn_hash(key);
+}
+
+/** Returns the maximum number of entries that can be stored with the given capacity without exceeding the max load factor. */
+static inline size_t rg_hash_map_max_load(const rg_hash_map *hash_map, size_t capacity)
+{
+    size_t max_load = (size_t) ((double) capacity * hash_map->max_load_factor);
+
+    // There must always be at least one empty slot, otherwise the probing would never end
+    if (max_load >= capacity)
+    {
+        max_load = capacity - 1;
+    }
+    return max_load;
+}
+
+// --=== Entries ===--
+
+// Compact maps store 32-bit keys and values, so that an entry takes 8 bytes instead of 16 and twice as many fit in a cache line.
+// The entries are always accessed through the functions below, which use the right size depending on the map.
+// If a key or a value that doesn't fit in 32 bits is set, the map is converted to regular entries.
+
+static inline size_t rg_hash_map_entry_size(const rg_hash_map *hash_map)
+{
+    return hash_map->compact ? sizeof(rg_hash_map_compact_entry) : sizeof(rg_hash_map_entry);
+}
+
+static inline const void *rg_hash_map_entry_address(const rg_hash_map *hash_map, const void *entries, size_t index)
+{
+    return (const char *) entries + index * rg_hash_map_entry_size(hash_map);
+}
+
+static inline rg_hash_map_key_t rg_hash_map_key_at(const rg_hash_map *hash_map, const void *entries, size_t index)
+{
+    if (hash_map->compact)
+    {
+        return ((const rg_hash_map_compact_entry *) entries)[index].key;
+    }
+    return ((const rg_hash_map_entry *) entries)[index].key;
+}
+
+static inline rg_hash_map_entry rg_hash_map_entry_at(const rg_hash_map *hash_map, const void *entries, size_t index)
+{
+    if (hash_map->compact)
+    {
+        rg_hash_map_compact_entry entry = ((const rg_hash_map_compact_entry *) entries)[index];
+        return (rg_hash_map_entry) {
+            .key   = entry.key,
+            .value = (rg_hash_map_value_t) {.as_num = entry.value},
+        };
+    }
+    return ((const rg_hash_map_entry *) entries)[index];
+}
+
+/** Stores an entry in a slot. If the map is compact, the key and the value must fit in 32 bits. */
+static inline void rg_hash_map_store_entry(const rg_hash_map *hash_map, void *entries, size_t index, rg_hash_map_entry entry)
+{
+    if (hash_map->compact)
+    {
+        ((rg_hash_map_compact_entry *) entries)[index] = (rg_hash_map_compact_entry) {
+            .key   = (uint32_t) entry.key,
+            .value = (uint32_t) entry.value.as_num,
+        };
+    }
+    else
+    {
+        ((rg_hash_map_entry *) entries)[index] = entry;
+    }
+}
+
+/** Replaces the value of a slot. If the map is compact, the value must fit in 32 bits. */
+static inline void rg_hash_map_store_value(const rg_hash_map *hash_map, void *entries, size_t index, rg_hash_map_value_t value)
+{
+    if (hash_map->compact)
+    {
+        ((rg_hash_map_compact_entry *) entries)[index].value = (uint32_t) value.as_num;
+    }
+    else
+    {
+        ((rg_hash_map_entry *) entries)[index].value = value;
+    }
+}
+
+/** Copies the entry of a slot into another slot of the same array. */
+static inline void rg_hash_map_move_entry(const rg_hash_map *hash_map, void *entries, size_t to, size_t from)
+{
+    if (hash_map->compact)
+    {
+        ((rg_hash_map_compact_entry *) entries)[to] = ((rg_hash_map_compact_entry *) entries)[from];
+    }
+    else
+    {
+        ((rg_hash_map_entry *) entries)[to] = ((rg_hash_map_entry *) entries)[from];
+    }
+}
+
+/** Keep the null key in free slots, so that the iterator does not need to know about the layout. */
+static inline void rg_hash_map_clear_entry(const rg_hash_map *hash_map, void *entries, size_t index)
+{
+    rg_hash_map_store_entry(hash_map,
+                            entries,
+                            index,
+                            (rg_hash_map_entry) {
+                                .key   = RG_HASH_MAP_NULL_KEY,
+                                .value = (rg_hash_map_value_t) {NULL},
+                            });
+}
+
+// --=== Occupancy ===--
+
+static inline uint32_t rg_hash_map_count_trailing_zeros_64(uint64_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (uint32_t) index;
+#else
+    return (uint32_t) __builtin_ctzll(mask);
+#endif
+}
+
+/** Returns the number of 64-bit words needed for the occupancy bitmap of the given capacity. */
+static inline size_t rg_hash_map_occupancy_word_count(size_t capacity)
+{
+    return (capacity + 63) / 64;
+}
+
+static inline void rg_hash_map_occupancy_set(uint64_t *occupancy, size_t index)
+{
+    occupancy[index / 64] |= 1ULL << (index % 64);
+}
+
+static inline void rg_hash_map_occupancy_unset(uint64_t *occupancy, size_t index)
+{
+    occupancy[index / 64] &= ~(1ULL << (index % 64));
+}
+
+/** Returns the index of the first occupied slot at or after the given index, or the capacity if there is none. */
+static inline size_t rg_hash_map_occupancy_next(const uint64_t *occupancy, size_t capacity, size_t index)
+{
+    while (index < capacity)
+    {
+        // Drop the bits of the slots before the index
+        uint64_t word = occupancy[index / 64] >> (index % 64);
+        if (word != 0)
+        {
+            return index + rg_hash_map_count_trailing_zeros_64(word);
+        }
+
+        // Jump to the next word
+        index = (index / 64 + 1) * 64;
+    }
+    return capacity;
+}
+
+// --=== Linear layout ===--
+
+// The linear layout uses Robin Hood hashing: when inserting, a key that is further from its ideal slot than the key currently
+// occupying a slot takes that slot, and the displaced key continues the probing. That keeps the probe lengths short and uniform,
+// even at high load factors.
+// When a key is erased, the following keys of the cluster are shifted back by one slot (backward shift deletion), so there are
+// never any holes in a cluster and no tombstones are needed.
+// Related article: https://codecapsule.com/2013/11/17/robin-hood-hashing-backward-shift-deletion/
+
+/**
+ * Returns the distance between the slot at the given index and the ideal slot of the key that it contains.
+ * Insertions and erasures need it for every slot that they go through. It is stored in the control byte of the slot, so that the
+ * keys that are already in the map are not hashed again, which matters with a custom hash function. Only the distances that are too
+ * long for a byte are computed from the hash.
+ */
+static inline size_t rg_hash_map_linear_probe_distance(const rg_hash_map *hash_map,
+                                                       const void        *entries,
+                                                       const int8_t      *distances,
+                                                       size_t             mask,
+                                                       size_t             index)
+{
+    if (distances[index] != RG_HASH_MAP_LINEAR_LONG_DISTANCE)
+    {
+        return (size_t) distances[index];
+    }
+    size_t ideal_index = (size_t) (rg_hash_map_hash_key(hash_map, rg_hash_map_key_at(hash_map, entries, index)) & (uint64_t) mask);
+    return (index - ideal_index) & mask;
+}
+
+static inline void rg_hash_map_linear_store_distance(int8_t *distances, size_t index, size_t distance)
+{
+    distances[index] = distance < RG_HASH_MAP_LINEAR_LONG_DISTANCE ? (int8_t) distance : RG_HASH_MAP_LINEAR_LONG_DISTANCE;
+}
+
+/** Returns the index of the slot containing the key, or RG_HASH_MAP_NOT_FOUND. */
+size_t rg_hash_map_linear_find(const rg_hash_map *hash_map, rg_hash_map_key_t key, uint64_t hash)
+{
+    size_t mask  = hash_map->capacity - 1;
+    size_t index = (size_t) (hash & (uint64_t) mask);
+
+    // Clusters never contain holes, so the key can only be before the next empty slot
+    rg_hash_map_key_t slot_key;
+    while ((slot_key = rg_hash_map_key_at(hash_map, hash_map->data, index)) != RG_HASH_MAP_NULL_KEY)
+    {
+        // If the key is the same, we found the good slot !
+        if (slot_key == key)
+        {
+            return index;
+        }
+
+        // Wrap around to stay inside the array
+        index = (index + 1) & mask;
+    }
+    return RG_HASH_MAP_NOT_FOUND;
+}
+
+/**
+ * Inserts a key that is known not to be in the given entries yet. There must be at least one empty slot.
+ * The arrays are given separately from the map so that this function can be used to fill new arrays when expanding.
+ */
+void rg_hash_map_linear_insert_new(const rg_hash_map  *hash_map,
+                                   void               *entries,
+                                   uint64_t           *occupancy,
+                                   int8_t             *distances,
+                                   size_t              capacity,
+                                   rg_hash_map_key_t   key,
+                                   rg_hash_map_value_t value)
+{
+    size_t            mask     = capacity - 1;
+    size_t            index    = (size_t) (rg_hash_map_hash_key(hash_map, key) & (uint64_t) mask);
+    size_t            distance = 0;
+    rg_hash_map_entry carried  = {
+         .key   = key,
+         .value = value,
+    };
+
+    while (rg_hash_map_key_at(hash_map, entries, index) != RG_HASH_MAP_NULL_KEY)
+    {
+        // If the key in the slot is closer to its ideal slot than the carried one, swap them
+        size_t existing_distance = rg_hash_map_linear_probe_distance(hash_map, entries, distances, mask, index);
+        if (existing_distance < distance)
+        {
+            rg_hash_map_entry tmp = rg_hash_map_entry_at(hash_map, entries, index);
+            rg_hash_map_store_entry(hash_map, entries, index, carried);
+            rg_hash_map_linear_store_distance(distances, index, distance);
+            carried  = tmp;
+            distance = existing_distance;
+        }
+
+        index = (index + 1) & mask;
+        distance++;
+    }
+
+    // Index is guarantied to point to an empty slot now, given the loop above.
+    // It is the only slot that becomes occupied, the swaps only move entries between occupied slots.
+    rg_hash_map_store_entry(hash_map, entries, index, carried);
+    rg_hash_map_linear_store_distance(distances, index, distance);
+    rg_hash_map_occupancy_set(occupancy, index);
+}
+
+/** Reallocates the array of a linear map with the given capacity, and moves every entry in it. */
+bool rg_hash_map_linear_resize(rg_hash_map *hash_map, size_t new_capacity)
+{
+    void *new_entries = rg_allocator_calloc(hash_map->allocator, new_capacity, rg_hash_map_entry_size(hash_map));
+    if (new_entries == NULL)
+    {
+        return false;
+    }
+    uint64_t *new_occupancy =
+        rg_allocator_calloc(hash_map->allocator, rg_hash_map_occupancy_word_count(new_capacity), sizeof(uint64_t));
+    if (new_occupancy == NULL)
+    {
+        rg_allocator_free(hash_map->allocator, new_entries);
+        return false;
+    }
+    // The distances are only read for occupied slots, so they don't need to be initialized
+    int8_t *new_distances = rg_allocator_alloc(hash_map->allocator, new_capacity);
+    if (new_distances == NULL)
+    {
+        rg_allocator_free(hash_map->allocator, new_entries);
+        rg_allocator_free(hash_map->allocator, new_occupancy);
+        return false;
+    }
+
+    // Move the entries to the new arrays
+    size_t i = hash_map->capacity > 0 ? rg_hash_map_occupancy_next(hash_map->occupancy, hash_map->capacity, 0) : 0;
+    while (i < hash_map->capacity)
+    {
+        rg_hash_map_entry entry = rg_hash_map_entry_at(hash_map, hash_map->data, i);
+        rg_hash_map_linear_insert_new(hash_map, new_entries, new_occupancy, new_distances, new_capacity, entry.key, entry.value);
+        i = rg_hash_map_occupancy_next(hash_map->occupancy, hash_map->capacity, i + 1);
+    }
+
+    // The arrays don't exist yet when the map is being initialized
+    if (hash_map->capacity > 0)
+    {
+        rg_allocator_free(hash_map->allocator, hash_map->data);
+        rg_allocator_free(hash_map->allocator, hash_map->occupancy);
+        rg_allocator_free(hash_map->allocator, hash_map->control);
+    }
+    hash_map->data        = new_entries;
+    hash_map->occupancy   = new_occupancy;
+    hash_map->control     = new_distances;
+    hash_map->capacity    = new_capacity;
+    hash_map->growth_left = rg_hash_map_max_load(hash_map, new_capacity) - hash_map->count;
+    return true;
+}
+
+void rg_hash_map_linear_erase_at(rg_hash_map *hash_map, size_t index)
+{
+    size_t mask = hash_map->capacity - 1;
+
+    // Shift the following entries of the cluster back by one slot, until an empty slot or an entry that is already at its ideal slot
+    size_t next = (index + 1) & mask;
+    size_t distance;
+    while (rg_hash_map_key_at(hash_map, hash_map->data, next) != RG_HASH_MAP_NULL_KEY
+           && (distance = rg_hash_map_linear_probe_distance(hash_map, hash_map->data, hash_map->control, mask, next)) > 0)
+    {
+        rg_hash_map_move_entry(hash_map, hash_map->data, index, next);
+        rg_hash_map_linear_store_distance(hash_map->control, index, distance - 1);
+        index = next;
+        next  = (next + 1) & mask;
+    }
+
+    // The last moved slot is now free
+    rg_hash_map_clear_entry(hash_map, hash_map->data, index);
+    rg_hash_map_occupancy_unset(hash_map->occupancy, index);
+    hash_map->count--;
+    hash_map->growth_left++;
+}
+
+// --=== Grouped layout ===--
+
+// The grouped layout is an open addressing scheme inspired by Abseil's Swiss tables.
+// Related talk: https://www.youtube.com/watch?v=ncHmEUmJZf4
+// Slots are split in aligned groups of 16. The hash is split in two parts: h1 (high bits) selects the first group to probe,
+// and h2 (7 low bits) is stored in the control byte of the slot. Looking up a key then consists in comparing h2 with the
+// 16 control bytes of a group in a few instructions, and only comparing the keys of the matching slots.
+// If a group contains an empty slot, the probing stops there. Otherwise, the next group is probed (triangular probing).
+
+static inline uint32_t rg_hash_map_count_trailing_zeros(uint32_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (uint32_t) index;
+#else
+    return (uint32_t) __builtin_ctz(mask);
+#endif
+}
+
+static inline int8_t rg_hash_map_h2(uint64_t hash)
+{
+    return (int8_t) (hash & 0x7F);
+}
+
+static inline size_t rg_hash_map_h1(uint64_t hash)
+{
+    return (size_t) (hash >> 7);
+}
+
+/** Returns a bit mask where the bit i is set if the control byte i of the group equals the given tag. */
+static inline uint32_t rg_hash_map_group_match(const int8_t *group, int8_t tag)
+{
+#ifdef RG_HASH_MAP_USE_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i *) group);
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(tag), ctrl));
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < RG_HASH_MAP_GROUP_WIDTH; i++)
+    {
+        if (group[i] == tag)
+        {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+/** Returns a bit mask where the bit i is set if the slot i of the group is either empty or deleted. */
+static inline uint32_t rg_hash_map_group_match_free(const int8_t *group)
+{
+#ifdef RG_HASH_MAP_USE_SSE2
+    // Both special values are smaller than -1, while full slots are positive
+    __m128i ctrl = _mm_loadu_si128((const __m128i *) group);
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl));
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < RG_HASH_MAP_GROUP_WIDTH; i++)
+    {
+        if (group[i] < -1)
+        {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+/** Returns the index of the slot containing the key, or RG_HASH_MAP_NOT_FOUND. */
+size_t rg_hash_map_grouped_find(const rg_hash_map *hash_map, rg_hash_map_key_t key, uint64_t hash)
+{
+    size_t group_count = hash_map->capacity / RG_HASH_MAP_GROUP_WIDTH;
+    size_t group_mask  = group_count - 1;
+    size_t group       = rg_hash_map_h1(hash) & group_mask;
+    int8_t tag         = rg_hash_map_h2(hash);
+
+    // Triangular probing visits every group exactly once when the group count is a power of 2
+    for (size_t step = 1; step <= group_count; step++)
+    {
+        const int8_t *ctrl = hash_map->control + group * RG_HASH_MAP_GROUP_WIDTH;
+
+        // Check the slots whose tag matches
+        uint32_t matches = rg_hash_map_group_match(ctrl, tag);
+        while (matches != 0)
+        {
+            size_t index = group * RG_HASH_MAP_GROUP_WIDTH + rg_hash_map_count_trailing_zeros(matches);
+            if (rg_hash_map_key_at(hash_map, hash_map->data, index) == key)
+            {
+                return index;
+            }
+            matches &= matches - 1;
+        }
+
+        // If there is an empty slot in the group, the key would have been inserted there: it does not exist
+        if (rg_hash_map_group_match(ctrl, RG_HASH_MAP_CTRL_EMPTY) != 0)
+        {
+            return RG_HASH_MAP_NOT_FOUND;
+        }
+
+        group = (group + step) & group_mask;
+    }
+    return RG_HASH_MAP_NOT_FOUND;
+}
+
+/** Returns the index of the first empty or deleted slot in the probe sequence of the hash. There must be at least one. */
+size_t rg_hash_map_grouped_find_free_slot(const rg_hash_map *hash_map, uint64_t hash)
+{
+    size_t group_mask = hash_map->capacity / RG_HASH_MAP_GROUP_WIDTH - 1;
+    size_t group      = rg_hash_map_h1(hash) & group_mask;
+
+    // Find the first group with a free slot
+    uint32_t free_slots = 0;
+    for (size_t step = 1;; step++)
+    {
+        free_slots = rg_hash_map_group_match_free(hash_map->control + group * RG_HASH_MAP_GROUP_WIDTH);
+        if (free_slots != 0)
+        {
+            break;
+        }
+        group = (group + step) & group_mask;
+    }
+
+    return group * RG_HASH_MAP_GROUP_WIDTH + rg_hash_map_count_trailing_zeros(free_slots);
+}
+
+/** Inserts a key that is known not to be in the map yet. There must be some growth left. */
+void rg_hash_map_grouped_insert_new(rg_hash_map *hash_map, rg_hash_map_key_t key, rg_hash_map_value_t value, uint64_t hash)
+{
+    size_t index = rg_hash_map_grouped_find_free_slot(hash_map, hash);
+
+    // Reusing a tombstone doesn't consume growth, since it was already counted when it was filled the first time
+    if (hash_map->control[index] == RG_HASH_MAP_CTRL_EMPTY)
+    {
+        hash_map->growth_left--;
+    }
+
+    hash_map->control[index] = rg_hash_map_h2(hash);
+    rg_hash_map_store_entry(hash_map,
+                            hash_map->data,
+                            index,
+                            (rg_hash_map_entry) {
+                                .key   = key,
+                                .value = value,
+                            });
+    hash_map->count++;
+}
+
+/** Reallocates the arrays of a grouped map with the given capacity, and moves every entry in them. Tombstones are dropped. */
+bool rg_hash_map_grouped_resize(rg_hash_map *hash_map, size_t new_capacity)
+{
+    void *new_entries = rg_allocator_calloc(hash_map->allocator, new_capacity, rg_hash_map_entry_size(hash_map));
+    if (new_entries == NULL)
+    {
+        return false;
+    }
+    int8_t *new_control = rg_allocator_alloc(hash_map->allocator, new_capacity);
+    if (new_control == NULL)
+    {
+        rg_allocator_free(hash_map->allocator, new_entries);
+        return false;
+    }
+    memset(new_control, RG_HASH_MAP_CTRL_EMPTY, new_capacity);
+
+    void   *old_entries  = hash_map->data;
+    int8_t *old_control  = hash_map->control;
+    size_t  old_capacity = hash_map->capacity;
+
+    hash_map->data        = new_entries;
+    hash_map->control     = new_control;
+    hash_map->capacity    = new_capacity;
+    hash_map->count       = 0;
+    hash_map->growth_left = rg_hash_map_max_load(hash_map, new_capacity);
+
+    // Move the entries to the new arrays
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        if (old_control[i] >= 0)
+        {
+            rg_hash_map_entry entry = rg_hash_map_entry_at(hash_map, old_entries, i);
+            rg_hash_map_grouped_insert_new(hash_map, entry.key, entry.value, rg_hash_map_hash_key(hash_map, entry.key));
+        }
+    }
+
+    // The arrays don't exist yet when the map is being initialized
+    if (old_capacity > 0)
+    {
+        rg_allocator_free(hash_map->allocator, old_entries);
+        rg_allocator_free(hash_map->allocator, old_control);
+    }
+    return true;
+}
+
+void rg_hash_map_grouped_erase_at(rg_hash_map *hash_map, size_t index)
+{
+    const int8_t *group = hash_map->control + (index & ~((size_t) RG_HASH_MAP_GROUP_WIDTH - 1));
+
+    // If the group still has an empty slot, no probe sequence ever went past it, so the slot can be marked as empty.
+    // Otherwise, a tombstone is needed so that lookups of keys that were inserted further continue past this group.
+    if (rg_hash_map_group_match(group, RG_HASH_MAP_CTRL_EMPTY) != 0)
+    {
+        hash_map->control[index] = RG_HASH_MAP_CTRL_EMPTY;
+        hash_map->growth_left++;
+    }
+    else
+    {
+        hash_map->control[index] = RG_HASH_MAP_CTRL_DELETED;
+    }
+
+    rg_hash_map_clear_entry(hash_map, hash_map->data, index);
+    hash_map->count--;
+}
+
+// --=== Common ===--
+
+/** Returns the index of the slot containing the key, whose hash is already computed, or RG_HASH_MAP_NOT_FOUND. */
+static inline size_t rg_hash_map_find_hashed(const rg_hash_map *hash_map, rg_hash_map_key_t key, uint64_t hash)
+{
+    if (hash_map->layout == RG_HASH_MAP_LAYOUT_GROUPED)
+    {
+        return rg_hash_map_grouped_find(hash_map, key, hash);
+    }
+    return rg_hash_map_linear_find(hash_map, key, hash);
+}
+
+/** Returns the index of the slot containing the key, or RG_HASH_MAP_NOT_FOUND. */
+static inline size_t rg_hash_map_find(const rg_hash_map *hash_map, rg_hash_map_key_t key)
+{
+    return rg_hash_map_find_hashed(hash_map, key, rg_hash_map_hash_key(hash_map, key));
+}
+
+/** Returns the number of slots whose occupancy can be loaded at once by rg_hash_map_occupied_slots. */
+static inline size_t rg_hash_map_chunk_width(const rg_hash_map *hash_map)
+{
+    return hash_map->layout == RG_HASH_MAP_LAYOUT_LINEAR ? 64 : RG_HASH_MAP_GROUP_WIDTH;
+}
+
+/** Returns a mask where the bit i is set if the slot chunk_start + i contains an entry. The chunk start is a multiple of the width. */
+static inline uint64_t rg_hash_map_occupied_slots(const rg_hash_map *hash_map, size_t chunk_start)
+{
+    if (hash_map->layout == RG_HASH_MAP_LAYOUT_LINEAR)
+    {
+        // The bits after the capacity are never set
+        return hash_map->occupancy[chunk_start / 64];
+    }
+
+    // The grouped layout already has a byte per slot: match a whole group at once
+    return ~rg_hash_map_group_match_free(hash_map->control + chunk_start) & 0xFFFF;
+}
+
+/** Prefetches the first slots that will be probed when looking up a key with the given hash. */
+static inline void rg_hash_map_prefetch(const rg_hash_map *hash_map, uint64_t hash)
+{
+    if (hash_map->layout == RG_HASH_MAP_LAYOUT_GROUPED)
+    {
+        size_t group = rg_hash_map_h1(hash) & (hash_map->capacity / RG_HASH_MAP_GROUP_WIDTH - 1);
+        RG_PREFETCH(hash_map->control + group * RG_HASH_MAP_GROUP_WIDTH);
+        RG_PREFETCH(rg_hash_map_entry_address(hash_map, hash_map->data, group * RG_HASH_MAP_GROUP_WIDTH));
+    }
+    else
+    {
+        RG_PREFETCH(rg_hash_map_entry_address(hash_map, hash_map->data, hash & (uint64_t) (hash_map->capacity - 1)));
+    }
+}
+
+/** Erases the entry of the slot at the given index. */
+static inline void rg_hash_map_erase_at(rg_hash_map *hash_map, size_t index)
+{
+    if (hash_map->layout == RG_HASH_MAP_LAYOUT_GROUPED)
+    {
+        rg_hash_map_grouped_erase_at(hash_map, index);
+    }
+    else
+    {
+        rg_hash_map_linear_erase_at(hash_map, index);
+    }
+}
+
+// --=== Incremental resize ===--
+
+// When a map with incremental resize needs to grow, new arrays are allocated, but the entries are not moved all at once.
+// Instead, every following set or erase migrates a few slots of the old arrays, until they are empty and can be freed.
+// Meanwhile, a key is always in exactly one of the arrays: lookups check the new arrays, then the old ones.
+// The growth of the new arrays is computed as if every old entry was already there, so it can never be exceeded by the migration.
+
+/** Returns a map that views the old arrays, so that the usual functions can be used on them. */
+static inline rg_hash_map rg_hash_map_old_table(const rg_hash_map *hash_map)
+{
+    rg_hash_map old_table  = *hash_map;
+    old_table.data         = hash_map->old_data;
+    old_table.control      = hash_map->old_control;
+    old_table.occupancy    = hash_map->old_occupancy;
+    old_table.capacity     = hash_map->old_capacity;
+    old_table.count        = hash_map->old_count;
+    old_table.old_capacity = 0;
+    return old_table;
+}
+
+/** Frees the old arrays of the resize in progress, if any, without migrating their entries. */
+void rg_hash_map_free_old_table(rg_hash_map *hash_map)
+{
+    // While the entries are inline, old_capacity is not set
+    if (hash_map->capacity == 0 || hash_map->old_capacity == 0)
+    {
+        return;
+    }
+
+    rg_allocator_free(hash_map->allocator, hash_map->old_data);
+    if (hash_map->old_control != NULL)
+    {
+        rg_allocator_free(hash_map->allocator, hash_map->old_control);
+    }
+    if (hash_map->old_occupancy != NULL)
+    {
+        rg_allocator_free(hash_map->allocator, hash_map->old_occupancy);
+    }
+    hash_map->old_data        = NULL;
+    hash_map->old_control     = NULL;
+    hash_map->old_occupancy   = NULL;
+    hash_map->old_capacity    = 0;
+    hash_map->old_count       = 0;
+    hash_map->migration_index = 0;
+}
+
+/** Moves the entries of up to max_steps slots of the old arrays to the new ones. Frees the old arrays when they are empty. */
+void rg_hash_map_migrate(rg_hash_map *hash_map, size_t max_steps)
+{
+    if (hash_map->capacity == 0 || hash_map->old_capacity == 0)
+    {
+        return;
+    }
+
+    rg_hash_map old_table = rg_hash_map_old_table(hash_map);
+    for (size_t step = 0; step < max_steps && hash_map->migration_index < hash_map->old_capacity; step++)
+    {
+        size_t            index = hash_map->migration_index;
+        rg_hash_map_entry entry = rg_hash_map_entry_at(hash_map, old_table.data, index);
+        if (entry.key == RG_HASH_MAP_NULL_KEY)
+        {
+            hash_map->migration_index++;
+            continue;
+        }
 
-// --=== Constants ===--
+        // The growth of the entry was already reserved when the resize started
+        if (hash_map->layout == RG_HASH_MAP_LAYOUT_GROUPED)
+        {
+            uint64_t hash                = rg_hash_map_hash_key(hash_map, entry.key);
+            size_t   new_index           = rg_hash_map_grouped_find_free_slot(hash_map, hash);
+            hash_map->control[new_index] = rg_hash_map_h2(hash);
+            rg_hash_map_store_entry(hash_map, hash_map->data, new_index, entry);
+        }
+        else
+        {
+            rg_hash_map_linear_insert_new(hash_map,
+                                          hash_map->data,
+                                          hash_map->occupancy,
+                                          hash_map->control,
+                                          hash_map->capacity,
+                                          entry.key,
+                                          entry.value);
+        }
 
-#define FNV_OFFSET 14695981039346656037ULL
-#define FNV_PRIME  1099511628211ULL
+        // With the linear layout, the backward shift may move another entry in this slot, so the index is not incremented
+        rg_hash_map_erase_at(&old_table, index);
+        hash_map->old_count--;
+    }
 
-// --=== Types ===--
+    // When everything is migrated, the old arrays can be freed
+    if (hash_map->migration_index >= hash_map->old_capacity)
+    {
+        rg_hash_map_free_old_table(hash_map);
 
-typedef struct rg_hash_map_entry
+        // Erasures in the old arrays released some growth. It can only be recovered exactly without tombstones.
+        if (hash_map->layout == RG_HASH_MAP_LAYOUT_LINEAR)
+        {
+            hash_map->growth_left = rg_hash_map_max_load(hash_map, hash_map->capacity) - hash_map->count;
+        }
+    }
+}
+
+/** Allocates new arrays with the given capacity and starts migrating the entries to them. */
+bool rg_hash_map_start_migration(rg_hash_map *hash_map, size_t new_capacity)
 {
-    rg_hash_map_key_t   key;
-    rg_hash_map_value_t value;
-} rg_hash_map_entry;
+    void *new_entries = rg_allocator_calloc(hash_map->allocator, new_capacity, rg_hash_map_entry_size(hash_map));
+    if (new_entries == NULL)
+    {
+        return false;
+    }
+    // Both layouts have control bytes, the probe distances of the linear layout don't need to be initialized
+    int8_t *new_control = rg_allocator_alloc(hash_map->allocator, new_capacity);
+    if (new_control == NULL)
+    {
+        rg_allocator_free(hash_map->allocator, new_entries);
+        return false;
+    }
+    uint64_t *new_occupancy = NULL;
+    if (hash_map->layout == RG_HASH_MAP_LAYOUT_GROUPED)
+    {
+        memset(new_control, RG_HASH_MAP_CTRL_EMPTY, new_capacity);
+    }
+    else
+    {
+        new_occupancy = rg_allocator_calloc(hash_map->allocator, rg_hash_map_occupancy_word_count(new_capacity), sizeof(uint64_t));
+        if (new_occupancy == NULL)
+        {
+            rg_allocator_free(hash_map->allocator, new_entries);
+            rg_allocator_free(hash_map->allocator, new_control);
+            return false;
+        }
+    }
 
-typedef struct rg_hash_map
+    hash_map->old_data        = hash_map->data;
+    hash_map->old_control     = hash_map->control;
+    hash_map->old_occupancy   = hash_map->occupancy;
+    hash_map->old_capacity    = hash_map->capacity;
+    hash_map->old_count       = hash_map->count;
+    hash_map->migration_index = 0;
+
+    hash_map->data        = new_entries;
+    hash_map->control     = new_control;
+    hash_map->occupancy   = new_occupancy;
+    hash_map->capacity    = new_capacity;
+    hash_map->growth_left = rg_hash_map_max_load(hash_map, new_capacity) - hash_map->count;
+    return true;
+}
+
+// --=== Inline entries ===--
+
+/** Returns the index of the key in the inline entries, or RG_HASH_MAP_NOT_FOUND. */
+static inline size_t rg_hash_map_inline_find(const rg_hash_map *hash_map, rg_hash_map_key_t key)
 {
-    rg_hash_map_entry *data;
-    size_t             capacity;
-    size_t             count;
-} rg_hash_map;
+    for (size_t i = 0; i < hash_map->count; i++)
+    {
+        if (hash_map->inline_entries[i].key == key)
+        {
+            return i;
+        }
+    }
+    return RG_HASH_MAP_NOT_FOUND;
+}
 
-// --=== Utils functions ===--
+static inline rg_hash_map_get_result rg_hash_map_inline_get(const rg_hash_map *hash_map, rg_hash_map_key_t key)
+{
+    // The null key is never stored, so it is never found
+    size_t index = rg_hash_map_inline_find(hash_map, key);
+    if (index != RG_HASH_MAP_NOT_FOUND)
+    {
+        return (rg_hash_map_get_result) {
+            .value  = hash_map->inline_entries[index].value,
+            .exists = true,
+        };
+    }
+    return (rg_hash_map_get_result) {.exists = false};
+}
 
-// FNV hash of key
-// Related wiki page: https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function
-uint64_t rg_hash_map_hash(uint64_t key)
+/** Inserts a key that is not in the arrays yet. There must be some growth left. */
+static inline void rg_hash_map_insert_new(rg_hash_map *hash_map, rg_hash_map_key_t key, rg_hash_map_value_t value, uint64_t hash)
 {
-    uint64_t hash = FNV_OFFSET;
-    for (size_t i = 0; i < sizeof(key); i++)
+    if (hash_map->layout == RG_HASH_MAP_LAYOUT_GROUPED)
     {
-        hash ^= ((uint8_t *) &key)[i];
-        hash *= FNV_PRIME;
+        rg_hash_map_grouped_insert_new(hash_map, key, value, hash);
+        return;
     }
-    return hash;
+    rg_hash_map_linear_insert_new(hash_map, hash_map->data, hash_map->occupancy, hash_map->control, hash_map->capacity, key, value);
+    hash_map->count++;
+    hash_map->growth_left--;
 }
 
-bool rg_hash_map_set_entry(rg_hash_map_entry  *entries,
-                           size_t              capacity,
-                           rg_hash_map_key_t   key,
-                           rg_hash_map_value_t value,
-                           size_t             *count)
+/** Allocates the arrays of a map that stores its entries inline, with the given capacity, and moves the entries in them. */
+bool rg_hash_map_move_inline_entries_to_arrays(rg_hash_map *hash_map, size_t new_capacity)
 {
-    // Prevent the use of the zero key, which is reserved for the empty entry
-    if (key == RG_HASH_MAP_NULL_KEY)
+    // The arrays take the place of the entries, so copy them out first
+    rg_hash_map_entry entries[RG_HASH_MAP_INLINE_CAPACITY];
+    size_t            count = hash_map->count;
+    memcpy(entries, hash_map->inline_entries, count * sizeof(rg_hash_map_entry));
+
+    // Allocate empty arrays, then insert the entries as if they were new
+    hash_map->data          = NULL;
+    hash_map->control       = NULL;
+    hash_map->occupancy     = NULL;
+    hash_map->old_data      = NULL;
+    hash_map->old_control   = NULL;
+    hash_map->old_occupancy = NULL;
+    hash_map->old_capacity  = 0;
+    hash_map->old_count     = 0;
+    hash_map->count         = 0;
+    bool success            = hash_map->layout == RG_HASH_MAP_LAYOUT_GROUPED ? rg_hash_map_grouped_resize(hash_map, new_capacity)
+                                                                             : rg_hash_map_linear_resize(hash_map, new_capacity);
+    if (!success)
     {
+        memcpy(hash_map->inline_entries, entries, count * sizeof(rg_hash_map_entry));
+        hash_map->count = count;
         return false;
     }
 
-    // Compute the index of the key in the array
-    size_t index = (size_t) (rg_hash_map_hash(key) & ((uint64_t) capacity - 1));
+    for (size_t i = 0; i < count; i++)
+    {
+        rg_hash_map_insert_new(hash_map, entries[i].key, entries[i].value, rg_hash_map_hash_key(hash_map, entries[i].key));
+    }
+    return true;
+}
+
+/** Moves the entries of the arrays back to the inline entries, and frees the arrays. There must be few enough entries. */
+void rg_hash_map_move_arrays_to_inline_entries(rg_hash_map *hash_map)
+{
+    // Only one array to look at
+    rg_hash_map_migrate(hash_map, SIZE_MAX);
 
-    while (entries[index].key != RG_HASH_MAP_NULL_KEY)
+    // The entries take the place of the arrays, so only write them once the arrays are freed
+    rg_hash_map_entry entries[RG_HASH_MAP_INLINE_CAPACITY];
+    size_t            count = 0;
+    for (size_t i = 0; i < hash_map->capacity; i++)
     {
-        // If the slot is not empty, but the key is the same
-        // We want to edit that slot
-        if (entries[index].key == key)
+        rg_hash_map_entry entry = rg_hash_map_entry_at(hash_map, hash_map->data, i);
+        if (entry.key != RG_HASH_MAP_NULL_KEY)
         {
-            // Edit value
-            entries[index].value = value;
-            return true;
+            entries[count++] = entry;
         }
+    }
 
-        // Else, increment to find the next empty slot
-        index++;
-        // Wrap around to stay inside the array
-        if (index >= capacity)
+    rg_allocator_free(hash_map->allocator, hash_map->data);
+    if (hash_map->control != NULL)
+    {
+        rg_allocator_free(hash_map->allocator, hash_map->control);
+    }
+    if (hash_map->occupancy != NULL)
+    {
+        rg_allocator_free(hash_map->allocator, hash_map->occupancy);
+    }
+    memcpy(hash_map->inline_entries, entries, count * sizeof(rg_hash_map_entry));
+    hash_map->capacity    = 0;
+    hash_map->growth_left = 0;
+}
+
+// --=== Growth ===--
+
+/** Returns the smallest valid capacity that can hold the given number of entries, or 0 if it is too big. */
+size_t rg_hash_map_capacity_for(const rg_hash_map *hash_map, size_t count)
+{
+    // Always use powers of 2, so we can replace modulo with and operation
+    size_t capacity = hash_map->layout == RG_HASH_MAP_LAYOUT_GROUPED ? RG_HASH_MAP_GROUP_WIDTH : 1;
+    while (rg_hash_map_max_load(hash_map, capacity) < count)
+    {
+        capacity *= 2;
+        if (capacity == 0)
         {
-            index = 0;
+            return 0;
         }
     }
+    return capacity;
+}
 
-    // The key didn't already exist
-    // We need to add it to an empty slot
-    // Index is guarantied to point to an empty slot now, given the loop above.
-    // We will use that one.
+/** Reallocates the arrays of the map with the given capacity, which must be a power of 2 big enough for the current entries. */
+bool rg_hash_map_resize(rg_hash_map *hash_map, size_t new_capacity)
+{
+    // Finish any resize in progress first, so that there is only one array to move
+    rg_hash_map_migrate(hash_map, SIZE_MAX);
 
-    if (count != NULL)
+    if (hash_map->capacity == 0)
     {
-        (*count)++;
+        return rg_hash_map_move_inline_entries_to_arrays(hash_map, new_capacity);
     }
-
-    entries[index].key   = key;
-    entries[index].value = value;
-    return true;
+    if (hash_map->layout == RG_HASH_MAP_LAYOUT_GROUPED)
+    {
+        return rg_hash_map_grouped_resize(hash_map, new_capacity);
+    }
+    return rg_hash_map_linear_resize(hash_map, new_capacity);
 }
 
-bool rg_hash_map_expand(rg_hash_map *hash_map)
+/** Converts a compact map to regular entries, so that it can store keys and values that don't fit in 32 bits. */
+bool rg_hash_map_widen(rg_hash_map *hash_map)
 {
-    // Always use powers of 2, so we can replace modulo with and operation
-    size_t new_capacity = hash_map->capacity * 2;
-    if (new_capacity < hash_map->capacity)
+    // Inline entries are always regular entries, the arrays will be allocated with the right size
+    if (hash_map->capacity == 0)
     {
-        return false;
+        hash_map->compact = false;
+        return true;
     }
 
-    rg_hash_map_entry *new_entries = rg_calloc(new_capacity, sizeof(rg_hash_map_entry));
-    if (new_entries == NULL)
+    // Only convert one array
+    rg_hash_map_migrate(hash_map, SIZE_MAX);
+
+    rg_hash_map_entry *wide_entries = rg_allocator_alloc(hash_map->allocator, hash_map->capacity * sizeof(rg_hash_map_entry));
+    if (wide_entries == NULL)
     {
         return false;
     }
 
-    // Move the entries to the new array
+    // The hashes and the capacity don't change, so every entry stays in the same slot
     for (size_t i = 0; i < hash_map->capacity; i++)
     {
-        rg_hash_map_entry entry = hash_map->data[i];
-        if (entry.key != RG_HASH_MAP_NULL_KEY)
+        wide_entries[i] = rg_hash_map_entry_at(hash_map, hash_map->data, i);
+    }
+
+    rg_allocator_free(hash_map->allocator, hash_map->data);
+    hash_map->data    = wide_entries;
+    hash_map->compact = false;
+    return true;
+}
+
+/** Makes room for at least one new entry when there is no growth left. */
+bool rg_hash_map_grow(rg_hash_map *hash_map)
+{
+    // If a resize is already in progress, finish it, maybe it freed enough growth
+    if (hash_map->old_capacity > 0)
+    {
+        rg_hash_map_migrate(hash_map, SIZE_MAX);
+        if (hash_map->growth_left > 0)
         {
-            rg_hash_map_set_entry(new_entries, new_capacity, entry.key, entry.value, NULL);
+            return true;
         }
     }
 
-    rg_free(hash_map->data);
-    hash_map->data     = new_entries;
-    hash_map->capacity = new_capacity;
-    return true;
+    // With the grouped layout, if a lot of the slots are tombstones, a rehash with the same capacity is enough to make room
+    // Otherwise, double the capacity
+    size_t new_capacity = hash_map->capacity;
+    if (hash_map->layout == RG_HASH_MAP_LAYOUT_LINEAR || hash_map->count >= rg_hash_map_max_load(hash_map, hash_map->capacity) / 2)
+    {
+        new_capacity *= 2;
+        if (new_capacity < hash_map->capacity)
+        {
+            return false;
+        }
+    }
+
+    if (hash_map->incremental_resize)
+    {
+        return rg_hash_map_start_migration(hash_map, new_capacity);
+    }
+    if (hash_map->layout == RG_HASH_MAP_LAYOUT_GROUPED)
+    {
+        return rg_hash_map_grouped_resize(hash_map, new_capacity);
+    }
+    return rg_hash_map_linear_resize(hash_map, new_capacity);
+}
+
+/**
+ * Shrinks the map after an erasure if it became mostly empty.
+ * The map grows when it is full and shrinks when it is less than a quarter full, to half of the capacity or less. That way, after
+ * a resize in either direction, the number of entries has to double or halve before the next one: a map whose size oscillates
+ * is not resized every time.
+ */
+void rg_hash_map_shrink_if_sparse(rg_hash_map *hash_map)
+{
+    if (hash_map->old_capacity > 0 || hash_map->capacity <= RG_HASH_MAP_MIN_SHRINK_CAPACITY
+        || hash_map->capacity <= hash_map->min_capacity || hash_map->count * 4 >= rg_hash_map_max_load(hash_map, hash_map->capacity))
+    {
+        return;
+    }
+
+    // Leave room for as many entries as there are now, so that the next insertions don't grow the map right away
+    size_t new_capacity = rg_hash_map_capacity_for(hash_map, hash_map->count * 2);
+    if (new_capacity < hash_map->min_capacity)
+    {
+        new_capacity = hash_map->min_capacity;
+    }
+
+    // If the allocation fails, keep the current arrays, they are still valid
+    if (hash_map->incremental_resize)
+    {
+        rg_hash_map_start_migration(hash_map, new_capacity);
+    }
+    else
+    {
+        rg_hash_map_resize(hash_map, new_capacity);
+    }
 }
 
-bool rg_init_hash_map(rg_hash_map *hash_map)
+// --=== Init ===--
+
+bool rg_init_hash_map(rg_hash_map *hash_map, const rg_hash_map_create_info *create_info)
 {
-    // Allocate array
-    hash_map->capacity = 1;
-    hash_map->count    = 0;
-    hash_map->data     = rg_calloc(hash_map->capacity, sizeof(rg_hash_map_entry));
-    if (hash_map->data == NULL)
+    rg_hash_map_create_info info = {0};
+    if (create_info != NULL)
+    {
+        info = *create_info;
+    }
+
+    // Use the default load factor of the layout if none is given, otherwise make sure that it stays reasonable
+    if (info.max_load_factor <= 0.0f)
+    {
+        info.max_load_factor = info.layout == RG_HASH_MAP_LAYOUT_GROUPED ? RG_HASH_MAP_GROUPED_DEFAULT_MAX_LOAD_FACTOR
+                                                                         : RG_HASH_MAP_LINEAR_DEFAULT_MAX_LOAD_FACTOR;
+    }
+    else if (info.max_load_factor < RG_HASH_MAP_MIN_MAX_LOAD_FACTOR)
+    {
+        info.max_load_factor = RG_HASH_MAP_MIN_MAX_LOAD_FACTOR;
+    }
+    else if (info.max_load_factor > RG_HASH_MAP_MAX_MAX_LOAD_FACTOR)
+    {
+        info.max_load_factor = RG_HASH_MAP_MAX_MAX_LOAD_FACTOR;
+    }
+
+    hash_map->layout             = info.layout;
+    hash_map->pfn_hash           = info.pfn_hash;
+    hash_map->max_load_factor    = info.max_load_factor;
+    hash_map->incremental_resize = info.incremental_resize;
+    hash_map->compact            = info.compact;
+    hash_map->use_inline_entries = !info.disable_inline_entries;
+    hash_map->allocator          = info.allocator;
+    hash_map->count              = 0;
+    hash_map->growth_left        = 0;
+    hash_map->min_capacity       = 0;
+    hash_map->control            = NULL;
+    hash_map->occupancy          = NULL;
+    hash_map->data               = NULL;
+    hash_map->capacity           = 0;
+    hash_map->old_data           = NULL;
+    hash_map->old_control        = NULL;
+    hash_map->old_occupancy      = NULL;
+    hash_map->old_capacity       = 0;
+    hash_map->old_count          = 0;
+    hash_map->migration_index    = 0;
+
+    // Small maps start with inline entries, the arrays are only allocated when they are needed
+    if (hash_map->use_inline_entries && info.initial_capacity <= RG_HASH_MAP_INLINE_CAPACITY)
+    {
+        return true;
+    }
+
+    // Allocate the arrays directly with the right size, so that no rehash is needed until the initial capacity is reached
+    size_t capacity = rg_hash_map_capacity_for(hash_map, info.initial_capacity);
+    if (capacity == 0)
     {
         return false;
     }
-    return true;
+    if (info.initial_capacity > 0)
+    {
+        hash_map->min_capacity = capacity;
+    }
+    return rg_hash_map_resize(hash_map, capacity);
+}
+
+void rg_cleanup_hash_map(rg_hash_map *hash_map)
+{
+    // There are no arrays while the entries are inline
+    if (hash_map->capacity == 0)
+    {
+        return;
+    }
+
+    // Drop the resize in progress, if any
+    rg_hash_map_free_old_table(hash_map);
+
+    if (hash_map->data != NULL)
+    {
+        rg_allocator_free(hash_map->allocator, hash_map->data);
+        hash_map->data = NULL;
+    }
+    if (hash_map->control != NULL)
+    {
+        rg_allocator_free(hash_map->allocator, hash_map->control);
+        hash_map->control = NULL;
+    }
+    if (hash_map->occupancy != NULL)
+    {
+        rg_allocator_free(hash_map->allocator, hash_map->occupancy);
+        hash_map->occupancy = NULL;
+    }
 }
 
 // --=== Hash map ===--
@@ -145,15 +1240,29 @@ bool rg_init_hash_map(rg_hash_map *hash_map)
 
 rg_hash_map *rg_create_hash_map(void)
 {
-    rg_hash_map *map = rg_malloc(sizeof(rg_hash_map));
+    return rg_create_hash_map_with_info(NULL);
+}
+
+rg_hash_map *rg_create_hash_map_with_capacity(size_t capacity)
+{
+    rg_hash_map_create_info create_info = {
+        .initial_capacity = capacity,
+    };
+    return rg_create_hash_map_with_info(&create_info);
+}
+
+rg_hash_map *rg_create_hash_map_with_info(const rg_hash_map_create_info *create_info)
+{
+    const rg_allocator *allocator = create_info != NULL ? create_info->allocator : NULL;
+    rg_hash_map        *map       = rg_allocator_alloc(allocator, sizeof(rg_hash_map));
     if (map == NULL)
     {
         return NULL;
     }
 
-    if (!rg_init_hash_map(map))
+    if (!rg_init_hash_map(map, create_info))
     {
-        rg_free(map);
+        rg_allocator_free(allocator, map);
         return NULL;
     }
 
@@ -163,14 +1272,15 @@ rg_hash_map *rg_create_hash_map(void)
 void rg_destroy_hash_map(rg_hash_map **p_hash_map)
 {
     // Free the data
-    rg_free((*p_hash_map)->data);
+    rg_cleanup_hash_map(*p_hash_map);
 
     // Free the map
-    rg_free(*p_hash_map);
+    rg_allocator_free((*p_hash_map)->allocator, *p_hash_map);
     *p_hash_map = NULL;
 }
 
-rg_hash_map_get_result rg_hash_map_get(rg_hash_map *hash_map, rg_hash_map_key_t key)
+/** Gets the value of a key whose hash is already computed. */
+static inline rg_hash_map_get_result rg_hash_map_get_hashed(rg_hash_map *hash_map, rg_hash_map_key_t key, uint64_t hash)
 {
     // Directly filter invalid keys
     if (key == RG_HASH_MAP_NULL_KEY)
@@ -178,50 +1288,219 @@ rg_hash_map_get_result rg_hash_map_get(rg_hash_map *hash_map, rg_hash_map_key_t
         return (rg_hash_map_get_result) {.exists = false};
     }
 
-    // Compute the index of the key in the array
-    size_t index = (size_t) (rg_hash_map_hash(key) & ((uint64_t) hash_map->capacity - 1));
+    size_t index = rg_hash_map_find_hashed(hash_map, key, hash);
+    if (index != RG_HASH_MAP_NOT_FOUND)
+    {
+        return (rg_hash_map_get_result) {
+            .value  = rg_hash_map_entry_at(hash_map, hash_map->data, index).value,
+            .exists = true,
+        };
+    }
 
-    // Search for the value in the location, until we find an empty slot
-    while (hash_map->data[index].key != RG_HASH_MAP_NULL_KEY)
+    // During a resize, the key may not be migrated yet
+    if (hash_map->old_capacity > 0)
     {
-        // If the key is the same, we found the good slot !
-        if (key == hash_map->data[index].key)
+        rg_hash_map old_table = rg_hash_map_old_table(hash_map);
+        index                 = rg_hash_map_find(&old_table, key);
+        if (index != RG_HASH_MAP_NOT_FOUND)
         {
             return (rg_hash_map_get_result) {
-                .value  = hash_map->data[index].value,
+                .value  = rg_hash_map_entry_at(hash_map, old_table.data, index).value,
                 .exists = true,
             };
         }
-
-        index++;
-        // Wrap around to stay inside the array
-        if (index >= hash_map->capacity)
+    }
+    return (rg_hash_map_get_result) {.exists = false};
+}
+
+rg_hash_map_get_result rg_hash_map_get(rg_hash_map *hash_map, rg_hash_map_key_t key)
+{
+    // Small maps don't need the hash
+    if (hash_map->capacity == 0)
+    {
+        return rg_hash_map_inline_get(hash_map, key);
+    }
+    return rg_hash_map_get_hashed(hash_map, key, rg_hash_map_hash_key(hash_map, key));
+}
+
+void rg_hash_map_get_many(rg_hash_map *hash_map, const rg_hash_map_key_t *keys, size_t count, rg_hash_map_get_result *results)
+{
+    // The inline entries are already in the cache
+    if (hash_map->capacity == 0)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            results[i] = rg_hash_map_inline_get(hash_map, keys[i]);
+        }
+        return;
+    }
+
+    // The lookups of independent keys don't depend on each other, so the slots of the next keys can be loaded while the current one
+    // is compared. The hashes of the prefetched keys are kept in a ring buffer so that they are only computed once.
+    uint64_t hashes[RG_HASH_MAP_PREFETCH_DISTANCE];
+    for (size_t i = 0; i < count && i < RG_HASH_MAP_PREFETCH_DISTANCE; i++)
+    {
+        hashes[i] = rg_hash_map_hash_key(hash_map, keys[i]);
+        rg_hash_map_prefetch(hash_map, hashes[i]);
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t   slot = i & (RG_HASH_MAP_PREFETCH_DISTANCE - 1);
+        uint64_t hash = hashes[slot];
+
+        if (i + RG_HASH_MAP_PREFETCH_DISTANCE < count)
+        {
+            hashes[slot] = rg_hash_map_hash_key(hash_map, keys[i + RG_HASH_MAP_PREFETCH_DISTANCE]);
+            rg_hash_map_prefetch(hash_map, hashes[slot]);
+        }
+
+        results[i] = rg_hash_map_get_hashed(hash_map, keys[i], hash);
+    }
+}
+
+bool rg_hash_map_set(rg_hash_map *hash_map, rg_hash_map_key_t key, rg_hash_map_value_t value)
+{
+    // Prevent the use of the zero key, which is reserved for the empty entry
+    if (key == RG_HASH_MAP_NULL_KEY)
+    {
+        return false;
+    }
+
+    // If the entry doesn't fit in a compact map, convert it first
+    if (hash_map->compact && (key > UINT32_MAX || value.as_num > UINT32_MAX) && !rg_hash_map_widen(hash_map))
+    {
+        return false;
+    }
+
+    if (hash_map->capacity == 0)
+    {
+        // If the key already exists, edit the value
+        size_t index = rg_hash_map_inline_find(hash_map, key);
+        if (index != RG_HASH_MAP_NOT_FOUND)
+        {
+            hash_map->inline_entries[index].value = value;
+            return true;
+        }
+
+        // Otherwise, add it after the others if there is room left
+        if (hash_map->count < RG_HASH_MAP_INLINE_CAPACITY)
+        {
+            hash_map->inline_entries[hash_map->count] = (rg_hash_map_entry) {
+                .key   = key,
+                .value = value,
+            };
+            hash_map->count++;
+            return true;
+        }
+
+        // The map is too big to stay inline: switch to the arrays and insert the key there
+        if (!rg_hash_map_resize(hash_map, rg_hash_map_capacity_for(hash_map, hash_map->count + 1)))
+        {
+            return false;
+        }
+    }
+
+    // Continue the resize in progress, if any
+    rg_hash_map_migrate(hash_map, RG_HASH_MAP_MIGRATION_STEPS);
+
+    // If the key already exists, edit the value
+    uint64_t hash  = rg_hash_map_hash_key(hash_map, key);
+    size_t   index = rg_hash_map_find_hashed(hash_map, key, hash);
+    if (index != RG_HASH_MAP_NOT_FOUND)
+    {
+        rg_hash_map_store_value(hash_map, hash_map->data, index, value);
+        return true;
+    }
+    if (hash_map->old_capacity > 0)
+    {
+        rg_hash_map old_table = rg_hash_map_old_table(hash_map);
+        index                 = rg_hash_map_find(&old_table, key);
+        if (index != RG_HASH_MAP_NOT_FOUND)
+        {
+            rg_hash_map_store_value(hash_map, old_table.data, index, value);
+            return true;
+        }
+    }
+
+    // Make room if the map would become too full
+    if (hash_map->growth_left == 0 && !rg_hash_map_grow(hash_map))
+    {
+        return false;
+    }
+
+    rg_hash_map_insert_new(hash_map, key, value, hash);
+    return true;
+}
+
+size_t rg_hash_map_count(rg_hash_map *hash_map)
+{
+    return hash_map->count;
+}
+
+bool rg_hash_map_reserve(rg_hash_map *hash_map, size_t count)
+{
+    // The inline entries are enough
+    if (hash_map->capacity == 0 && count <= RG_HASH_MAP_INLINE_CAPACITY)
+    {
+        return true;
+    }
+
+    size_t required_capacity = rg_hash_map_capacity_for(hash_map, count);
+    if (required_capacity == 0)
+    {
+        return false;
+    }
+
+    // The reserved capacity must not be taken back by the automatic shrinking
+    // It is only recorded once the map can hold it, so that a failed reservation leaves the map unchanged
+    size_t min_capacity = required_capacity > hash_map->min_capacity ? required_capacity : hash_map->min_capacity;
+
+    if (required_capacity > hash_map->capacity)
+    {
+        if (!rg_hash_map_resize(hash_map, required_capacity))
+        {
+            return false;
+        }
+    }
+    // The capacity is big enough, but tombstones may still use some of the growth: rehash to remove them
+    else if (count > hash_map->count && hash_map->growth_left < count - hash_map->count)
+    {
+        if (!rg_hash_map_resize(hash_map, hash_map->capacity))
         {
-            index = 0;
+            return false;
         }
     }
-    return (rg_hash_map_get_result) {
-        .exists = false,
-    };
+
+    hash_map->min_capacity = min_capacity;
+    return true;
 }
 
-bool rg_hash_map_set(rg_hash_map *hash_map, rg_hash_map_key_t key, rg_hash_map_value_t value)
+bool rg_hash_map_shrink_to_fit(rg_hash_map *hash_map)
 {
-    // Expand the capacity of the array if it is more than half full
-    if (hash_map->count >= hash_map->capacity / 2)
+    // Forget the reservations, the user explicitly wants the smallest map
+    hash_map->min_capacity = 0;
+
+    // Small maps can go back to the inline entries
+    if (hash_map->use_inline_entries && hash_map->count <= RG_HASH_MAP_INLINE_CAPACITY)
     {
-        if (!rg_hash_map_expand(hash_map))
+        if (hash_map->capacity > 0)
         {
-            return false;
+            rg_hash_map_move_arrays_to_inline_entries(hash_map);
         }
+        return true;
     }
 
-    return rg_hash_map_set_entry(hash_map->data, hash_map->capacity, key, value, &hash_map->count);
-}
+    // The grouped layout is also rehashed when the capacity doesn't change, to remove the tombstones
+    size_t new_capacity = rg_hash_map_capacity_for(hash_map, hash_map->count);
+    if (new_capacity < hash_map->capacity || hash_map->layout == RG_HASH_MAP_LAYOUT_GROUPED)
+    {
+        return rg_hash_map_resize(hash_map, new_capacity);
+    }
 
-size_t rg_hash_map_count(rg_hash_map *hash_map)
-{
-    return hash_map->count;
+    // Still finish the resize in progress, to free the old arrays
+    rg_hash_map_migrate(hash_map, SIZE_MAX);
+    return true;
 }
 
 rg_hash_map_it rg_hash_map_iterator(rg_hash_map *hash_map)
@@ -236,128 +1515,202 @@ rg_hash_map_it rg_hash_map_iterator(rg_hash_map *hash_map)
 bool rg_hash_map_next(rg_hash_map_it *it)
 {
     rg_hash_map *map = it->hash_map;
-    while (it->next_index < map->capacity)
+
+    // Inline entries don't have empty slots
+    if (map->capacity == 0)
     {
-        size_t i = it->next_index;
+        if (it->next_index < map->count)
+        {
+            it->key   = map->inline_entries[it->next_index].key;
+            it->value = map->inline_entries[it->next_index].value;
+            it->next_index++;
+            return true;
+        }
+        it->key   = RG_HASH_MAP_NULL_KEY;
+        it->value = (rg_hash_map_value_t) {NULL};
+        return false;
+    }
 
-        // Increment index
-        it->next_index++;
+    // During a resize, the old arrays are iterated after the new ones, as if they were concatenated
+    for (;;)
+    {
+        // Load the next chunk when the current one is exhausted
+        while (it->pending_slots == 0)
+        {
+            if (it->next_index >= map->capacity + map->old_capacity)
+            {
+                // When the loop is finished, there are no more elements in the map
+                it->key   = RG_HASH_MAP_NULL_KEY;
+                it->value = (rg_hash_map_value_t) {NULL};
+                return false;
+            }
+
+            // Both tables have a power of two capacity, so the chunks never overlap them
+            const rg_hash_map *table       = map;
+            size_t             local_index = it->next_index;
+            rg_hash_map        old_table;
+            if (local_index >= map->capacity)
+            {
+                old_table = rg_hash_map_old_table(map);
+                table     = &old_table;
+                local_index -= map->capacity;
+            }
+            size_t width = rg_hash_map_chunk_width(map);
+
+            it->pending_slots = rg_hash_map_occupied_slots(table, local_index);
+            it->chunk_start   = it->next_index;
+            it->next_index += width < table->capacity ? width : table->capacity;
+        }
+
+        size_t i = it->chunk_start + rg_hash_map_count_trailing_zeros_64(it->pending_slots);
+        it->pending_slots &= it->pending_slots - 1;
+
+        rg_hash_map_entry entry = i < map->capacity ? rg_hash_map_entry_at(map, map->data, i)
+                                                    : rg_hash_map_entry_at(map, map->old_data, i - map->capacity);
 
-        // If the slot is not empty, use it
-        if (map->data[i].key != RG_HASH_MAP_NULL_KEY)
+        // The slot may have been emptied since the chunk was loaded
+        if (entry.key != RG_HASH_MAP_NULL_KEY)
         {
-            it->key   = map->data[i].key;
-            it->value = map->data[i].value;
+            it->key   = entry.key;
+            it->value = entry.value;
             return true;
         }
     }
-
-    // When the loop is finished, there are no more elements in the map
-    it->key   = RG_HASH_MAP_NULL_KEY;
-    it->value = (rg_hash_map_value_t) {NULL};
-    return false;
 }
 
 void rg_hash_map_erase(rg_hash_map *hash_map, rg_hash_map_key_t key)
 {
-    // Compute the index of the key in the array
-    size_t index = (size_t) (rg_hash_map_hash(key) & ((uint64_t) hash_map->capacity - 1));
-
-    rg_hash_map_entry *deleted_slot           = NULL;
-    size_t             deleted_index          = 0;
-    size_t             invalidated_block_size = 0;
+    if (key == RG_HASH_MAP_NULL_KEY)
+    {
+        return;
+    }
 
-    while (hash_map->data[index].key != RG_HASH_MAP_NULL_KEY)
+    // Keep the inline entries packed by moving the last one in the hole
+    if (hash_map->capacity == 0)
     {
-        // We found the slot to remove if the key is the same
-        if (key == hash_map->data[index].key)
+        size_t index = rg_hash_map_inline_find(hash_map, key);
+        if (index != RG_HASH_MAP_NOT_FOUND)
         {
-            deleted_slot  = &hash_map->data[index];
-            deleted_index = index;
+            hash_map->count--;
+            hash_map->inline_entries[index] = hash_map->inline_entries[hash_map->count];
         }
+        return;
+    }
 
-        // If the deleted slot is not NULL, then we are between it and the NULL key
-        // The current slot may then become inaccessible. We need to invalidate it.
-        // For that, we need to count the number of slots between the deleted slot and the NULL key
-        if (deleted_slot != NULL)
-        {
-            invalidated_block_size++;
-        }
+    // Continue the resize in progress, if any
+    rg_hash_map_migrate(hash_map, RG_HASH_MAP_MIGRATION_STEPS);
 
-        // Else, increment to find the next empty slot
-        index++;
-        // Wrap around to stay inside the array
-        if (index >= hash_map->capacity)
+    size_t index = rg_hash_map_find(hash_map, key);
+    if (index != RG_HASH_MAP_NOT_FOUND)
+    {
+        rg_hash_map_erase_at(hash_map, index);
+        rg_hash_map_shrink_if_sparse(hash_map);
+        return;
+    }
+
+    // During a resize, the key may not be migrated yet
+    if (hash_map->old_capacity > 0)
+    {
+        rg_hash_map old_table = rg_hash_map_old_table(hash_map);
+        index                 = rg_hash_map_find(&old_table, key);
+        if (index != RG_HASH_MAP_NOT_FOUND)
         {
-            index = 0;
+            rg_hash_map_erase_at(&old_table, index);
+            hash_map->old_count--;
+            hash_map->count--;
         }
     }
+}
+
 
-    // If we found a slot to remove, remove it and add the next ones again
-    if (deleted_slot != NULL)
+void rg_hash_map_clear(rg_hash_map *hash_map) {
+    if (hash_map->capacity == 0)
     {
-        // If we have other slots to invalidate, store them in another array first and set them to NULL
-        rg_hash_map_entry *invalidated_slots = NULL;
-        if (invalidated_block_size > 1)
-        {
-            invalidated_slots = rg_malloc(sizeof(rg_hash_map_entry) * (invalidated_block_size - 1));
+        hash_map->count = 0;
+        return;
+    }
 
-            // Copy the invalidated slots. Wrap around if needed
-            size_t j = (deleted_index + 1) % hash_map->capacity;
-            for (size_t i = 0; i < invalidated_block_size - 1; i++)
-            {
-                // Copy the slot
-                invalidated_slots[i] = hash_map->data[j];
-                // Set it to NULL
-                hash_map->data[j] = (rg_hash_map_entry) {
-                    .key   = RG_HASH_MAP_NULL_KEY,
-                    .value = (rg_hash_map_value_t) {NULL},
-                };
-
-                // Increment the index
-                j++;
-                // Wrap around to stay inside the array
-                if (j >= hash_map->capacity)
-                {
-                    j = 0;
-                }
-            }
-        }
+    // Every entry is removed anyway, so the resize in progress can be finished instantly
+    rg_hash_map_free_old_table(hash_map);
 
-        // Set the deleted slot to NULL
-        *deleted_slot = (rg_hash_map_entry) {
-            .key   = RG_HASH_MAP_NULL_KEY,
-            .value = (rg_hash_map_value_t) {NULL},
-        };
+    if (hash_map->layout == RG_HASH_MAP_LAYOUT_GROUPED)
+    {
+        // Also remove the tombstones, even if the map is empty
+        memset(hash_map->control, RG_HASH_MAP_CTRL_EMPTY, hash_map->capacity);
+        memset(hash_map->data, 0, hash_map->capacity * rg_hash_map_entry_size(hash_map));
+        hash_map->count       = 0;
+        hash_map->growth_left = rg_hash_map_max_load(hash_map, hash_map->capacity);
+        return;
+    }
+
+    if (hash_map->count > 0)
+    {
+        memset(hash_map->data, 0, hash_map->capacity * rg_hash_map_entry_size(hash_map));
+        memset(hash_map->occupancy, 0, rg_hash_map_occupancy_word_count(hash_map->capacity) * sizeof(uint64_t));
+        hash_map->count       = 0;
+        hash_map->growth_left = rg_hash_map_max_load(hash_map, hash_map->capacity);
+    }
+}
+
+rg_hash_map_stats rg_hash_map_get_stats(rg_hash_map *hash_map)
+{
+    // Only the layout of the new arrays matters
+    rg_hash_map_migrate(hash_map, SIZE_MAX);
+
+    rg_hash_map_stats stats = {
+        .count    = hash_map->count,
+        .capacity = hash_map->capacity,
+    };
+
+    // Inline entries are found without probing
+    if (hash_map->capacity == 0)
+    {
+        stats.probe_length_histogram[0] = hash_map->count;
+        return stats;
+    }
 
-        // Decrement the count. We remove the whole size of the block because the set function will increment it again
-        hash_map->count--;
+    size_t total_probe_length = 0;
+    for (size_t i = 0; i < hash_map->capacity; i++)
+    {
+        rg_hash_map_key_t key = rg_hash_map_key_at(hash_map, hash_map->data, i);
+        if (key == RG_HASH_MAP_NULL_KEY)
+        {
+            continue;
+        }
 
-        // If we have slots to invalidate, add them back
-        if (invalidated_slots != NULL)
+        // Compute the number of steps from the ideal position of the key
+        uint64_t hash         = rg_hash_map_hash_key(hash_map, key);
+        size_t   probe_length = 0;
+        if (hash_map->layout == RG_HASH_MAP_LAYOUT_GROUPED)
         {
-            for (size_t i = 0; i < invalidated_block_size - 1; i++)
+            // Replay the probe sequence until the group of the slot is reached
+            size_t group_mask = hash_map->capacity / RG_HASH_MAP_GROUP_WIDTH - 1;
+            size_t group      = rg_hash_map_h1(hash) & group_mask;
+            while (group != i / RG_HASH_MAP_GROUP_WIDTH)
             {
-                rg_hash_map_set_entry(hash_map->data, hash_map->capacity, invalidated_slots[i].key, invalidated_slots[i].value, NULL);
+                probe_length++;
+                group = (group + probe_length) & group_mask;
             }
-            rg_free(invalidated_slots);
         }
-    }
-}
+        else
+        {
+            probe_length = rg_hash_map_linear_probe_distance(hash_map, hash_map->data, hash_map->control, hash_map->capacity - 1, i);
+        }
 
+        total_probe_length += probe_length;
+        if (probe_length > stats.max_probe_length)
+        {
+            stats.max_probe_length = probe_length;
+        }
+        stats.probe_length_histogram[probe_length < RG_HASH_MAP_PROBE_HISTOGRAM_SIZE ? probe_length
+                                                                                      : RG_HASH_MAP_PROBE_HISTOGRAM_SIZE - 1]++;
+    }
 
-void rg_hash_map_clear(rg_hash_map *hash_map) {
     if (hash_map->count > 0)
     {
-        for (size_t i = 0; i < hash_map->capacity; i++)
-        {
-            hash_map->data[i] = (rg_hash_map_entry) {
-                .key   = RG_HASH_MAP_NULL_KEY,
-                .value = (rg_hash_map_value_t) {NULL},
-            };
-        }
-        hash_map->count = 0;
+        stats.mean_probe_length = (double) total_probe_length / (double) hash_map->count;
     }
+    return stats;
 }
 
 // endregion
@@ -371,43 +1724,118 @@ void rg_hash_map_clear(rg_hash_map *hash_map) {
 typedef struct rg_struct_map
 {
     rg_hash_map hash_map; // We take advantage of the fact that we are in the same c file to avoid a pointer here
-    rg_vector   storage;
-    size_t      value_size;
+    // The values and their keys are stored in two parallel vectors: the key of the value i is the key i.
+    // That way, the values are packed without keys between them, and a scan of the values doesn't load the keys.
+    // Storing the keys allows to create an iterator that does not even look at the hash map.
+    rg_vector values;
+    rg_vector keys;
+    size_t    value_size;
+    // In paged mode, the values are stored in a paged pool instead, so that they are never moved.
+    // The keys vector is then indexed by the indices of the pool, and has holes where the pool does.
+    bool          paged;
+    rg_paged_pool pool;
 } rg_struct_map;
 
 // --=== Utils functions ===--
 
-rg_hash_map_key_t rg_struct_map_get_key_of_storage_element(rg_struct_map *struct_map, void *p_storage_element)
+static inline rg_hash_map_key_t rg_struct_map_key_at(rg_struct_map *struct_map, size_t index)
 {
-    return *(rg_hash_map_key_t *) (((char *) p_storage_element) + struct_map->value_size);
+    return ((rg_hash_map_key_t *) struct_map->keys.data)[index];
+}
+
+static inline void *rg_struct_map_value_at(rg_struct_map *struct_map, size_t index)
+{
+    if (struct_map->paged)
+    {
+        return rg_paged_pool_get(&struct_map->pool, index);
+    }
+    return rg_vector_get_element(&struct_map->values, index);
 }
 
 // --=== Functions ===--
 
-rg_struct_map *rg_create_struct_map(size_t value_size)
+static rg_struct_map *rg_create_struct_map_internal(size_t                         value_size,
+                                                    size_t                         value_alignment,
+                                                    const rg_hash_map_create_info *hash_map_info,
+                                                    bool                           paged)
 {
-    rg_struct_map *map = rg_malloc(sizeof(rg_struct_map));
+    if (value_alignment == 0)
+    {
+        value_alignment = 1;
+    }
+    if ((value_alignment & (value_alignment - 1)) != 0)
+    {
+        return NULL;
+    }
+
+    // The values of the hash map are indices in the storage, so they fit in 32 bits.
+    // Most keys are ids that fit too, otherwise the map will be converted.
+    rg_hash_map_create_info default_info = {
+        .compact = true,
+    };
+    if (hash_map_info == NULL)
+    {
+        hash_map_info = &default_info;
+    }
+
+    // Everything is allocated with the allocator of the hash map
+    // It only guarantees the fundamental alignment, so the values that need more are allocated on the heap
+    const rg_allocator *allocator    = hash_map_info->allocator;
+    bool                over_aligned = value_alignment > _Alignof(max_align_t);
+    if (over_aligned && allocator != NULL)
+    {
+        return NULL;
+    }
+    rg_struct_map *map = rg_allocator_alloc(allocator, sizeof(rg_struct_map));
     if (map == NULL)
     {
         return NULL;
     }
 
     // Init the hash map
-    if (!rg_init_hash_map(&map->hash_map))
+    if (!rg_init_hash_map(&map->hash_map, hash_map_info))
     {
-        rg_free(map);
+        rg_allocator_free(allocator, map);
         return NULL;
     }
 
-    // Init the vector
-    // The element size is value_size + size of key
-    // That way, the storage will consist of an array alternating values and keys
-    // Storing the key in the storage allows to create an iterator that does not even look at the hash map
-    if (!rg_create_vector(2, value_size + sizeof(rg_hash_map_key_t), &map->storage))
+    // Init the vectors
+    // Pad the values so that each one starts at a multiple of the alignment
+    // In paged mode, the values vector is left unallocated
+    size_t value_stride = (value_size + value_alignment - 1) & ~(value_alignment - 1);
+    map->paged          = paged;
+    map->values         = (rg_vector) {0};
+    bool values_success = false;
+    if (paged)
+    {
+        values_success = rg_create_paged_pool_with_allocator(value_size, value_alignment, allocator, &map->pool);
+    }
+    else if (over_aligned)
+    {
+        values_success = rg_create_vector_aligned(2, value_stride, value_alignment, &map->values);
+    }
+    else
     {
-        rg_hash_map *hash_map = &map->hash_map;
-        rg_destroy_hash_map(&hash_map);
-        rg_free(map);
+        values_success = rg_create_vector_with_allocator(2, value_stride, allocator, &map->values);
+    }
+    if (!values_success)
+    {
+        rg_cleanup_hash_map(&map->hash_map);
+        rg_allocator_free(allocator, map);
+        return NULL;
+    }
+    if (!rg_create_vector_with_allocator(2, sizeof(rg_hash_map_key_t), allocator, &map->keys))
+    {
+        if (paged)
+        {
+            rg_destroy_paged_pool(&map->pool);
+        }
+        else
+        {
+            rg_destroy_vector(&map->values);
+        }
+        rg_cleanup_hash_map(&map->hash_map);
+        rg_allocator_free(allocator, map);
         return NULL;
     }
 
@@ -416,19 +1844,90 @@ rg_struct_map *rg_create_struct_map(size_t value_size)
     return map;
 }
 
+rg_struct_map *rg_create_struct_map(size_t value_size)
+{
+    return rg_create_struct_map_with_info(value_size, NULL);
+}
+
+rg_struct_map *rg_create_struct_map_with_info(size_t value_size, const rg_hash_map_create_info *hash_map_info)
+{
+    return rg_create_struct_map_aligned(value_size, 0, hash_map_info);
+}
+
+rg_struct_map *rg_create_struct_map_aligned(size_t value_size, size_t value_alignment, const rg_hash_map_create_info *hash_map_info)
+{
+    return rg_create_struct_map_internal(value_size, value_alignment, hash_map_info, false);
+}
+
+rg_struct_map *rg_create_struct_map_paged(size_t value_size, size_t value_alignment, const rg_hash_map_create_info *hash_map_info)
+{
+    return rg_create_struct_map_internal(value_size, value_alignment, hash_map_info, true);
+}
+
 void rg_destroy_struct_map(rg_struct_map **p_struct_map)
 {
-    // Destroy the vector
-    rg_destroy_vector(&(*p_struct_map)->storage);
+    // Destroy the vectors
+    if ((*p_struct_map)->paged)
+    {
+        rg_destroy_paged_pool(&(*p_struct_map)->pool);
+    }
+    else
+    {
+        rg_destroy_vector(&(*p_struct_map)->values);
+    }
+    rg_destroy_vector(&(*p_struct_map)->keys);
 
     // Destroy the hash map
-    rg_free((*p_struct_map)->hash_map.data);
+    rg_cleanup_hash_map(&(*p_struct_map)->hash_map);
 
     // Destroy the struct map
-    rg_free(*p_struct_map);
+    rg_allocator_free((*p_struct_map)->hash_map.allocator, *p_struct_map);
     *p_struct_map = NULL;
 }
 
+bool rg_struct_map_shrink_to_fit(rg_struct_map *struct_map)
+{
+    bool hash_map_success = rg_hash_map_shrink_to_fit(&struct_map->hash_map);
+    if (struct_map->paged)
+    {
+        // The keys after the last page are not used anymore
+        bool   pool_success = rg_paged_pool_shrink_to_fit(&struct_map->pool);
+        size_t key_count    = struct_map->pool.pages.count * RG_PAGED_POOL_PAGE_CAPACITY;
+        if (struct_map->keys.count > key_count)
+        {
+            struct_map->keys.count = key_count;
+        }
+        return hash_map_success && pool_success && rg_vector_shrink_to_fit(&struct_map->keys);
+    }
+
+    bool values_success = rg_vector_shrink_to_fit(&struct_map->values);
+    bool keys_success   = rg_vector_shrink_to_fit(&struct_map->keys);
+    return hash_map_success && values_success && keys_success;
+}
+
+size_t rg_struct_map_place_count(rg_struct_map *struct_map)
+{
+    // The keys vector follows the places, in both modes
+    return struct_map->keys.count;
+}
+
+bool rg_struct_map_reserve(rg_struct_map *struct_map, size_t count)
+{
+    if (!rg_hash_map_reserve(&struct_map->hash_map, count))
+    {
+        return false;
+    }
+    if (struct_map->paged)
+    {
+        if (!rg_paged_pool_reserve(&struct_map->pool, count))
+        {
+            return false;
+        }
+        return rg_vector_reserve(&struct_map->keys, struct_map->pool.pages.count * RG_PAGED_POOL_PAGE_CAPACITY);
+    }
+    return rg_vector_reserve(&struct_map->values, count) && rg_vector_reserve(&struct_map->keys, count);
+}
+
 size_t rg_struct_map_count(rg_struct_map *struct_map)
 {
     // The keys are still managed by the hash map
@@ -444,11 +1943,34 @@ void *rg_struct_map_get(rg_struct_map *p_struct_map, rg_hash_map_key_t key)
     if (get_result.exists)
     {
         // There is a value, and the hash map returned its index in the storage
-        return rg_vector_get_element(&p_struct_map->storage, get_result.value.as_num);
+        return rg_struct_map_value_at(p_struct_map, get_result.value.as_num);
     }
     return NULL;
 }
 
+void rg_struct_map_get_many(rg_struct_map *struct_map, const rg_hash_map_key_t *keys, size_t count, void **values)
+{
+    rg_hash_map_get_result results[RG_STRUCT_MAP_BATCH_SIZE];
+
+    for (size_t offset = 0; offset < count; offset += RG_STRUCT_MAP_BATCH_SIZE)
+    {
+        size_t batch_size = count - offset < RG_STRUCT_MAP_BATCH_SIZE ? count - offset : RG_STRUCT_MAP_BATCH_SIZE;
+        rg_hash_map_get_many(&struct_map->hash_map, keys + offset, batch_size, results);
+
+        // The values are not read here, but the caller will probably do it right after, so start loading them
+        for (size_t i = 0; i < batch_size; i++)
+        {
+            void *value = NULL;
+            if (results[i].exists)
+            {
+                value = rg_struct_map_value_at(struct_map, results[i].value.as_num);
+                RG_PREFETCH(value);
+            }
+            values[offset + i] = value;
+        }
+    }
+}
+
 bool rg_struct_map_exists(rg_struct_map *struct_map, rg_hash_map_key_t key)
 {
     // Check if there is already a value there in the map
@@ -457,6 +1979,50 @@ bool rg_struct_map_exists(rg_struct_map *struct_map, rg_hash_map_key_t key)
     return get_result.exists;
 }
 
+void *rg_struct_map_values(rg_struct_map *struct_map, size_t *p_stride)
+{
+    // The pages are not contiguous
+    if (struct_map->paged)
+    {
+        return NULL;
+    }
+
+    if (p_stride != NULL)
+    {
+        *p_stride = struct_map->values.element_size;
+    }
+    return struct_map->values.data;
+}
+
+/** Inserts a new value in a free place of the pages, which never moves afterwards. */
+static void *rg_struct_map_paged_insert(rg_struct_map *struct_map, rg_hash_map_key_t key, void *p_data)
+{
+    size_t index;
+    void  *p_value = rg_paged_pool_acquire(&struct_map->pool, &index);
+    if (p_value == NULL)
+    {
+        return NULL;
+    }
+
+    // The keys vector follows the indices of the pool
+    while (struct_map->keys.count <= index)
+    {
+        if (rg_vector_push_back_no_data(&struct_map->keys) == NULL)
+        {
+            rg_paged_pool_release(&struct_map->pool, index);
+            return NULL;
+        }
+    }
+
+    if (!rg_hash_map_set(&struct_map->hash_map, key, (rg_hash_map_value_t) {.as_num = index}))
+    {
+        rg_paged_pool_release(&struct_map->pool, index);
+        return NULL;
+    }
+    ((rg_hash_map_key_t *) struct_map->keys.data)[index] = key;
+    return memcpy(p_value, p_data, struct_map->value_size);
+}
+
 void *rg_struct_map_set(rg_struct_map *p_struct_map, rg_hash_map_key_t key, void *p_data)
 {
     // Check if there is already a value there in the map
@@ -467,44 +2033,50 @@ void *rg_struct_map_set(rg_struct_map *p_struct_map, rg_hash_map_key_t key, void
     if (get_result.exists)
     {
         // There is a value: there is a place in the storage we can modify.
-        p_data_in_storage = rg_vector_get_element(&p_struct_map->storage, get_result.value.as_num);
+        p_data_in_storage = rg_struct_map_value_at(p_struct_map, get_result.value.as_num);
         if (p_data_in_storage != NULL)
         {
             return memcpy(p_data_in_storage, p_data, p_struct_map->value_size);
         }
         // We don't need to update the map nor the key since it points to a valid storage element.
     }
+    else if (p_struct_map->paged)
+    {
+        p_data_in_storage = rg_struct_map_paged_insert(p_struct_map, key, p_data);
+    }
     else
     {
-        // There is no value: we need to push the data in a new storage index.
-        p_data_in_storage = rg_vector_push_back_no_data(&p_struct_map->storage);
+        // There is no value: we need to push the data and the key at a new storage index.
+        p_data_in_storage                = rg_vector_push_back_no_data(&p_struct_map->values);
+        rg_hash_map_key_t *p_key_storage = p_data_in_storage != NULL ? rg_vector_push_back_no_data(&p_struct_map->keys) : NULL;
 
         // If it worked, in this case, we also need to update the map to point to our new storage slot.
-        if (p_data_in_storage != NULL)
+        if (p_key_storage != NULL)
         {
-            bool success = true;
-            // Store value
-            success = memcpy(p_data_in_storage, p_data, p_struct_map->value_size) != NULL;
-            if (success)
-            {
-                // Store key
-                *(rg_hash_map_key_t *) (((char *) p_data_in_storage) + p_struct_map->value_size) = key;
+            // Store value and key
+            memcpy(p_data_in_storage, p_data, p_struct_map->value_size);
+            *p_key_storage = key;
 
-                // Update hash map
-                success = rg_hash_map_set(&p_struct_map->hash_map,
-                                          key,
-                                          (rg_hash_map_value_t) {
-                                              .as_num = rg_vector_last_index(&p_struct_map->storage),
-                                          });
-            }
+            // Update hash map
+            bool success = rg_hash_map_set(&p_struct_map->hash_map,
+                                           key,
+                                           (rg_hash_map_value_t) {
+                                               .as_num = rg_vector_last_index(&p_struct_map->values),
+                                           });
 
             // If there was an error, we shouldn't keep the value in the storage.
             if (!success)
             {
-                rg_vector_pop_back(&p_struct_map->storage);
+                rg_vector_pop_back(&p_struct_map->keys);
+                rg_vector_pop_back(&p_struct_map->values);
                 p_data_in_storage = NULL;
             }
         }
+        else if (p_data_in_storage != NULL)
+        {
+            rg_vector_pop_back(&p_struct_map->values);
+            p_data_in_storage = NULL;
+        }
     }
 
     return p_data_in_storage;
@@ -514,48 +2086,128 @@ void rg_struct_map_erase(rg_struct_map *struct_map, rg_hash_map_key_t key)
 {
     // Look up the element
     rg_hash_map_get_result get_result = rg_hash_map_get(&struct_map->hash_map, key);
-    if (get_result.exists)
+    if (get_result.exists && struct_map->paged)
+    {
+        // The other values are never moved, the place is simply freed
+        rg_paged_pool_release(&struct_map->pool, get_result.value.as_num);
+        rg_hash_map_erase(&struct_map->hash_map, key);
+    }
+    else if (get_result.exists)
     {
         // We need to remove the element from the storage if it exists
         size_t deleted_slot_index = get_result.value.as_num;
-        size_t last_slot_index    = rg_vector_last_index(&struct_map->storage);
+        size_t last_slot_index    = rg_vector_last_index(&struct_map->values);
 
         bool success = true;
 
         // If it is not the last slot, move the last slot to the deleted slot, that way data stays packed together
         if (deleted_slot_index < last_slot_index)
         {
-            // Copy the last element to the deleted slot
-            success = rg_vector_copy(&struct_map->storage, last_slot_index, deleted_slot_index);
+            // Copy the last element and its key to the deleted slot
+            success = rg_vector_copy(&struct_map->values, last_slot_index, deleted_slot_index)
+                      && rg_vector_copy(&struct_map->keys, last_slot_index, deleted_slot_index);
             if (success)
             {
                 // In case of success, we need to update the map to move the element that was last
-                // For that, we can use the key that is stored with the data
-                void *p_updated_slot = rg_vector_get_element(&struct_map->storage, deleted_slot_index);
-                if (p_updated_slot != NULL)
-                {
-                    rg_hash_map_key_t last_elements_key = rg_struct_map_get_key_of_storage_element(struct_map, p_updated_slot);
-
-                    success = rg_hash_map_set_entry(struct_map->hash_map.data,
-                                                    struct_map->hash_map.capacity,
-                                                    last_elements_key,
-                                                    (rg_hash_map_value_t) {
-                                                        .as_num = deleted_slot_index,
-                                                    },
-                                                    &struct_map->hash_map.count);
-                }
+                // For that, we can use the key that is stored beside the data
+                rg_hash_map_key_t last_elements_key = rg_struct_map_key_at(struct_map, deleted_slot_index);
+
+                // The key already exists, so this only updates the value and never expands the map
+                success = rg_hash_map_set(&struct_map->hash_map,
+                                          last_elements_key,
+                                          (rg_hash_map_value_t) {
+                                              .as_num = deleted_slot_index,
+                                          });
             }
         }
 
         // Everything worked: we can pop the storage and remove the deleted key from the map
         if (success)
         {
-            rg_vector_pop_back(&struct_map->storage);
+            rg_vector_pop_back(&struct_map->values);
+            rg_vector_pop_back(&struct_map->keys);
             rg_hash_map_erase(&struct_map->hash_map, key);
         }
     }
 }
 
+static void rg_struct_map_move_place(size_t from, size_t to, void *p_struct_map)
+{
+    rg_struct_map *struct_map = p_struct_map;
+    rg_vector_copy(&struct_map->values, from, to);
+    rg_vector_copy(&struct_map->keys, from, to);
+
+    // The key exists, so this only updates its place
+    rg_hash_map_set(&struct_map->hash_map,
+                    rg_struct_map_key_at(struct_map, to),
+                    (rg_hash_map_value_t) {
+                        .as_num = to,
+                    });
+}
+
+size_t rg_struct_map_erase_many(rg_struct_map *struct_map, rg_hash_map_key_t *keys, size_t count)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    size_t *places = rg_allocator_alloc(struct_map->hash_map.allocator, count * sizeof(size_t));
+    if (places == NULL)
+    {
+        // Fall back to the erasures one by one
+        size_t erased_count = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (rg_struct_map_exists(struct_map, keys[i]))
+            {
+                rg_struct_map_erase(struct_map, keys[i]);
+                keys[erased_count++] = keys[i];
+            }
+        }
+        return erased_count;
+    }
+
+    // Remove the keys from the hash map, and remember their places
+    // A duplicate is not found anymore after the first erasure, so it is skipped
+    size_t erased_count = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        rg_hash_map_get_result get_result = rg_hash_map_get(&struct_map->hash_map, keys[i]);
+        if (get_result.exists)
+        {
+            rg_hash_map_erase(&struct_map->hash_map, keys[i]);
+            places[erased_count] = get_result.value.as_num;
+            keys[erased_count]   = keys[i];
+            erased_count++;
+        }
+    }
+
+    if (struct_map->paged)
+    {
+        // The values never move, only free their places
+        for (size_t i = 0; i < erased_count; i++)
+        {
+            rg_paged_pool_release(&struct_map->pool, places[i]);
+        }
+    }
+    else
+    {
+        // Fill the holes in one pass, each remaining value moves at most once
+        size_t new_count = rg_compact_places(struct_map->values.count,
+                                             places,
+                                             erased_count,
+                                             rg_struct_map_move_place,
+                                             struct_map,
+                                             struct_map->hash_map.allocator);
+        struct_map->values.count = new_count;
+        struct_map->keys.count   = new_count;
+    }
+
+    rg_allocator_free(struct_map->hash_map.allocator, places);
+    return erased_count;
+}
+
 rg_struct_map_it rg_struct_map_iterator(rg_struct_map *struct_map)
 {
     return (rg_struct_map_it) {
@@ -566,16 +2218,31 @@ rg_struct_map_it rg_struct_map_iterator(rg_struct_map *struct_map)
 
 bool rg_struct_map_next(rg_struct_map_it *it)
 {
-    rg_vector *storage = &it->struct_map->storage;
-    while (it->next_index < storage->count)
+    // Walk the pages, skipping the free places
+    if (it->struct_map->paged)
+    {
+        size_t index = it->next_index;
+        it->value    = rg_paged_pool_next(&it->struct_map->pool, &index);
+        if (it->value == NULL)
+        {
+            it->key = RG_HASH_MAP_NULL_KEY;
+            return false;
+        }
+        it->key        = rg_struct_map_key_at(it->struct_map, index);
+        it->next_index = index + 1;
+        return true;
+    }
+
+    rg_vector *values = &it->struct_map->values;
+    while (it->next_index < values->count)
     {
         size_t i = it->next_index;
 
         // Increment index
         it->next_index++;
 
-        it->value = ((char *) storage->data) + i * storage->element_size;
-        it->key   = rg_struct_map_get_key_of_storage_element(it->struct_map, it->value);
+        it->value = ((char *) values->data) + i * values->element_size;
+        it->key   = rg_struct_map_key_at(it->struct_map, i);
 
         return true;
     }
@@ -1,12 +1,144 @@
 #include "railguard/utils/memory.h"
 
-#ifdef MEMORY_CHECKS
+#include <stdint.h>
+#include <string.h>
+
+// --=== Allocators ===--
+
+void *rg_allocator_alloc_zeroed(const rg_allocator *allocator, size_t count, size_t size)
+{
+    if (size != 0 && count > SIZE_MAX / size)
+    {
+        return NULL;
+    }
+
+    void *ptr = rg_allocator_alloc(allocator, count * size);
+    if (ptr != NULL)
+    {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+// --=== Aligned allocations ===--
+
+// An aligned block is allocated with some padding, and the address returned by malloc is stored right before the aligned address
+// That way, it works with any allocator that respects the fundamental alignment
+
+/** Returns the alignment that will really be used, or 0 if it is not supported. */
+static size_t rg_aligned_block_alignment(size_t alignment)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        return 0;
+    }
+    return alignment < sizeof(void *) ? sizeof(void *) : alignment;
+}
+
+/** Returns the size of the block that must be allocated to hold size bytes aligned on alignment, or 0 if it overflows. */
+static size_t rg_aligned_block_size(size_t size, size_t alignment)
+{
+    size_t padding = alignment - 1 + sizeof(void *);
+    return size <= SIZE_MAX - padding ? size + padding : 0;
+}
+
+/** Returns the first address of the block that is aligned and leaves room for the address of the block before it. */
+static inline char *rg_aligned_block_find_start(void *block, size_t alignment)
+{
+    uintptr_t address = ((uintptr_t) block + sizeof(void *) + alignment - 1) & ~((uintptr_t) alignment - 1);
+    return (char *) address;
+}
+
+static void *rg_aligned_block_malloc(size_t size, size_t alignment)
+{
+    alignment         = rg_aligned_block_alignment(alignment);
+    size_t block_size = rg_aligned_block_size(size, alignment);
+    if (alignment == 0 || block_size == 0)
+    {
+        return NULL;
+    }
+
+    void *block = malloc(block_size);
+    if (block == NULL)
+    {
+        return NULL;
+    }
+    char *ptr           = rg_aligned_block_find_start(block, alignment);
+    ((void **) ptr)[-1] = block;
+    return ptr;
+}
+
+static void *rg_aligned_block_realloc(void *ptr, size_t size, size_t alignment)
+{
+    if (ptr == NULL)
+    {
+        return rg_aligned_block_malloc(size, alignment);
+    }
+    alignment         = rg_aligned_block_alignment(alignment);
+    size_t block_size = rg_aligned_block_size(size, alignment);
+    if (alignment == 0 || block_size == 0)
+    {
+        return NULL;
+    }
+
+    // Let realloc grow the block in place when it can
+    void  *block     = ((void **) ptr)[-1];
+    size_t offset    = (char *) ptr - (char *) block;
+    void  *new_block = realloc(block, block_size);
+    if (new_block == NULL)
+    {
+        return NULL;
+    }
+
+    // The new block may not have the same alignment, in which case the data must be moved to the new aligned start
+    // The data is moved before the address of the block is written, since they may overlap
+    char *new_ptr = rg_aligned_block_find_start(new_block, alignment);
+    if (new_ptr != (char *) new_block + offset)
+    {
+        memmove(new_ptr, (char *) new_block + offset, size);
+    }
+    ((void **) new_ptr)[-1] = new_block;
+    return new_ptr;
+}
+
+static void rg_aligned_block_free(void *ptr)
+{
+    free(((void **) ptr)[-1]);
+}
+
+#ifndef MEMORY_CHECKS
+
+void *rg_aligned_malloc(size_t size, size_t alignment)
+{
+    return rg_aligned_block_malloc(size, alignment);
+}
+
+void *rg_aligned_realloc(void *ptr, size_t size, size_t alignment)
+{
+    return rg_aligned_block_realloc(ptr, size, alignment);
+}
+
+void rg_aligned_free(void *ptr)
+{
+    if (ptr != NULL)
+    {
+        rg_aligned_block_free(ptr);
+    }
+}
+
+#else
 
 #include <railguard/utils/maps.h>
 #include <railguard/utils/storage.h>
 
 #include <stdio.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
 // --=== Memory watcher ===--
 
 // Types
@@ -33,14 +165,68 @@ typedef struct rg_mem_watcher
 {
     rg_struct_map *allocations;
     rg_storage *prevented_segfaults;
-    // Disable watch when inside a watcher function to avoid infinite recursion.
-    bool locked;
 } rg_mem_watcher;
 
 // Functions
 
 rg_mem_watcher *RG_MEMORY_WATCHER = NULL;
 
+// The tasks of a thread pool may allocate at the same time, so the maps of the watcher are protected by a mutex.
+// Each thread also remembers if it is inside a watcher function: the maps allocate with the watcher functions too, and tracking
+// these allocations would recurse infinitely.
+#ifdef _WIN32
+static SRWLOCK                 rg_mem_watcher_mutex = SRWLOCK_INIT;
+static __declspec(thread) bool rg_mem_watcher_busy  = false;
+#else
+static pthread_mutex_t    rg_mem_watcher_mutex = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local bool rg_mem_watcher_busy  = false;
+#endif
+
+static void rg_mem_watcher_lock_mutex(void)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&rg_mem_watcher_mutex);
+#else
+    pthread_mutex_lock(&rg_mem_watcher_mutex);
+#endif
+}
+
+static void rg_mem_watcher_unlock_mutex(void)
+{
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&rg_mem_watcher_mutex);
+#else
+    pthread_mutex_unlock(&rg_mem_watcher_mutex);
+#endif
+}
+
+/**
+ * Gives the calling thread access to the maps of the watcher, until rg_mem_watcher_unlock is called.
+ * @return false if there is no watcher, or if the thread is already inside a watcher function.
+ */
+static bool rg_mem_watcher_lock(void)
+{
+    if (rg_mem_watcher_busy)
+    {
+        return false;
+    }
+
+    rg_mem_watcher_lock_mutex();
+    if (RG_MEMORY_WATCHER == NULL)
+    {
+        rg_mem_watcher_unlock_mutex();
+        return false;
+    }
+    rg_mem_watcher_busy = true;
+    return true;
+}
+
+static void rg_mem_watcher_unlock(void)
+{
+    rg_mem_watcher_busy = false;
+    rg_mem_watcher_unlock_mutex();
+}
+
 bool rg_mem_watcher_init(void)
 {
     // Do nothing if a watcher is already set up
@@ -75,11 +261,10 @@ bool rg_mem_watcher_init(void)
         return false;
     }
 
-    // Initialize the locked flag
-    watcher->locked = false;
-
     // Set the watcher
+    rg_mem_watcher_lock_mutex();
     RG_MEMORY_WATCHER = watcher;
+    rg_mem_watcher_unlock_mutex();
     return true;
 }
 
@@ -91,8 +276,10 @@ void rg_mem_watcher_cleanup(void)
     }
 
     // Take the watcher and prevent it from being used again
+    rg_mem_watcher_lock_mutex();
     rg_mem_watcher *watcher = RG_MEMORY_WATCHER;
-    RG_MEMORY_WATCHER = NULL;
+    RG_MEMORY_WATCHER       = NULL;
+    rg_mem_watcher_unlock_mutex();
 
     // Cleanup the allocations map
     rg_destroy_struct_map(&watcher->allocations);
@@ -106,7 +293,7 @@ void rg_mem_watcher_cleanup(void)
 
 bool rg_mem_watcher_print_leaks(void)
 {
-    if (RG_MEMORY_WATCHER == NULL)
+    if (!rg_mem_watcher_lock())
     {
         return true;
     }
@@ -118,6 +305,7 @@ bool rg_mem_watcher_print_leaks(void)
     // If everything is clean, do not do anything
     if (allocations_count == 0 && prevented_segfaults_count == 0)
     {
+        rg_mem_watcher_unlock();
         return true;
     }
 
@@ -161,6 +349,7 @@ bool rg_mem_watcher_print_leaks(void)
 
     printf("\n");
 
+    rg_mem_watcher_unlock();
     return false;
 }
 
@@ -177,7 +366,7 @@ void *rg_mem_watcher_malloc(size_t size, const char *file, size_t line)
     void *ptr = malloc(size);
 
     // If the allocation succeeded, add it to the allocations map
-    if (ptr != NULL && RG_MEMORY_WATCHER != NULL && !RG_MEMORY_WATCHER->locked)
+    if (ptr != NULL && rg_mem_watcher_lock())
     {
         // Allocate memory for the allocation
         rg_mem_watcher_allocation allocation = {
@@ -187,14 +376,11 @@ void *rg_mem_watcher_malloc(size_t size, const char *file, size_t line)
             .size                = size,
         };
 
-        // Lock watcher to avoid recursion
-        RG_MEMORY_WATCHER->locked = true;
-
         // Add the allocation to the map
         rg_struct_map_set(RG_MEMORY_WATCHER->allocations, (rg_hash_map_key_t) ptr, &allocation);
 
         // Unlock watcher
-        RG_MEMORY_WATCHER->locked = false;
+        rg_mem_watcher_unlock();
     }
 
     return ptr;
@@ -211,7 +397,7 @@ void *rg_mem_watcher_calloc(size_t count, size_t size, const char *file, size_t
     void *ptr = calloc(count, size);
 
     // If the allocation succeeded, add it to the allocations map
-    if (ptr != NULL && RG_MEMORY_WATCHER != NULL && !RG_MEMORY_WATCHER->locked)
+    if (ptr != NULL && rg_mem_watcher_lock())
     {
         // Allocate memory for the allocation
         rg_mem_watcher_allocation allocation = {
@@ -221,14 +407,11 @@ void *rg_mem_watcher_calloc(size_t count, size_t size, const char *file, size_t
             .size                = count * size,
         };
 
-        // Lock watcher to avoid recursion
-        RG_MEMORY_WATCHER->locked = true;
-
         // Add the allocation to the map
         rg_struct_map_set(RG_MEMORY_WATCHER->allocations, (rg_hash_map_key_t) ptr, &allocation);
 
         // Unlock watcher
-        RG_MEMORY_WATCHER->locked = false;
+        rg_mem_watcher_unlock();
     }
 
     return ptr;
@@ -253,15 +436,14 @@ void *rg_mem_watcher_realloc(void *ptr, size_t size, const char *file, size_t li
         return NULL;
     }
 
-    // Reallocate the memory
+    // Keep the watcher locked during the reallocation
+    // Once the old block is freed, another thread could get its address, and its allocation would be removed instead
+    bool  watched = rg_mem_watcher_lock();
     void *new_ptr = realloc(ptr, size);
 
     // If the reallocation succeeded, update the allocations map
-    if (new_ptr != NULL && RG_MEMORY_WATCHER != NULL && !RG_MEMORY_WATCHER->locked)
+    if (new_ptr != NULL && watched)
     {
-        // Lock watcher to avoid recursion
-        RG_MEMORY_WATCHER->locked = true;
-
         // Remove the old allocation
         rg_struct_map_erase(RG_MEMORY_WATCHER->allocations, (rg_hash_map_key_t) ptr);
 
@@ -273,9 +455,12 @@ void *rg_mem_watcher_realloc(void *ptr, size_t size, const char *file, size_t li
             .size                = size,
         };
         rg_struct_map_set(RG_MEMORY_WATCHER->allocations, (rg_hash_map_key_t) new_ptr, &allocation);
+    }
 
-        // Unlock watcher
-        RG_MEMORY_WATCHER->locked = false;
+    // Unlock watcher
+    if (watched)
+    {
+        rg_mem_watcher_unlock();
     }
 
     return new_ptr;
@@ -290,40 +475,104 @@ void rg_mem_watcher_free(void *ptr, const char *file, size_t line)
     // If the pointer is NULL, save segfault
     if (ptr == NULL)
     {
-        if (RG_MEMORY_WATCHER != NULL && !RG_MEMORY_WATCHER->locked)
+        if (rg_mem_watcher_lock())
         {
             rg_mem_watcher_segfault segfault = {
                 .freed_from_file = file,
                 .freed_from_line = line,
             };
 
-            // Lock watcher to avoid recursion
-            RG_MEMORY_WATCHER->locked = true;
-
             // Add the segfault to the map
             rg_storage_push(RG_MEMORY_WATCHER->prevented_segfaults, &segfault);
 
             // Unlock watcher
-            RG_MEMORY_WATCHER->locked = false;
+            rg_mem_watcher_unlock();
         }
 
         return;
     }
 
-    if (RG_MEMORY_WATCHER != NULL && !RG_MEMORY_WATCHER->locked)
+    if (rg_mem_watcher_lock())
     {
-        // Lock watcher to avoid recursion
-        RG_MEMORY_WATCHER->locked = true;
-
         // Remove the allocation from the map
         rg_struct_map_erase(RG_MEMORY_WATCHER->allocations, (rg_hash_map_key_t) ptr);
 
         // Unlock watcher
-        RG_MEMORY_WATCHER->locked = false;
+        rg_mem_watcher_unlock();
     }
 
     // Free the memory
     free(ptr);
 }
 
+/** Adds an allocation to the map of the watcher. The watcher must be locked. */
+static void rg_mem_watcher_track(void *ptr, size_t size, const char *file, size_t line)
+{
+    rg_mem_watcher_allocation allocation = {
+        .allocated_from_file = file,
+        .allocated_from_line = line,
+        .base                = ptr,
+        .size                = size,
+    };
+    rg_struct_map_set(RG_MEMORY_WATCHER->allocations, (rg_hash_map_key_t) ptr, &allocation);
+}
+
+/**
+ * @brief Allocates memory whose address is a multiple of the given alignment.
+ * The aligned address is tracked, since it is the one that will be given to rg_aligned_free.
+ */
+void *rg_mem_watcher_aligned_malloc(size_t size, size_t alignment, const char *file, size_t line)
+{
+    void *ptr = rg_aligned_block_malloc(size, alignment);
+    if (ptr != NULL && rg_mem_watcher_lock())
+    {
+        rg_mem_watcher_track(ptr, size, file, line);
+        rg_mem_watcher_unlock();
+    }
+    return ptr;
+}
+
+/**
+ * @brief Reallocates memory allocated by rg_aligned_malloc, and keeps the alignment.
+ */
+void *rg_mem_watcher_aligned_realloc(void *ptr, size_t size, size_t alignment, const char *file, size_t line)
+{
+    // Like rg_mem_watcher_realloc, the watcher stays locked until the old address is removed
+    bool  watched = rg_mem_watcher_lock();
+    void *new_ptr = rg_aligned_block_realloc(ptr, size, alignment);
+    if (watched)
+    {
+        if (new_ptr != NULL)
+        {
+            if (ptr != NULL)
+            {
+                rg_struct_map_erase(RG_MEMORY_WATCHER->allocations, (rg_hash_map_key_t) ptr);
+            }
+            rg_mem_watcher_track(new_ptr, size, file, line);
+        }
+        rg_mem_watcher_unlock();
+    }
+    return new_ptr;
+}
+
+/**
+ * @brief Frees memory allocated by rg_aligned_malloc or rg_aligned_realloc.
+ */
+void rg_mem_watcher_aligned_free(void *ptr, const char *file, size_t line)
+{
+    // A NULL pointer is reported like with rg_free
+    if (ptr == NULL)
+    {
+        rg_mem_watcher_free(NULL, file, line);
+        return;
+    }
+
+    if (rg_mem_watcher_lock())
+    {
+        rg_struct_map_erase(RG_MEMORY_WATCHER->allocations, (rg_hash_map_key_t) ptr);
+        rg_mem_watcher_unlock();
+    }
+    rg_aligned_block_free(ptr);
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,485 @@
+#include "railguard/utils/sort.h"
+
+#include <railguard/utils/memory.h>
+
+#include <string.h>
+
+// --=== Constants ===--
+
+// The radix sorts use 8-bit digits, so that the histograms of all the digits fit in the L1 cache
+#define RG_SORT_RADIX_BITS    8
+#define RG_SORT_RADIX_BUCKETS (1u << RG_SORT_RADIX_BITS)
+#define RG_SORT_RADIX_MASK    (RG_SORT_RADIX_BUCKETS - 1)
+#define RG_SORT_MAX_DIGITS    (64 / RG_SORT_RADIX_BITS)
+
+// Below this count, the introsort uses an insertion sort, which is faster on a few elements
+#define RG_SORT_INSERTION_THRESHOLD 16
+
+// --=== Type Definitions ===--
+
+/**
+ * Counts the digits of the keys in [begin, end), for digit_count digits starting at the one at first_shift.
+ * The histograms are laid out one after the other, and are incremented, not reset.
+ */
+typedef void (*rg_sort_count_function)(const void *keys,
+                                       size_t      begin,
+                                       size_t      end,
+                                       uint32_t    first_shift,
+                                       uint32_t    digit_count,
+                                       size_t     *histograms);
+/** Moves the keys in [begin, end) of src to dst, at the offsets of their digit. The offsets are incremented for each key. */
+typedef void (*rg_sort_scatter_function)(const void *src, void *dst, size_t begin, size_t end, uint32_t shift, size_t *offsets);
+
+/** Functions of a type of key, so that the radix sort is written once for all of them. */
+typedef struct rg_sort_radix_type
+{
+    size_t                   element_size;
+    uint32_t                 digit_count;
+    rg_sort_count_function   pfn_count;
+    rg_sort_scatter_function pfn_scatter;
+} rg_sort_radix_type;
+
+/** State shared by the tasks of a pass of a parallel radix sort. Each task handles a contiguous chunk of the keys. */
+typedef struct rg_sort_parallel_pass
+{
+    const rg_sort_radix_type *type;
+    const void               *src;
+    void                     *dst;
+    size_t                    count;
+    size_t                    task_count;
+    uint32_t                  shift;
+    // One histogram per task, each one on its own cache lines
+    size_t *histograms;
+} rg_sort_parallel_pass;
+
+// --=== Key types ===--
+
+static void rg_sort_count32(const void *keys, size_t begin, size_t end, uint32_t first_shift, uint32_t digit_count, size_t *histograms)
+{
+    const rg_sort_key32 *elements = keys;
+    for (size_t i = begin; i < end; i++)
+    {
+        uint32_t key = elements[i].key >> first_shift;
+        for (uint32_t d = 0; d < digit_count; d++)
+        {
+            histograms[d * RG_SORT_RADIX_BUCKETS + ((key >> (d * RG_SORT_RADIX_BITS)) & RG_SORT_RADIX_MASK)]++;
+        }
+    }
+}
+
+static void rg_sort_scatter32(const void *src, void *dst, size_t begin, size_t end, uint32_t shift, size_t *offsets)
+{
+    const rg_sort_key32 *from = src;
+    rg_sort_key32       *to   = dst;
+    for (size_t i = begin; i < end; i++)
+    {
+        to[offsets[(from[i].key >> shift) & RG_SORT_RADIX_MASK]++] = from[i];
+    }
+}
+
+static void rg_sort_count64(const void *keys, size_t begin, size_t end, uint32_t first_shift, uint32_t digit_count, size_t *histograms)
+{
+    const rg_sort_key64 *elements = keys;
+    for (size_t i = begin; i < end; i++)
+    {
+        uint64_t key = elements[i].key >> first_shift;
+        for (uint32_t d = 0; d < digit_count; d++)
+        {
+            histograms[d * RG_SORT_RADIX_BUCKETS + ((key >> (d * RG_SORT_RADIX_BITS)) & RG_SORT_RADIX_MASK)]++;
+        }
+    }
+}
+
+static void rg_sort_scatter64(const void *src, void *dst, size_t begin, size_t end, uint32_t shift, size_t *offsets)
+{
+    const rg_sort_key64 *from = src;
+    rg_sort_key64       *to   = dst;
+    for (size_t i = begin; i < end; i++)
+    {
+        to[offsets[(from[i].key >> shift) & RG_SORT_RADIX_MASK]++] = from[i];
+    }
+}
+
+static const rg_sort_radix_type RG_SORT_KEY32_TYPE = {
+    .element_size = sizeof(rg_sort_key32),
+    .digit_count  = 32 / RG_SORT_RADIX_BITS,
+    .pfn_count    = rg_sort_count32,
+    .pfn_scatter  = rg_sort_scatter32,
+};
+
+static const rg_sort_radix_type RG_SORT_KEY64_TYPE = {
+    .element_size = sizeof(rg_sort_key64),
+    .digit_count  = 64 / RG_SORT_RADIX_BITS,
+    .pfn_count    = rg_sort_count64,
+    .pfn_scatter  = rg_sort_scatter64,
+};
+
+// --=== Radix sorts ===--
+
+/** Returns true if all the keys have the same digit, in which case the pass wouldn't move anything. */
+static bool rg_sort_is_single_bucket(const size_t *histogram, size_t count)
+{
+    for (uint32_t b = 0; b < RG_SORT_RADIX_BUCKETS; b++)
+    {
+        if (histogram[b] != 0)
+        {
+            return histogram[b] == count;
+        }
+    }
+    return true;
+}
+
+static bool rg_sort_radix(rg_vector *keys, const rg_sort_radix_type *type)
+{
+    if (keys == NULL || keys->element_size != type->element_size)
+    {
+        return false;
+    }
+    size_t count = keys->count;
+    if (count < 2)
+    {
+        return true;
+    }
+
+    void *buffer = rg_allocator_alloc(keys->allocator, count * type->element_size);
+    if (buffer == NULL)
+    {
+        return false;
+    }
+
+    // Count all the digits in a single read of the keys
+    size_t histograms[RG_SORT_MAX_DIGITS * RG_SORT_RADIX_BUCKETS] = {0};
+    type->pfn_count(keys->data, 0, count, 0, type->digit_count, histograms);
+
+    // Move the keys back and forth between the vector and the buffer, one digit at a time starting with the lowest
+    void *src = keys->data;
+    void *dst = buffer;
+    for (uint32_t d = 0; d < type->digit_count; d++)
+    {
+        size_t *histogram = histograms + d * RG_SORT_RADIX_BUCKETS;
+        if (rg_sort_is_single_bucket(histogram, count))
+        {
+            continue;
+        }
+
+        // Turn the histogram into the offset of each bucket
+        size_t offset = 0;
+        for (uint32_t b = 0; b < RG_SORT_RADIX_BUCKETS; b++)
+        {
+            size_t bucket_count = histogram[b];
+            histogram[b]        = offset;
+            offset += bucket_count;
+        }
+        type->pfn_scatter(src, dst, 0, count, d * RG_SORT_RADIX_BITS, histogram);
+
+        void *tmp = src;
+        src       = dst;
+        dst       = tmp;
+    }
+
+    // After an odd number of passes, the sorted keys are in the buffer
+    if (src != keys->data)
+    {
+        memcpy(keys->data, src, count * type->element_size);
+    }
+    rg_allocator_free(keys->allocator, buffer);
+    return true;
+}
+
+static inline size_t rg_sort_chunk_begin(const rg_sort_parallel_pass *pass, size_t task_index)
+{
+    return pass->count * task_index / pass->task_count;
+}
+
+static void rg_sort_count_task(size_t task_index, void *user_data)
+{
+    rg_sort_parallel_pass *pass      = user_data;
+    size_t                *histogram = pass->histograms + task_index * RG_SORT_RADIX_BUCKETS;
+    memset(histogram, 0, RG_SORT_RADIX_BUCKETS * sizeof(size_t));
+    pass->type->pfn_count(pass->src,
+                          rg_sort_chunk_begin(pass, task_index),
+                          rg_sort_chunk_begin(pass, task_index + 1),
+                          pass->shift,
+                          1,
+                          histogram);
+}
+
+static void rg_sort_scatter_task(size_t task_index, void *user_data)
+{
+    rg_sort_parallel_pass *pass = user_data;
+    pass->type->pfn_scatter(pass->src,
+                            pass->dst,
+                            rg_sort_chunk_begin(pass, task_index),
+                            rg_sort_chunk_begin(pass, task_index + 1),
+                            pass->shift,
+                            pass->histograms + task_index * RG_SORT_RADIX_BUCKETS);
+}
+
+static bool rg_sort_radix_parallel(rg_vector *keys, const rg_sort_radix_type *type, rg_thread_pool *pool)
+{
+    size_t task_count = pool != NULL ? rg_thread_pool_thread_count(pool) : 1;
+    if (keys == NULL || keys->count < RG_SORT_PARALLEL_MIN_COUNT || task_count < 2)
+    {
+        return rg_sort_radix(keys, type);
+    }
+    if (keys->element_size != type->element_size)
+    {
+        return false;
+    }
+
+    size_t count  = keys->count;
+    void  *buffer = rg_allocator_alloc(keys->allocator, count * type->element_size);
+    if (buffer == NULL)
+    {
+        return false;
+    }
+    // 256 counters of 8 bytes are a multiple of the cache line, so aligning the first histogram aligns all of them
+    size_t *histograms = rg_aligned_malloc(task_count * RG_SORT_RADIX_BUCKETS * sizeof(size_t), RG_CACHE_LINE_SIZE);
+    if (histograms == NULL)
+    {
+        rg_allocator_free(keys->allocator, buffer);
+        return false;
+    }
+
+    rg_sort_parallel_pass pass = {
+        .type       = type,
+        .src        = keys->data,
+        .dst        = buffer,
+        .count      = count,
+        .task_count = task_count,
+        .histograms = histograms,
+    };
+    for (uint32_t d = 0; d < type->digit_count; d++)
+    {
+        // Each task counts the digits of its chunk
+        pass.shift = d * RG_SORT_RADIX_BITS;
+        rg_thread_pool_run(pool, task_count, rg_sort_count_task, &pass);
+
+        // Skip the digit if all the keys have the same one
+        size_t first_bucket_count = 0;
+        bool   single_bucket      = false;
+        for (uint32_t b = 0; b < RG_SORT_RADIX_BUCKETS && first_bucket_count == 0; b++)
+        {
+            for (size_t t = 0; t < task_count; t++)
+            {
+                first_bucket_count += histograms[t * RG_SORT_RADIX_BUCKETS + b];
+            }
+            single_bucket = first_bucket_count == count;
+        }
+        if (single_bucket)
+        {
+            continue;
+        }
+
+        // In each bucket, the keys of a chunk go after the ones of the previous chunks, which keeps the sort stable
+        size_t offset = 0;
+        for (uint32_t b = 0; b < RG_SORT_RADIX_BUCKETS; b++)
+        {
+            for (size_t t = 0; t < task_count; t++)
+            {
+                size_t *counter      = &histograms[t * RG_SORT_RADIX_BUCKETS + b];
+                size_t  bucket_count = *counter;
+                *counter             = offset;
+                offset += bucket_count;
+            }
+        }
+        rg_thread_pool_run(pool, task_count, rg_sort_scatter_task, &pass);
+
+        void *tmp = (void *) pass.src;
+        pass.src  = pass.dst;
+        pass.dst  = tmp;
+    }
+
+    if (pass.src != keys->data)
+    {
+        memcpy(keys->data, pass.src, count * type->element_size);
+    }
+    rg_aligned_free(histograms);
+    rg_allocator_free(keys->allocator, buffer);
+    return true;
+}
+
+bool rg_sort_keys32(rg_vector *keys)
+{
+    return rg_sort_radix(keys, &RG_SORT_KEY32_TYPE);
+}
+
+bool rg_sort_keys64(rg_vector *keys)
+{
+    return rg_sort_radix(keys, &RG_SORT_KEY64_TYPE);
+}
+
+bool rg_sort_keys32_parallel(rg_vector *keys, rg_thread_pool *pool)
+{
+    return rg_sort_radix_parallel(keys, &RG_SORT_KEY32_TYPE, pool);
+}
+
+bool rg_sort_keys64_parallel(rg_vector *keys, rg_thread_pool *pool)
+{
+    return rg_sort_radix_parallel(keys, &RG_SORT_KEY64_TYPE, pool);
+}
+
+// --=== Comparison sort ===--
+
+static inline void rg_sort_swap(char *a, char *b, size_t element_size)
+{
+    // Swap by blocks, so that elements of any size can be swapped without allocating
+    char block[64];
+    while (element_size > 0)
+    {
+        size_t block_size = element_size < sizeof(block) ? element_size : sizeof(block);
+        memcpy(block, a, block_size);
+        memcpy(a, b, block_size);
+        memcpy(b, block, block_size);
+        a += block_size;
+        b += block_size;
+        element_size -= block_size;
+    }
+}
+
+static void rg_sort_insertion(char *data, size_t count, size_t element_size, rg_sort_compare_function pfn_compare, void *user_data)
+{
+    for (size_t i = 1; i < count; i++)
+    {
+        for (size_t j = i; j > 0; j--)
+        {
+            char *current  = data + j * element_size;
+            char *previous = current - element_size;
+            if (pfn_compare(previous, current, user_data) <= 0)
+            {
+                break;
+            }
+            rg_sort_swap(previous, current, element_size);
+        }
+    }
+}
+
+static void rg_sort_sift_down(char                    *data,
+                              size_t                   root,
+                              size_t                   count,
+                              size_t                   element_size,
+                              rg_sort_compare_function pfn_compare,
+                              void                    *user_data)
+{
+    size_t child;
+    while ((child = 2 * root + 1) < count)
+    {
+        // Take the biggest child
+        if (child + 1 < count && pfn_compare(data + child * element_size, data + (child + 1) * element_size, user_data) < 0)
+        {
+            child++;
+        }
+        if (pfn_compare(data + root * element_size, data + child * element_size, user_data) >= 0)
+        {
+            return;
+        }
+        rg_sort_swap(data + root * element_size, data + child * element_size, element_size);
+        root = child;
+    }
+}
+
+static void rg_sort_heap(char *data, size_t count, size_t element_size, rg_sort_compare_function pfn_compare, void *user_data)
+{
+    for (size_t start = count / 2; start-- > 0;)
+    {
+        rg_sort_sift_down(data, start, count, element_size, pfn_compare, user_data);
+    }
+    for (size_t end = count - 1; end > 0; end--)
+    {
+        rg_sort_swap(data, data + end * element_size, element_size);
+        rg_sort_sift_down(data, 0, end, element_size, pfn_compare, user_data);
+    }
+}
+
+static void rg_sort_intro(char                    *data,
+                          size_t                   count,
+                          size_t                   element_size,
+                          rg_sort_compare_function pfn_compare,
+                          void                    *user_data,
+                          size_t                   depth_limit)
+{
+    while (count > RG_SORT_INSERTION_THRESHOLD)
+    {
+        // The partitions are too unbalanced, fall back to a heapsort to stay in O(n log n)
+        if (depth_limit == 0)
+        {
+            rg_sort_heap(data, count, element_size, pfn_compare, user_data);
+            return;
+        }
+        depth_limit--;
+
+        // Order the first, middle and last elements, then use the median as the pivot, at the start of the range
+        // The last element is then at least the pivot, which stops the left scan of the partition
+        char *first  = data;
+        char *middle = data + (count / 2) * element_size;
+        char *last   = data + (count - 1) * element_size;
+        if (pfn_compare(middle, first, user_data) < 0)
+        {
+            rg_sort_swap(middle, first, element_size);
+        }
+        if (pfn_compare(last, middle, user_data) < 0)
+        {
+            rg_sort_swap(last, middle, element_size);
+            if (pfn_compare(middle, first, user_data) < 0)
+            {
+                rg_sort_swap(middle, first, element_size);
+            }
+        }
+        rg_sort_swap(first, middle, element_size);
+
+        // Partition around the pivot. Both scans stop on the elements equal to it, so that duplicates are split evenly
+        size_t i = 0;
+        size_t j = count;
+        while (true)
+        {
+            do
+            {
+                i++;
+            } while (i < count && pfn_compare(data + i * element_size, first, user_data) < 0);
+            do
+            {
+                j--;
+            } while (pfn_compare(data + j * element_size, first, user_data) > 0);
+            if (i >= j)
+            {
+                break;
+            }
+            rg_sort_swap(data + i * element_size, data + j * element_size, element_size);
+        }
+        rg_sort_swap(first, data + j * element_size, element_size);
+
+        // Recurse on the smaller side and loop on the bigger one, so that the stack stays in O(log n)
+        size_t left_count  = j;
+        size_t right_count = count - j - 1;
+        char  *right       = data + (j + 1) * element_size;
+        if (left_count < right_count)
+        {
+            rg_sort_intro(data, left_count, element_size, pfn_compare, user_data, depth_limit);
+            data  = right;
+            count = right_count;
+        }
+        else
+        {
+            rg_sort_intro(right, right_count, element_size, pfn_compare, user_data, depth_limit);
+            count = left_count;
+        }
+    }
+
+    rg_sort_insertion(data, count, element_size, pfn_compare, user_data);
+}
+
+void rg_sort(void *data, size_t count, size_t element_size, rg_sort_compare_function pfn_compare, void *user_data)
+{
+    if (data == NULL || count < 2 || element_size == 0 || pfn_compare == NULL)
+    {
+        return;
+    }
+
+    // Allow 2 * log2(count) levels of partitions before switching to the heapsort
+    size_t depth_limit = 0;
+    for (size_t n = count; n > 1; n >>= 1)
+    {
+        depth_limit += 2;
+    }
+    rg_sort_intro(data, count, element_size, pfn_compare, user_data, depth_limit);
+}
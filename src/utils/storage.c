@@ -1,41 +1,557 @@
 #include "railguard/utils/storage.h"
 
+#include <railguard/utils/arrays.h>
 #include <railguard/utils/memory.h>
 
+#include <string.h>
+
 // region Storage
 
+// --=== Constants ===--
+
+// Number of ids converted at once by rg_storage_get_many
+#define RG_STORAGE_BATCH_SIZE 64
+
+// Number of places in each chunk of rg_storage_parallel_for when no grain is given
+#define RG_STORAGE_DEFAULT_GRAIN 4096
+
+// Id pools
+#define RG_STORAGE_MAX_GENERATION_BITS 16
+
 // --=== Type Definitions ===--
 
+/** Generates the ids of the hashed storages. */
+typedef struct rg_storage_id_pool
+{
+    // Index of the next new id. It is 64-bit so that the exhaustion of the index range can be detected.
+    uint64_t next_index;
+    uint32_t index_bits;
+    bool     recycle_ids;
+    // Set when the index range was exhausted and the counter started again from the beginning.
+    // From then on, the generated ids may still be used, and must be checked by the caller.
+    bool wrapped;
+    // Ids of the erased elements, with the generation of their next use. Only used if the ids are recycled.
+    rg_vector free_ids;
+} rg_storage_id_pool;
+
 typedef struct rg_storage
 {
+    rg_storage_mode     mode;
+    rg_thread_pool     *thread_pool;
+    const rg_allocator *allocator;
+    // Ids queued by rg_storage_erase_deferred, widened to keys so that they can be given directly to the struct map
+    rg_vector pending_erases;
+
+    // Hashed mode
     // Used to generate unique IDs for each storage entry.
-    rg_storage_id  id_counter;
-    rg_struct_map *map;
+    rg_storage_id_pool id_pool;
+    rg_struct_map     *map;
+
+    // Slot map mode
+    // The elements are packed in the values vector, and ids[i] is the id of values[i], so that the slot of the last element can be
+    // updated when it is moved by an erasure. The value of each used slot is the position of its id in the dense arrays.
+    size_t        element_size;
+    rg_vector     values;
+    rg_vector     ids;
+    rg_slot_table slots;
+
+    // With stable addresses, the elements are stored in the paged pool instead of the values vector, and are never moved.
+    // The slots then give the indices of the elements in the pool, and the ids vector is indexed by them too.
+    bool          stable_addresses;
+    rg_paged_pool pool;
+
+    // Change tracking
+    // The journal is sorted by epoch, since the epoch only increases. The changes of the current epoch start at epoch_start.
+    bool      track_changes;
+    uint64_t  epoch;
+    rg_vector journal;
+    size_t    epoch_start;
+    // Epoch of the last change that couldn't be recorded, or 0 if they were all recorded
+    uint64_t lost_epoch;
+    // Ids that are already in the journal for the current epoch, so that they are not recorded again when modified.
+    // In slot map mode, it is a bitset indexed by the slots. In hashed mode, the ids can be sparse, so a hash map is used instead.
+    rg_vector    dirty_bits;
+    rg_hash_map *dirty_ids;
 } rg_storage;
 
+// --=== Id pools ===--
+
+bool rg_storage_id_pool_init(rg_storage_id_pool *pool, bool recycle_ids, uint32_t generation_bits, const rg_allocator *allocator)
+{
+    if (generation_bits > RG_STORAGE_MAX_GENERATION_BITS)
+    {
+        return false;
+    }
+
+    // Start at one, since zero is reserved for RG_STORAGE_NULL_ID.
+    pool->next_index  = 1;
+    pool->index_bits  = 32 - generation_bits;
+    pool->recycle_ids = recycle_ids;
+    pool->wrapped     = false;
+    pool->free_ids    = (rg_vector) {0};
+    return !recycle_ids || rg_create_vector_with_allocator(2, sizeof(rg_storage_id), allocator, &pool->free_ids);
+}
+
+void rg_storage_id_pool_cleanup(rg_storage_id_pool *pool)
+{
+    if (pool->recycle_ids)
+    {
+        rg_destroy_vector(&pool->free_ids);
+    }
+}
+
+/**
+ * Returns a new id, or RG_STORAGE_NULL_ID if there is none left.
+ * If the pool has wrapped, the id may still be used by an element: the caller must check it, and acquire another one if needed.
+ */
+rg_storage_id rg_storage_id_pool_acquire(rg_storage_id_pool *pool)
+{
+    if (pool->recycle_ids && pool->free_ids.count > 0)
+    {
+        rg_storage_id id = ((rg_storage_id *) pool->free_ids.data)[rg_vector_last_index(&pool->free_ids)];
+        rg_vector_pop_back(&pool->free_ids);
+        return id;
+    }
+
+    if (pool->next_index >= (1ULL << pool->index_bits))
+    {
+        // When the ids are recycled, every id is really used
+        if (pool->recycle_ids)
+        {
+            return RG_STORAGE_NULL_ID;
+        }
+
+        // Otherwise, the first ids were probably erased a long time ago: start again instead of overflowing
+        pool->next_index = 1;
+        pool->wrapped    = true;
+    }
+    return (rg_storage_id) pool->next_index++;
+}
+
+/** Gives back the id of an erased element, so that it can be recycled. */
+void rg_storage_id_pool_release(rg_storage_id_pool *pool, rg_storage_id id)
+{
+    if (!pool->recycle_ids)
+    {
+        return;
+    }
+
+    // Increment the generation so that the old id doesn't match the next element
+    // The index is never 0, so the new id can't be the null id even if the generation wraps
+    uint64_t index_mask = (1ULL << pool->index_bits) - 1;
+    uint64_t generation = ((uint64_t) id >> pool->index_bits) + 1;
+    rg_storage_id new_id = (rg_storage_id) (((generation << pool->index_bits) | (id & index_mask)) & UINT32_MAX);
+
+    // If the allocation fails, the id is just never recycled
+    rg_storage_id *p_free_id = rg_vector_push_back_no_data(&pool->free_ids);
+    if (p_free_id != NULL)
+    {
+        *p_free_id = new_id;
+    }
+}
+
+// --=== Change tracking ===--
+
+bool rg_storage_changes_init(rg_storage *storage)
+{
+    storage->epoch       = 1;
+    storage->epoch_start = 0;
+    storage->lost_epoch  = 0;
+    if (!rg_create_vector_with_allocator(16, sizeof(rg_storage_change), storage->allocator, &storage->journal))
+    {
+        return false;
+    }
+
+    rg_hash_map_create_info dirty_ids_info = {
+        .allocator = storage->allocator,
+    };
+    bool dirty_success = storage->mode == RG_STORAGE_MODE_SLOT_MAP
+                           ? rg_create_vector_with_allocator(2, sizeof(uint64_t), storage->allocator, &storage->dirty_bits)
+                           : (storage->dirty_ids = rg_create_hash_map_with_info(&dirty_ids_info)) != NULL;
+    if (!dirty_success)
+    {
+        rg_destroy_vector(&storage->journal);
+        return false;
+    }
+    return true;
+}
+
+void rg_storage_changes_cleanup(rg_storage *storage)
+{
+    rg_destroy_vector(&storage->journal);
+    if (storage->mode == RG_STORAGE_MODE_SLOT_MAP)
+    {
+        rg_destroy_vector(&storage->dirty_bits);
+    }
+    else
+    {
+        rg_destroy_hash_map(&storage->dirty_ids);
+    }
+}
+
+/** Marks the id as recorded in the current epoch. Returns true if it already was. */
+static bool rg_storage_set_dirty(rg_storage *storage, rg_storage_id id)
+{
+    if (storage->mode != RG_STORAGE_MODE_SLOT_MAP)
+    {
+        if (rg_hash_map_get(storage->dirty_ids, id).exists)
+        {
+            return true;
+        }
+        // If the allocation fails, the id will just be recorded again
+        rg_hash_map_set(storage->dirty_ids, id, (rg_hash_map_value_t) {.as_num = 0});
+        return false;
+    }
+
+    // The bits of a slot are shared by the successive ids that use it, which are all recorded when created or erased
+    uint32_t slot_index = rg_slot_table_index(id);
+    size_t   word_index = slot_index >> 6;
+    while (storage->dirty_bits.count <= word_index)
+    {
+        uint64_t *new_word = rg_vector_push_back_no_data(&storage->dirty_bits);
+        if (new_word == NULL)
+        {
+            return false;
+        }
+        *new_word = 0;
+    }
+
+    uint64_t *word      = (uint64_t *) storage->dirty_bits.data + word_index;
+    uint64_t  bit       = 1ULL << (slot_index & 63);
+    bool      was_dirty = (*word & bit) != 0;
+    *word |= bit;
+    return was_dirty;
+}
+
+static void rg_storage_clear_dirty(rg_storage *storage, rg_storage_id id)
+{
+    if (storage->mode != RG_STORAGE_MODE_SLOT_MAP)
+    {
+        rg_hash_map_erase(storage->dirty_ids, id);
+        return;
+    }
+
+    uint32_t slot_index = rg_slot_table_index(id);
+    size_t   word_index = slot_index >> 6;
+    if (word_index < storage->dirty_bits.count)
+    {
+        ((uint64_t *) storage->dirty_bits.data)[word_index] &= ~(1ULL << (slot_index & 63));
+    }
+}
+
+/** Adds a change to the journal. It must only be called when the changes are tracked. */
+static void rg_storage_record_change(rg_storage *storage, rg_storage_id id, rg_storage_change_type type)
+{
+    // Creations and erasures are always recorded, but an element is only recorded as modified once per epoch
+    bool was_dirty = rg_storage_set_dirty(storage, id);
+    if (type == RG_STORAGE_CHANGE_MODIFIED && was_dirty)
+    {
+        return;
+    }
+
+    rg_storage_change *change = rg_vector_push_back_no_data(&storage->journal);
+    if (change == NULL)
+    {
+        storage->lost_epoch = storage->epoch;
+        return;
+    }
+    change->id    = id;
+    change->type  = type;
+    change->epoch = storage->epoch;
+}
+
+// --=== Slot map ===--
+
+/** Returns the index of the element in the dense arrays, or UINT32_MAX if the id doesn't exist (anymore). */
+static inline uint32_t rg_storage_slot_map_find(const rg_storage *storage, rg_storage_id id)
+{
+    return rg_slot_table_find(&storage->slots, id);
+}
+
+static inline void *rg_storage_slot_map_get(rg_storage *storage, rg_storage_id id)
+{
+    uint32_t index = rg_storage_slot_map_find(storage, id);
+    if (index == UINT32_MAX)
+    {
+        return NULL;
+    }
+    if (storage->stable_addresses)
+    {
+        return rg_paged_pool_get(&storage->pool, index);
+    }
+    return (char *) storage->values.data + (size_t) index * storage->element_size;
+}
+
+static void rg_storage_slot_map_destroy_values(rg_storage *storage)
+{
+    if (storage->stable_addresses)
+    {
+        rg_destroy_paged_pool(&storage->pool);
+    }
+    else
+    {
+        rg_destroy_vector(&storage->values);
+    }
+}
+
+bool rg_storage_slot_map_init(rg_storage *storage)
+{
+    const rg_allocator *allocator      = storage->allocator;
+    bool                values_success = storage->stable_addresses
+                                           ? rg_create_paged_pool_with_allocator(storage->element_size, 0, allocator, &storage->pool)
+                                           : rg_create_vector_with_allocator(2, storage->element_size, allocator, &storage->values);
+    if (!values_success)
+    {
+        return false;
+    }
+    if (!rg_create_vector_with_allocator(2, sizeof(rg_storage_id), allocator, &storage->ids))
+    {
+        rg_storage_slot_map_destroy_values(storage);
+        return false;
+    }
+    if (!rg_create_slot_table(allocator, &storage->slots))
+    {
+        rg_destroy_vector(&storage->ids);
+        rg_storage_slot_map_destroy_values(storage);
+        return false;
+    }
+    return true;
+}
+
+/** Stores a new element in the pool. Returns its index in the pool, or UINT32_MAX if an allocation failed. */
+static uint32_t rg_storage_slot_map_add_stable(rg_storage *storage, void *data, rg_storage_id id)
+{
+    size_t index;
+    void  *value = rg_paged_pool_acquire(&storage->pool, &index);
+    if (value == NULL)
+    {
+        return UINT32_MAX;
+    }
+
+    // The ids vector follows the indices of the pool
+    while (storage->ids.count <= index)
+    {
+        if (rg_vector_push_back_no_data(&storage->ids) == NULL)
+        {
+            rg_paged_pool_release(&storage->pool, index);
+            return UINT32_MAX;
+        }
+    }
+    memcpy(value, data, storage->element_size);
+    ((rg_storage_id *) storage->ids.data)[index] = id;
+    return (uint32_t) index;
+}
+
+rg_storage_id rg_storage_slot_map_push(rg_storage *storage, void *data)
+{
+    // Get the id of a free slot, but only take the slot when nothing can fail anymore
+    rg_storage_id id = rg_slot_table_prepare(&storage->slots);
+    if (id == RG_SLOT_TABLE_NULL_ID)
+    {
+        return RG_STORAGE_NULL_ID;
+    }
+
+    if (storage->stable_addresses)
+    {
+        uint32_t index = rg_storage_slot_map_add_stable(storage, data, id);
+        if (index == UINT32_MAX)
+        {
+            return RG_STORAGE_NULL_ID;
+        }
+        return rg_slot_table_acquire(&storage->slots, index);
+    }
+
+    // Add the element at the end of the dense arrays
+    void          *value    = rg_vector_push_back_no_data(&storage->values);
+    rg_storage_id *p_id     = value != NULL ? rg_vector_push_back_no_data(&storage->ids) : NULL;
+    if (p_id == NULL)
+    {
+        if (value != NULL)
+        {
+            rg_vector_pop_back(&storage->values);
+        }
+        return RG_STORAGE_NULL_ID;
+    }
+    memcpy(value, data, storage->element_size);
+    *p_id = id;
+    return rg_slot_table_acquire(&storage->slots, (uint32_t) rg_vector_last_index(&storage->values));
+}
+
+/** Returns true if the id existed. */
+bool rg_storage_slot_map_erase(rg_storage *storage, rg_storage_id id)
+{
+    uint32_t index = rg_storage_slot_map_find(storage, id);
+    if (index == UINT32_MAX)
+    {
+        return false;
+    }
+
+    if (storage->stable_addresses)
+    {
+        // The other elements must not move, so just free the place
+        rg_paged_pool_release(&storage->pool, index);
+    }
+    else
+    {
+        // Move the last element in the hole to keep the arrays packed, and update its slot
+        uint32_t last_index = (uint32_t) rg_vector_last_index(&storage->values);
+        if (index < last_index)
+        {
+            rg_vector_copy(&storage->values, last_index, index);
+            rg_vector_copy(&storage->ids, last_index, index);
+
+            rg_storage_id moved_id = ((rg_storage_id *) storage->ids.data)[index];
+            rg_slot_table_set_value(&storage->slots, moved_id, index);
+        }
+        rg_vector_pop_back(&storage->values);
+        rg_vector_pop_back(&storage->ids);
+    }
+
+    rg_slot_table_release(&storage->slots, id);
+    return true;
+}
+
+static void rg_storage_slot_map_move_place(size_t from, size_t to, void *p_storage)
+{
+    rg_storage *storage = p_storage;
+    rg_vector_copy(&storage->values, from, to);
+    rg_vector_copy(&storage->ids, from, to);
+
+    rg_storage_id moved_id = ((rg_storage_id *) storage->ids.data)[to];
+    rg_slot_table_set_value(&storage->slots, moved_id, (uint32_t) to);
+}
+
+/** Erases the given ids by filling the holes with the last elements. The keys array is overwritten. */
+void rg_storage_slot_map_erase_many(rg_storage *storage, rg_hash_map_key_t *keys, size_t count)
+{
+    // Invalidate the ids, and reuse the array to store the places of their elements
+    // The places are not bigger than the keys, so a place never overwrites a key that was not read yet
+    // A duplicate doesn't match the new generation of its slot, so it is skipped
+    size_t *places       = (size_t *) keys;
+    size_t  erased_count = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        rg_storage_id id    = (rg_storage_id) keys[i];
+        uint32_t      index = rg_storage_slot_map_find(storage, id);
+        if (index == UINT32_MAX)
+        {
+            continue;
+        }
+
+        rg_slot_table_release(&storage->slots, id);
+        places[erased_count++] = index;
+
+        if (storage->track_changes)
+        {
+            rg_storage_record_change(storage, id, RG_STORAGE_CHANGE_ERASED);
+        }
+    }
+
+    if (storage->stable_addresses)
+    {
+        for (size_t i = 0; i < erased_count; i++)
+        {
+            rg_paged_pool_release(&storage->pool, places[i]);
+        }
+        return;
+    }
+
+    // Fill the holes in one pass, each remaining element moves at most once
+    size_t new_count      = rg_compact_places(storage->values.count,
+                                              places,
+                                              erased_count,
+                                              rg_storage_slot_map_move_place,
+                                              storage,
+                                              storage->allocator);
+    storage->values.count = new_count;
+    storage->ids.count    = new_count;
+}
+
 // --=== Functions ===--
 
 rg_storage *rg_create_storage(size_t element_size)
+{
+    rg_storage_create_info create_info = {
+        .element_size = element_size,
+    };
+    return rg_create_storage_with_info(&create_info);
+}
+
+rg_storage *rg_create_storage_with_info(const rg_storage_create_info *create_info)
 {
     // Allocate the storage structure.
-    rg_storage *storage = rg_calloc(1, sizeof(rg_storage));
+    const rg_allocator *allocator = create_info->allocator;
+    rg_storage         *storage   = rg_allocator_calloc(allocator, 1, sizeof(rg_storage));
     if (storage == NULL)
     {
         return NULL;
     }
+    storage->mode             = create_info->mode;
+    storage->element_size     = create_info->element_size;
+    storage->stable_addresses = create_info->stable_addresses;
+    storage->thread_pool      = create_info->thread_pool;
+    storage->track_changes    = create_info->track_changes;
+    storage->allocator        = allocator;
+    if (!rg_create_vector_with_allocator(2, sizeof(rg_hash_map_key_t), allocator, &storage->pending_erases))
+    {
+        rg_allocator_free(allocator, storage);
+        return NULL;
+    }
+    if (storage->track_changes && !rg_storage_changes_init(storage))
+    {
+        rg_destroy_vector(&storage->pending_erases);
+        rg_allocator_free(allocator, storage);
+        return NULL;
+    }
+
+    if (storage->mode == RG_STORAGE_MODE_SLOT_MAP)
+    {
+        if (!rg_storage_slot_map_init(storage))
+        {
+            if (storage->track_changes)
+            {
+                rg_storage_changes_cleanup(storage);
+            }
+            rg_destroy_vector(&storage->pending_erases);
+            rg_allocator_free(allocator, storage);
+            return NULL;
+        }
+        return storage;
+    }
+
+    if (!rg_storage_id_pool_init(&storage->id_pool, create_info->recycle_ids, create_info->generation_bits, allocator))
+    {
+        if (storage->track_changes)
+        {
+            rg_storage_changes_cleanup(storage);
+        }
+        rg_destroy_vector(&storage->pending_erases);
+        rg_allocator_free(allocator, storage);
+        return NULL;
+    }
 
     // Initialize the storage's map.
-    storage->map = rg_create_struct_map(element_size);
+    // Storages can grow a lot during a frame (e.g. when a scene is loaded), so resize incrementally to avoid big hitches.
+    // The ids are 32-bit, so a compact map can be used.
+    rg_hash_map_create_info map_info = {
+        .incremental_resize = true,
+        .compact            = true,
+        .allocator          = allocator,
+    };
+    storage->map = create_info->stable_addresses ? rg_create_struct_map_paged(create_info->element_size, 0, &map_info)
+                                                 : rg_create_struct_map_with_info(create_info->element_size, &map_info);
     if (storage->map == NULL)
     {
-        rg_free(storage);
+        rg_storage_id_pool_cleanup(&storage->id_pool);
+        if (storage->track_changes)
+        {
+            rg_storage_changes_cleanup(storage);
+        }
+        rg_destroy_vector(&storage->pending_erases);
+        rg_allocator_free(allocator, storage);
         return NULL;
     }
 
-    // Initialize the storage's ID counter.
-    // Start at one, since zero is reserved for RG_STORAGE_NULL_ID.
-    storage->id_counter = 1;
-
     return storage;
 }
 
@@ -46,11 +562,26 @@ void rg_destroy_storage(rg_storage **storage)
         return;
     }
 
-    // Destroy the storage's map.
-    rg_destroy_struct_map(&(*storage)->map);
+    // Destroy the storage's map or arrays.
+    if ((*storage)->mode == RG_STORAGE_MODE_SLOT_MAP)
+    {
+        rg_storage_slot_map_destroy_values(*storage);
+        rg_destroy_vector(&(*storage)->ids);
+        rg_destroy_slot_table(&(*storage)->slots);
+    }
+    else
+    {
+        rg_destroy_struct_map(&(*storage)->map);
+        rg_storage_id_pool_cleanup(&(*storage)->id_pool);
+    }
+    rg_destroy_vector(&(*storage)->pending_erases);
+    if ((*storage)->track_changes)
+    {
+        rg_storage_changes_cleanup(*storage);
+    }
 
     // Free the storage structure.
-    rg_free(*storage);
+    rg_allocator_free((*storage)->allocator, *storage);
     *storage = NULL;
 }
 
@@ -60,18 +591,40 @@ rg_storage_id rg_storage_push(rg_storage *storage, void *data)
     {
         return RG_STORAGE_NULL_ID;
     }
+    if (storage->mode == RG_STORAGE_MODE_SLOT_MAP)
+    {
+        rg_storage_id id = rg_storage_slot_map_push(storage, data);
+        if (storage->track_changes && id != RG_STORAGE_NULL_ID)
+        {
+            rg_storage_record_change(storage, id, RG_STORAGE_CHANGE_CREATED);
+        }
+        return id;
+    }
 
     // Generate a new ID for the storage entry.
-    rg_storage_id id = storage->id_counter++;
+    // After a wrap, skip the ids that are still used. There can't be as many elements as ids, so a free one will be found.
+    rg_storage_id id = rg_storage_id_pool_acquire(&storage->id_pool);
+    while (storage->id_pool.wrapped && id != RG_STORAGE_NULL_ID && rg_struct_map_exists(storage->map, id))
+    {
+        id = rg_storage_id_pool_acquire(&storage->id_pool);
+    }
+    if (id == RG_STORAGE_NULL_ID)
+    {
+        return RG_STORAGE_NULL_ID;
+    }
 
     // Add the storage entry to the map.
     // This will copy the data into the map's internal buffer.
     if (rg_struct_map_set(storage->map, id, data) == NULL)
     {
-        storage->id_counter--;
+        rg_storage_id_pool_release(&storage->id_pool, id);
         return RG_STORAGE_NULL_ID;
     }
 
+    if (storage->track_changes)
+    {
+        rg_storage_record_change(storage, id, RG_STORAGE_CHANGE_CREATED);
+    }
     return id;
 }
 
@@ -81,20 +634,120 @@ void *rg_storage_get(rg_storage *storage, rg_storage_id id)
     {
         return NULL;
     }
+    if (storage->mode == RG_STORAGE_MODE_SLOT_MAP)
+    {
+        return rg_storage_slot_map_get(storage, id);
+    }
 
     // Get the storage entry from the map.
     return rg_struct_map_get(storage->map, id);
 }
 
+void rg_storage_get_many(rg_storage *storage, const rg_storage_id *ids, size_t count, void **values)
+{
+    if (storage == NULL)
+    {
+        return;
+    }
+    if (storage->mode == RG_STORAGE_MODE_SLOT_MAP)
+    {
+        // The lookups are cheap, but the values are probably not in the cache: start loading them
+        for (size_t i = 0; i < count; i++)
+        {
+            values[i] = rg_storage_slot_map_get(storage, ids[i]);
+            if (values[i] != NULL)
+            {
+                RG_PREFETCH(values[i]);
+            }
+        }
+        return;
+    }
+
+    // The ids are smaller than the keys of the map, so convert them by batches
+    rg_hash_map_key_t keys[RG_STORAGE_BATCH_SIZE];
+    for (size_t offset = 0; offset < count; offset += RG_STORAGE_BATCH_SIZE)
+    {
+        size_t batch_size = count - offset < RG_STORAGE_BATCH_SIZE ? count - offset : RG_STORAGE_BATCH_SIZE;
+        for (size_t i = 0; i < batch_size; i++)
+        {
+            keys[i] = ids[offset + i];
+        }
+        rg_struct_map_get_many(storage->map, keys, batch_size, values + offset);
+    }
+}
+
 void rg_storage_erase(rg_storage *storage, rg_storage_id id)
 {
     if (storage == NULL)
     {
         return;
     }
+    if (storage->mode == RG_STORAGE_MODE_SLOT_MAP)
+    {
+        if (rg_storage_slot_map_erase(storage, id) && storage->track_changes)
+        {
+            rg_storage_record_change(storage, id, RG_STORAGE_CHANGE_ERASED);
+        }
+        return;
+    }
+
+    // Remove the storage entry from the map, and recycle its id if it existed
+    if (rg_struct_map_exists(storage->map, id))
+    {
+        rg_struct_map_erase(storage->map, id);
+        rg_storage_id_pool_release(&storage->id_pool, id);
+        if (storage->track_changes)
+        {
+            rg_storage_record_change(storage, id, RG_STORAGE_CHANGE_ERASED);
+        }
+    }
+}
+
+void rg_storage_erase_deferred(rg_storage *storage, rg_storage_id id)
+{
+    if (storage == NULL || id == RG_STORAGE_NULL_ID)
+    {
+        return;
+    }
+
+    // If the queue can't grow, erase it right away
+    rg_hash_map_key_t *p_key = rg_vector_push_back_no_data(&storage->pending_erases);
+    if (p_key == NULL)
+    {
+        rg_storage_erase(storage, id);
+        return;
+    }
+    *p_key = id;
+}
+
+void rg_storage_commit_erases(rg_storage *storage)
+{
+    if (storage == NULL || storage->pending_erases.count == 0)
+    {
+        return;
+    }
 
-    // Remove the storage entry from the map.
-    rg_struct_map_erase(storage->map, id);
+    rg_hash_map_key_t *keys  = storage->pending_erases.data;
+    size_t             count = storage->pending_erases.count;
+    if (storage->mode == RG_STORAGE_MODE_SLOT_MAP)
+    {
+        rg_storage_slot_map_erase_many(storage, keys, count);
+    }
+    else
+    {
+        // Recycle the ids that really existed
+        size_t erased_count = rg_struct_map_erase_many(storage->map, keys, count);
+        for (size_t i = 0; i < erased_count; i++)
+        {
+            rg_storage_id_pool_release(&storage->id_pool, (rg_storage_id) keys[i]);
+            if (storage->track_changes)
+            {
+                rg_storage_record_change(storage, (rg_storage_id) keys[i], RG_STORAGE_CHANGE_ERASED);
+            }
+        }
+    }
+
+    rg_vector_clear(&storage->pending_erases);
 }
 
 rg_storage_it rg_storage_iterator(rg_storage *storage)
@@ -103,25 +756,65 @@ rg_storage_it rg_storage_iterator(rg_storage *storage)
     {
         return (rg_storage_it) {0};
     }
+    if (storage->mode == RG_STORAGE_MODE_SLOT_MAP)
+    {
+        return (rg_storage_it) {
+            .storage   = storage,
+            .end_index = SIZE_MAX,
+        };
+    }
 
     return (rg_storage_it) {
-        .map_it = rg_struct_map_iterator(storage->map),
+        .storage   = storage,
+        .map_it    = rg_struct_map_iterator(storage->map),
+        .end_index = SIZE_MAX,
     };
 }
 
 bool rg_storage_next(rg_storage_it *it)
 {
-    if (it == NULL)
+    if (it == NULL || it->storage == NULL)
     {
         return false;
     }
 
+    // In slot map mode, iterate directly on the dense arrays, or on the pages
+    if (it->storage->mode == RG_STORAGE_MODE_SLOT_MAP)
+    {
+        rg_storage *storage = it->storage;
+        if (storage->stable_addresses)
+        {
+            size_t index = it->next_index;
+            it->value    = rg_paged_pool_next(&storage->pool, &index);
+            if (it->value == NULL || index >= it->end_index)
+            {
+                it->id    = RG_STORAGE_NULL_ID;
+                it->value = NULL;
+                return false;
+            }
+            it->id         = ((rg_storage_id *) storage->ids.data)[index];
+            it->next_index = index + 1;
+            return true;
+        }
+        if (it->next_index < storage->values.count && it->next_index < it->end_index)
+        {
+            it->id    = ((rg_storage_id *) storage->ids.data)[it->next_index];
+            it->value = (char *) storage->values.data + it->next_index * storage->element_size;
+            it->next_index++;
+            return true;
+        }
+        it->id    = RG_STORAGE_NULL_ID;
+        it->value = NULL;
+        return false;
+    }
+
     // Get the next storage entry from the map.
-    bool result = rg_struct_map_next(&it->map_it);
+    // The next index of the map iterator is the place after the entry.
+    bool result = rg_struct_map_next(&it->map_it) && it->map_it.next_index <= it->end_index;
 
     if (result)
     {
-        it->id    = it->map_it.key;
+        it->id    = (rg_storage_id) it->map_it.key;
         it->value = it->map_it.value;
     }
     else
@@ -133,12 +826,107 @@ bool rg_storage_next(rg_storage_it *it)
     return result;
 }
 
+// --=== Parallel iteration ===--
+
+typedef struct rg_storage_parallel_job
+{
+    rg_storage               *storage;
+    rg_storage_chunk_function pfn_chunk;
+    void                     *user_data;
+    size_t                    grain;
+} rg_storage_parallel_job;
+
+/** Returns the number of places in the backing arrays of the storage, including the holes when stable addresses are used. */
+static size_t rg_storage_place_count(rg_storage *storage)
+{
+    if (storage->mode == RG_STORAGE_MODE_SLOT_MAP)
+    {
+        // With stable addresses, the ids vector follows the places of the pool
+        return storage->stable_addresses ? storage->ids.count : storage->values.count;
+    }
+    return rg_struct_map_place_count(storage->map);
+}
+
+static void rg_storage_run_chunk(size_t chunk_index, void *p_job)
+{
+    rg_storage_parallel_job *job = p_job;
+
+    // Iterate on the places of the chunk only
+    rg_storage_it it     = rg_storage_iterator(job->storage);
+    it.next_index        = chunk_index * job->grain;
+    it.map_it.next_index = chunk_index * job->grain;
+    it.end_index         = it.next_index + job->grain;
+
+    job->pfn_chunk(&it, chunk_index, job->user_data);
+}
+
+size_t rg_storage_chunk_count(rg_storage *storage, size_t grain)
+{
+    if (storage == NULL)
+    {
+        return 0;
+    }
+    if (grain == 0)
+    {
+        grain = RG_STORAGE_DEFAULT_GRAIN;
+    }
+    return (rg_storage_place_count(storage) + grain - 1) / grain;
+}
+
+void rg_storage_parallel_for(rg_storage *storage, rg_storage_chunk_function pfn_chunk, void *user_data, size_t grain)
+{
+    if (storage == NULL)
+    {
+        return;
+    }
+
+    rg_storage_parallel_job job = {
+        .storage   = storage,
+        .pfn_chunk = pfn_chunk,
+        .user_data = user_data,
+        .grain     = grain != 0 ? grain : RG_STORAGE_DEFAULT_GRAIN,
+    };
+    rg_thread_pool_run(storage->thread_pool, rg_storage_chunk_count(storage, job.grain), rg_storage_run_chunk, &job);
+}
+
+bool rg_storage_shrink_to_fit(rg_storage *storage)
+{
+    if (storage == NULL)
+    {
+        return false;
+    }
+    if (storage->mode == RG_STORAGE_MODE_SLOT_MAP)
+    {
+        // The slots are still referenced by the free list, only the dense arrays can shrink
+        if (storage->stable_addresses)
+        {
+            // The ids after the last page are not used anymore
+            bool   pool_success = rg_paged_pool_shrink_to_fit(&storage->pool);
+            size_t id_count     = storage->pool.pages.count * RG_PAGED_POOL_PAGE_CAPACITY;
+            if (storage->ids.count > id_count)
+            {
+                storage->ids.count = id_count;
+            }
+            return pool_success && rg_vector_shrink_to_fit(&storage->ids);
+        }
+        bool values_success = rg_vector_shrink_to_fit(&storage->values);
+        bool ids_success    = rg_vector_shrink_to_fit(&storage->ids);
+        return values_success && ids_success;
+    }
+
+    return rg_struct_map_shrink_to_fit(storage->map);
+}
+
 size_t rg_storage_count(rg_storage *storage)
 {
     if (storage == NULL)
     {
         return 0;
     }
+    if (storage->mode == RG_STORAGE_MODE_SLOT_MAP)
+    {
+        return storage->stable_addresses ? storage->pool.count : storage->values.count;
+    }
 
     return rg_struct_map_count(storage->map);
 }
@@ -149,10 +937,105 @@ bool rg_storage_exists(rg_storage *storage, rg_storage_id id)
     {
         return false;
     }
+    if (storage->mode == RG_STORAGE_MODE_SLOT_MAP)
+    {
+        return rg_storage_slot_map_find(storage, id) != UINT32_MAX;
+    }
 
     return rg_struct_map_exists(storage->map, id);
 }
 
+void rg_storage_mark_modified(rg_storage *storage, rg_storage_id id)
+{
+    if (storage != NULL && storage->track_changes && rg_storage_exists(storage, id))
+    {
+        rg_storage_record_change(storage, id, RG_STORAGE_CHANGE_MODIFIED);
+    }
+}
+
+uint64_t rg_storage_current_epoch(rg_storage *storage)
+{
+    return storage != NULL && storage->track_changes ? storage->epoch : 0;
+}
+
+uint64_t rg_storage_begin_epoch(rg_storage *storage)
+{
+    if (storage == NULL || !storage->track_changes)
+    {
+        return 0;
+    }
+
+    // Only the ids recorded in the current epoch can be dirty
+    const rg_storage_change *changes = storage->journal.data;
+    for (size_t i = storage->epoch_start; i < storage->journal.count; i++)
+    {
+        rg_storage_clear_dirty(storage, changes[i].id);
+    }
+    storage->epoch_start = storage->journal.count;
+
+    return ++storage->epoch;
+}
+
+/** Returns the index of the first change of the journal made in the given epoch or after. */
+static size_t rg_storage_find_epoch(rg_storage *storage, uint64_t epoch)
+{
+    const rg_storage_change *changes = storage->journal.data;
+    size_t                   low     = 0;
+    size_t                   high    = storage->journal.count;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (changes[middle].epoch < epoch)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+rg_storage_changes rg_storage_changes_since(rg_storage *storage, uint64_t epoch)
+{
+    if (storage == NULL || !storage->track_changes)
+    {
+        return (rg_storage_changes) {0};
+    }
+
+    size_t first = rg_storage_find_epoch(storage, epoch);
+    return (rg_storage_changes) {
+        .changes  = (rg_storage_change *) storage->journal.data + first,
+        .count    = storage->journal.count - first,
+        .complete = storage->lost_epoch < epoch,
+    };
+}
+
+void rg_storage_discard_changes_before(rg_storage *storage, uint64_t epoch)
+{
+    if (storage == NULL || !storage->track_changes)
+    {
+        return;
+    }
+
+    // The changes of the current epoch are never discarded, since the dirty ids are cleared from them
+    if (epoch > storage->epoch)
+    {
+        epoch = storage->epoch;
+    }
+    size_t discarded_count = rg_storage_find_epoch(storage, epoch);
+    if (discarded_count == 0)
+    {
+        return;
+    }
+
+    rg_storage_change *changes = storage->journal.data;
+    memmove(changes, changes + discarded_count, (storage->journal.count - discarded_count) * sizeof(rg_storage_change));
+    storage->journal.count -= discarded_count;
+    storage->epoch_start -= discarded_count;
+}
+
 // endregion
 
 // region Handle storage
@@ -161,32 +1044,41 @@ bool rg_storage_exists(rg_storage *storage, rg_storage_id id)
 
 typedef struct rg_handle_storage
 {
-    rg_storage_id id_counter;
-    rg_hash_map  *map;
+    // The ids come from the slot table, like in the slot map storages. handles[i] is the handle of the slot i.
+    rg_slot_table slots;
+    rg_vector     handles;
+    size_t        count;
 } rg_handle_storage;
 
 // --=== Functions ===--
 
 rg_handle_storage *rg_create_handle_storage(void)
+{
+    return rg_create_handle_storage_with_allocator(NULL);
+}
+
+rg_handle_storage *rg_create_handle_storage_with_allocator(const rg_allocator *allocator)
 {
     // Allocate the storage structure.
-    rg_handle_storage *storage = rg_calloc(1, sizeof(rg_handle_storage));
+    rg_handle_storage *storage = rg_allocator_calloc(allocator, 1, sizeof(rg_handle_storage));
     if (storage == NULL)
     {
         return NULL;
     }
 
-    // Initialize the storage's map.
-    storage->map = rg_create_hash_map();
-    if (storage->map == NULL)
+    // Initialize the storage's slots.
+    // The allocator is kept by the vectors, so it can be found again when the storage is destroyed
+    if (!rg_create_slot_table(allocator, &storage->slots))
     {
-        rg_free(storage);
+        rg_allocator_free(allocator, storage);
+        return NULL;
+    }
+    if (!rg_create_vector_with_allocator(2, sizeof(void *), allocator, &storage->handles))
+    {
+        rg_destroy_slot_table(&storage->slots);
+        rg_allocator_free(allocator, storage);
         return NULL;
     }
-
-    // Initialize the storage's ID counter.
-    // Start at one, since zero is reserved for RG_STORAGE_NULL_ID.
-    storage->id_counter = 1;
 
     return storage;
 }
@@ -198,11 +1090,13 @@ void rg_destroy_handle_storage(rg_handle_storage **storage)
         return;
     }
 
-    // Destroy the storage's map.
-    rg_destroy_hash_map(&(*storage)->map);
+    // Destroy the storage's slots and handles.
+    const rg_allocator *allocator = (*storage)->handles.allocator;
+    rg_destroy_slot_table(&(*storage)->slots);
+    rg_destroy_vector(&(*storage)->handles);
 
     // Free the storage structure.
-    rg_free(*storage);
+    rg_allocator_free(allocator, *storage);
     *storage = NULL;
 }
 
@@ -213,32 +1107,27 @@ rg_storage_id rg_handle_storage_push(rg_handle_storage *storage, void *handle)
         return RG_STORAGE_NULL_ID;
     }
 
-    // Generate a new ID for the storage entry.
-    rg_storage_id id = storage->id_counter++;
-
-    // Add the storage entry to the map.
-    // This will copy the handle into the map's internal buffer.
-    if (rg_hash_map_set(storage->map, id, (rg_hash_map_value_t) {.as_ptr = handle}) == false)
+    // Get the id of a free slot, but only take the slot once its handle can be stored
+    rg_storage_id id = rg_slot_table_prepare(&storage->slots);
+    if (id == RG_SLOT_TABLE_NULL_ID)
+    {
+        return RG_STORAGE_NULL_ID;
+    }
+    uint32_t slot_index = rg_slot_table_index(id);
+    if (slot_index >= storage->handles.count && rg_vector_push_back_no_data(&storage->handles) == NULL)
     {
-        storage->id_counter--;
         return RG_STORAGE_NULL_ID;
     }
 
-    return id;
+    ((void **) storage->handles.data)[slot_index] = handle;
+    storage->count++;
+    return rg_slot_table_acquire(&storage->slots, slot_index);
 }
 
 rg_handle_storage_get_result rg_handle_storage_get(rg_handle_storage *storage, rg_storage_id id)
 {
-    if (storage == NULL)
-    {
-        return (rg_handle_storage_get_result) {
-            .exists = false,
-        };
-    }
-
-    // Get the storage entry from the map.
-    rg_hash_map_get_result get_result = rg_hash_map_get(storage->map, id);
-    if (!get_result.exists)
+    uint32_t slot_index = storage != NULL ? rg_slot_table_find(&storage->slots, id) : UINT32_MAX;
+    if (slot_index == UINT32_MAX)
     {
         return (rg_handle_storage_get_result) {
             .exists = false,
@@ -246,56 +1135,56 @@ rg_handle_storage_get_result rg_handle_storage_get(rg_handle_storage *storage, r
     }
 
     return (rg_handle_storage_get_result) {
-        .value  = get_result.value.as_ptr,
+        .value  = ((void **) storage->handles.data)[slot_index],
         .exists = true,
     };
 }
 
 void rg_handle_storage_erase(rg_handle_storage *storage, rg_storage_id id)
 {
-    if (storage == NULL)
+    uint32_t slot_index = storage != NULL ? rg_slot_table_find(&storage->slots, id) : UINT32_MAX;
+    if (slot_index == UINT32_MAX)
     {
         return;
     }
 
-    // Remove the storage entry from the map.
-    rg_hash_map_erase(storage->map, id);
+    ((void **) storage->handles.data)[slot_index] = NULL;
+    rg_slot_table_release(&storage->slots, id);
+    storage->count--;
 }
 
 rg_handle_storage_it rg_handle_storage_iterator(rg_handle_storage *storage)
 {
-    if (storage == NULL)
-    {
-        return (rg_handle_storage_it) {0};
-    }
-
     return (rg_handle_storage_it) {
-        .map_it = rg_hash_map_iterator(storage->map),
+        .storage = storage,
     };
 }
 
 bool rg_handle_storage_next(rg_handle_storage_it *it)
 {
-    if (it == NULL)
+    if (it == NULL || it->storage == NULL)
     {
         return false;
     }
 
-    // Get the next storage entry from the map.
-    bool result = rg_hash_map_next(&it->map_it);
-
-    if (result)
+    // Skip the free slots
+    rg_handle_storage *storage = it->storage;
+    while (it->next_index < storage->handles.count)
     {
-        it->id    = it->map_it.key;
-        it->value = it->map_it.value.as_ptr;
-    }
-    else
-    {
-        it->id    = RG_STORAGE_NULL_ID;
-        it->value = NULL;
+        rg_storage_id id = rg_slot_table_id(&storage->slots, (uint32_t) it->next_index);
+        if (id != RG_SLOT_TABLE_NULL_ID)
+        {
+            it->id    = id;
+            it->value = ((void **) storage->handles.data)[it->next_index];
+            it->next_index++;
+            return true;
+        }
+        it->next_index++;
     }
 
-    return result;
+    it->id    = RG_STORAGE_NULL_ID;
+    it->value = NULL;
+    return false;
 }
 
 size_t rg_handle_storage_count(rg_handle_storage *storage)
@@ -305,7 +1194,7 @@ size_t rg_handle_storage_count(rg_handle_storage *storage)
         return 0;
     }
 
-    return rg_hash_map_count(storage->map);
+    return storage->count;
 }
 
 // endregion
\ No newline at end of file
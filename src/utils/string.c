@@ -30,6 +30,11 @@ rg_string rg_create_string_from_cstr(const char *cstr)
 }
 
 rg_string rg_clone_string(const rg_string string)
+{
+    return rg_clone_string_with_allocator(string, NULL);
+}
+
+rg_string rg_clone_string_with_allocator(const rg_string string, const rg_allocator *allocator)
 {
     // Empty string: no need to malloc
     if (rg_string_is_empty(string))
@@ -39,7 +44,7 @@ rg_string rg_clone_string(const rg_string string)
 
     // Copy the string into a new string
     rg_string clone = {
-        .data   = (char *) rg_malloc(string.length + 1),
+        .data   = (char *) rg_allocator_alloc(allocator, string.length + 1),
         .length = string.length,
     };
     if (clone.data == NULL)
@@ -51,7 +56,7 @@ rg_string rg_clone_string(const rg_string string)
     void *new_data = memcpy(clone.data, string.data, string.length + 1);
     if (new_data == NULL)
     {
-        rg_free(clone.data);
+        rg_allocator_free(allocator, clone.data);
         return RG_EMPTY_STRING;
     }
 
@@ -59,6 +64,11 @@ rg_string rg_clone_string(const rg_string string)
 }
 
 rg_string rg_create_string_from_buffer(void *buffer, size_t length)
+{
+    return rg_create_string_from_buffer_with_allocator(buffer, length, NULL);
+}
+
+rg_string rg_create_string_from_buffer_with_allocator(void *buffer, size_t length, const rg_allocator *allocator)
 {
     if (buffer == NULL || length == 0)
     {
@@ -66,7 +76,7 @@ rg_string rg_create_string_from_buffer(void *buffer, size_t length)
     }
 
     // Add a null terminator
-    char *new_data = (char *) rg_malloc(length + 1);
+    char *new_data = (char *) rg_allocator_alloc(allocator, length + 1);
     if (new_data == NULL)
     {
         return RG_EMPTY_STRING;
@@ -76,7 +86,7 @@ rg_string rg_create_string_from_buffer(void *buffer, size_t length)
     void *new_data_copy = memcpy(new_data, buffer, length);
     if (new_data_copy == NULL)
     {
-        rg_free(new_data);
+        rg_allocator_free(allocator, new_data);
         return RG_EMPTY_STRING;
     }
 
@@ -90,6 +100,11 @@ rg_string rg_create_string_from_buffer(void *buffer, size_t length)
 }
 
 rg_string rg_string_concat(rg_string a, rg_string b)
+{
+    return rg_string_concat_with_allocator(a, b, NULL);
+}
+
+rg_string rg_string_concat_with_allocator(rg_string a, rg_string b, const rg_allocator *allocator)
 {
     // Do not malloc 0 bytes of memory in case of empty strings
     if (rg_string_is_empty(a) && rg_string_is_empty(b))
@@ -100,7 +115,7 @@ rg_string rg_string_concat(rg_string a, rg_string b)
     // Allocate memory for the new string. It will be greater than 0 since we know that they are not both empty.
     size_t    new_length = a.length + b.length;
     rg_string new_string = {
-        .data   = (char *) rg_malloc(new_length + 1),
+        .data   = (char *) rg_allocator_alloc(allocator, new_length + 1),
         .length = new_length,
     };
     if (new_string.data == NULL)
@@ -127,13 +142,21 @@ rg_string rg_string_concat(rg_string a, rg_string b)
     // If there was an error, free the memory and return an empty string
     else
     {
-        rg_free(new_string.data);
+        rg_allocator_free(allocator, new_string.data);
         return RG_EMPTY_STRING;
     }
 
     return new_string;
 }
 
+void rg_free_string(rg_string string, const rg_allocator *allocator)
+{
+    if (!rg_string_is_empty(string) && string.data != NULL)
+    {
+        rg_allocator_free(allocator, string.data);
+    }
+}
+
 bool rg_string_equals(rg_string a, rg_string b)
 {
     // Two empty strings are equal
@@ -0,0 +1,343 @@
+#include "railguard/utils/threads.h"
+
+#include <railguard/utils/memory.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// --=== Platform ===--
+
+// Thin wrappers around the threads of the platform, so that the pool itself doesn't depend on it
+
+#ifdef _WIN32
+
+typedef HANDLE             rg_thread;
+typedef SRWLOCK            rg_mutex;
+typedef CONDITION_VARIABLE rg_condition;
+
+#else
+
+typedef pthread_t       rg_thread;
+typedef pthread_mutex_t rg_mutex;
+typedef pthread_cond_t  rg_condition;
+
+#endif
+
+// --=== Type Definitions ===--
+
+typedef struct rg_thread_pool
+{
+    rg_mutex     mutex;
+    rg_condition work_available;
+    rg_condition work_done;
+    rg_thread   *workers;
+    size_t       worker_count;
+    bool         stopping;
+
+    // Current job, protected by the mutex
+    rg_thread_pool_task_function pfn_task;
+    void                        *user_data;
+    size_t                       task_count;
+    size_t                       next_task;
+    size_t                       done_task_count;
+} rg_thread_pool;
+
+// --=== Platform functions ===--
+
+#ifdef _WIN32
+
+static bool rg_thread_pool_init_sync(rg_thread_pool *pool)
+{
+    InitializeSRWLock(&pool->mutex);
+    InitializeConditionVariable(&pool->work_available);
+    InitializeConditionVariable(&pool->work_done);
+    return true;
+}
+
+static void rg_thread_pool_cleanup_sync(rg_thread_pool *pool)
+{
+    // SRW locks and condition variables don't need to be destroyed
+    (void) pool;
+}
+
+static inline void rg_thread_pool_lock(rg_thread_pool *pool)
+{
+    AcquireSRWLockExclusive(&pool->mutex);
+}
+
+static inline void rg_thread_pool_unlock(rg_thread_pool *pool)
+{
+    ReleaseSRWLockExclusive(&pool->mutex);
+}
+
+static inline void rg_thread_pool_wait(rg_thread_pool *pool, rg_condition *condition)
+{
+    SleepConditionVariableSRW(condition, &pool->mutex, INFINITE, 0);
+}
+
+static inline void rg_thread_pool_broadcast(rg_condition *condition)
+{
+    WakeAllConditionVariable(condition);
+}
+
+static size_t rg_thread_pool_processor_count(void)
+{
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    return system_info.dwNumberOfProcessors;
+}
+
+#else
+
+static bool rg_thread_pool_init_sync(rg_thread_pool *pool)
+{
+    if (pthread_mutex_init(&pool->mutex, NULL) != 0)
+    {
+        return false;
+    }
+    if (pthread_cond_init(&pool->work_available, NULL) != 0)
+    {
+        pthread_mutex_destroy(&pool->mutex);
+        return false;
+    }
+    if (pthread_cond_init(&pool->work_done, NULL) != 0)
+    {
+        pthread_cond_destroy(&pool->work_available);
+        pthread_mutex_destroy(&pool->mutex);
+        return false;
+    }
+    return true;
+}
+
+static void rg_thread_pool_cleanup_sync(rg_thread_pool *pool)
+{
+    pthread_cond_destroy(&pool->work_done);
+    pthread_cond_destroy(&pool->work_available);
+    pthread_mutex_destroy(&pool->mutex);
+}
+
+static inline void rg_thread_pool_lock(rg_thread_pool *pool)
+{
+    pthread_mutex_lock(&pool->mutex);
+}
+
+static inline void rg_thread_pool_unlock(rg_thread_pool *pool)
+{
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+static inline void rg_thread_pool_wait(rg_thread_pool *pool, rg_condition *condition)
+{
+    pthread_cond_wait(condition, &pool->mutex);
+}
+
+static inline void rg_thread_pool_broadcast(rg_condition *condition)
+{
+    pthread_cond_broadcast(condition);
+}
+
+static size_t rg_thread_pool_processor_count(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (size_t) count : 1;
+}
+
+#endif
+
+// --=== Workers ===--
+
+/**
+ * Runs the tasks of the current job until there is none left to start. The mutex must be locked, and is locked again when it returns.
+ */
+static void rg_thread_pool_run_tasks(rg_thread_pool *pool)
+{
+    while (pool->next_task < pool->task_count)
+    {
+        size_t task_index = pool->next_task++;
+
+        rg_thread_pool_unlock(pool);
+        pool->pfn_task(task_index, pool->user_data);
+        rg_thread_pool_lock(pool);
+
+        // The last task to finish wakes up the calling thread
+        pool->done_task_count++;
+        if (pool->done_task_count == pool->task_count)
+        {
+            rg_thread_pool_broadcast(&pool->work_done);
+        }
+    }
+}
+
+static void rg_thread_pool_worker_loop(rg_thread_pool *pool)
+{
+    rg_thread_pool_lock(pool);
+    while (true)
+    {
+        while (!pool->stopping && pool->next_task >= pool->task_count)
+        {
+            rg_thread_pool_wait(pool, &pool->work_available);
+        }
+        if (pool->stopping)
+        {
+            break;
+        }
+        rg_thread_pool_run_tasks(pool);
+    }
+    rg_thread_pool_unlock(pool);
+}
+
+#ifdef _WIN32
+
+static DWORD WINAPI rg_thread_pool_worker_main(LPVOID p_pool)
+{
+    rg_thread_pool_worker_loop(p_pool);
+    return 0;
+}
+
+static bool rg_thread_pool_start_worker(rg_thread_pool *pool, rg_thread *p_thread)
+{
+    *p_thread = CreateThread(NULL, 0, rg_thread_pool_worker_main, pool, 0, NULL);
+    return *p_thread != NULL;
+}
+
+static void rg_thread_pool_join_worker(rg_thread thread)
+{
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+#else
+
+static void *rg_thread_pool_worker_main(void *p_pool)
+{
+    rg_thread_pool_worker_loop(p_pool);
+    return NULL;
+}
+
+static bool rg_thread_pool_start_worker(rg_thread_pool *pool, rg_thread *p_thread)
+{
+    return pthread_create(p_thread, NULL, rg_thread_pool_worker_main, pool) == 0;
+}
+
+static void rg_thread_pool_join_worker(rg_thread thread)
+{
+    pthread_join(thread, NULL);
+}
+
+#endif
+
+/** Stops and joins the first worker_count workers. */
+static void rg_thread_pool_stop_workers(rg_thread_pool *pool, size_t worker_count)
+{
+    rg_thread_pool_lock(pool);
+    pool->stopping = true;
+    rg_thread_pool_broadcast(&pool->work_available);
+    rg_thread_pool_unlock(pool);
+
+    for (size_t i = 0; i < worker_count; i++)
+    {
+        rg_thread_pool_join_worker(pool->workers[i]);
+    }
+}
+
+// --=== Functions ===--
+
+rg_thread_pool *rg_create_thread_pool(size_t worker_count)
+{
+    if (worker_count == 0)
+    {
+        size_t processor_count = rg_thread_pool_processor_count();
+        worker_count           = processor_count > 1 ? processor_count - 1 : 1;
+    }
+
+    rg_thread_pool *pool = rg_calloc(1, sizeof(rg_thread_pool));
+    if (pool == NULL)
+    {
+        return NULL;
+    }
+    if (!rg_thread_pool_init_sync(pool))
+    {
+        rg_free(pool);
+        return NULL;
+    }
+    pool->workers = rg_malloc(worker_count * sizeof(rg_thread));
+    if (pool->workers == NULL)
+    {
+        rg_thread_pool_cleanup_sync(pool);
+        rg_free(pool);
+        return NULL;
+    }
+
+    // Start the workers. They wait until a job is available.
+    for (size_t i = 0; i < worker_count; i++)
+    {
+        if (!rg_thread_pool_start_worker(pool, &pool->workers[i]))
+        {
+            rg_thread_pool_stop_workers(pool, i);
+            rg_free(pool->workers);
+            rg_thread_pool_cleanup_sync(pool);
+            rg_free(pool);
+            return NULL;
+        }
+    }
+    pool->worker_count = worker_count;
+
+    return pool;
+}
+
+void rg_destroy_thread_pool(rg_thread_pool **p_pool)
+{
+    if (p_pool == NULL || *p_pool == NULL)
+    {
+        return;
+    }
+
+    rg_thread_pool_stop_workers(*p_pool, (*p_pool)->worker_count);
+    rg_free((*p_pool)->workers);
+    rg_thread_pool_cleanup_sync(*p_pool);
+
+    rg_free(*p_pool);
+    *p_pool = NULL;
+}
+
+size_t rg_thread_pool_thread_count(rg_thread_pool *pool)
+{
+    return pool != NULL ? pool->worker_count + 1 : 1;
+}
+
+void rg_thread_pool_run(rg_thread_pool *pool, size_t task_count, rg_thread_pool_task_function pfn_task, void *user_data)
+{
+    // Waking up the workers is not worth it for a single task
+    if (pool == NULL || task_count <= 1)
+    {
+        for (size_t i = 0; i < task_count; i++)
+        {
+            pfn_task(i, user_data);
+        }
+        return;
+    }
+
+    rg_thread_pool_lock(pool);
+    pool->pfn_task        = pfn_task;
+    pool->user_data       = user_data;
+    pool->task_count      = task_count;
+    pool->next_task       = 0;
+    pool->done_task_count = 0;
+    rg_thread_pool_broadcast(&pool->work_available);
+
+    // Help the workers, then wait for the tasks that they are still running
+    rg_thread_pool_run_tasks(pool);
+    while (pool->done_task_count < pool->task_count)
+    {
+        rg_thread_pool_wait(pool, &pool->work_done);
+    }
+
+    // Reset the job so that the workers go back to sleep
+    pool->task_count = 0;
+    pool->next_task  = 0;
+    rg_thread_pool_unlock(pool);
+}
@@ -0,0 +1,660 @@
+#pragma once
+
+#include "../framework/test_framework.h"
+#include "bench_utils.h"
+#include <railguard/utils/maps.h>
+#include <railguard/utils/storage.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct rg_bench_hash_map_result
+{
+    double insert_ns;
+    double lookup_ns;
+    double miss_ns;
+    double erase_ns;
+} rg_bench_hash_map_result;
+
+/**
+ * Measures the throughput of the main operations of a hash map created with the given info.
+ * @param keys count unique non-null keys, in insertion order
+ * @param shuffled_keys the same keys in another order, used for the lookups and the erasures
+ * @param missing_keys count keys that are not in the map
+ */
+bool rg_bench_hash_map_run(const rg_hash_map_create_info *create_info,
+                           const uint64_t                *keys,
+                           const uint64_t                *shuffled_keys,
+                           const uint64_t                *missing_keys,
+                           size_t                         count,
+                           rg_bench_hash_map_result      *result)
+{
+    rg_hash_map *map = rg_create_hash_map_with_info(create_info);
+    if (map == NULL)
+    {
+        return false;
+    }
+
+    bool     ok    = true;
+    uint64_t start = rg_bench_now_ns();
+    for (size_t i = 0; i < count; i++)
+    {
+        ok &= rg_hash_map_set(map, keys[i], (rg_hash_map_value_t) {.as_num = i});
+    }
+    result->insert_ns = rg_bench_ns_per_op(start, count);
+
+    uint64_t sum = 0;
+    start        = rg_bench_now_ns();
+    for (size_t i = 0; i < count; i++)
+    {
+        sum += rg_hash_map_get(map, shuffled_keys[i]).value.as_num;
+    }
+    result->lookup_ns = rg_bench_ns_per_op(start, count);
+
+    start = rg_bench_now_ns();
+    for (size_t i = 0; i < count; i++)
+    {
+        sum += rg_hash_map_get(map, missing_keys[i]).exists;
+    }
+    result->miss_ns = rg_bench_ns_per_op(start, count);
+    rg_bench_sink   = sum;
+
+    start = rg_bench_now_ns();
+    for (size_t i = 0; i < count; i++)
+    {
+        rg_hash_map_erase(map, shuffled_keys[i]);
+    }
+    result->erase_ns = rg_bench_ns_per_op(start, count);
+
+    ok &= rg_hash_map_count(map) == 0;
+    rg_destroy_hash_map(&map);
+    return ok;
+}
+
+TEST(HashMapBench_Layouts)
+{
+    const struct
+    {
+        const char             *name;
+        rg_hash_map_create_info info;
+    } configs[] = {
+        {"linear", {.layout = RG_HASH_MAP_LAYOUT_LINEAR}},
+        {"grouped", {.layout = RG_HASH_MAP_LAYOUT_GROUPED}},
+    };
+    const size_t config_count = sizeof(configs) / sizeof(configs[0]);
+
+    uint64_t *keys          = malloc(RG_BENCH_MAX_COUNT * sizeof(uint64_t));
+    uint64_t *shuffled_keys = malloc(RG_BENCH_MAX_COUNT * sizeof(uint64_t));
+    uint64_t *missing_keys  = malloc(RG_BENCH_MAX_COUNT * sizeof(uint64_t));
+    ASSERT_TRUE(keys != NULL && shuffled_keys != NULL && missing_keys != NULL);
+
+    // Random keys are used, like pointers or external ids. Missing keys are odd, present keys are even, so they never collide.
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < RG_BENCH_MAX_COUNT; i++)
+    {
+        keys[i]         = (rg_bench_random(&state) | 2) & ~1ULL;
+        missing_keys[i] = rg_bench_random(&state) | 1;
+    }
+
+    printf("\n%-10s %10s %12s %12s %12s %12s\n", "layout", "keys", "insert ns", "lookup ns", "miss ns", "erase ns");
+    for (size_t count = 1000; count <= RG_BENCH_MAX_COUNT; count *= 10)
+    {
+        memcpy(shuffled_keys, keys, count * sizeof(uint64_t));
+        rg_bench_shuffle(shuffled_keys, count, &state);
+
+        for (size_t c = 0; c < config_count; c++)
+        {
+            rg_bench_hash_map_result result = {0};
+            EXPECT_TRUE(rg_bench_hash_map_run(&configs[c].info, keys, shuffled_keys, missing_keys, count, &result));
+            printf("%-10s %10zu %12.2f %12.2f %12.2f %12.2f\n",
+                   configs[c].name,
+                   count,
+                   result.insert_ns,
+                   result.lookup_ns,
+                   result.miss_ns,
+                   result.erase_ns);
+        }
+    }
+
+    free(keys);
+    free(shuffled_keys);
+    free(missing_keys);
+}
+
+// Byte-wise FNV-1a, which was the hash function of the maps before fmix64. Kept here as a reference.
+uint64_t rg_bench_hash_map_fnv1a(rg_hash_map_key_t key)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < sizeof(key); i++)
+    {
+        hash ^= (key >> (i * 8)) & 0xFF;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t rg_bench_hash_map_identity(rg_hash_map_key_t key)
+{
+    return key;
+}
+
+TEST(HashMapBench_SequentialIds)
+{
+    // Storage ids are generated by a counter, so they are sequential. That is the most common workload of the maps.
+    const struct
+    {
+        const char               *name;
+        rg_hash_map_hash_function pfn_hash;
+    } hashes[] = {
+        {"fmix64", NULL},
+        {"fnv1a", rg_bench_hash_map_fnv1a},
+        {"identity", rg_bench_hash_map_identity},
+    };
+    const rg_hash_map_layout layouts[4]      = {RG_HASH_MAP_LAYOUT_LINEAR,
+                                                RG_HASH_MAP_LAYOUT_GROUPED,
+                                                RG_HASH_MAP_LAYOUT_LINEAR,
+                                                RG_HASH_MAP_LAYOUT_GROUPED};
+    const bool               compact[4]      = {false, false, true, true};
+    const char              *layout_names[4] = {"linear", "grouped", "linear32", "grouped32"};
+
+    printf("\n%-9s %-9s %9s %10s %10s %6s %5s   probe length histogram (0, 1, 2, ...)\n",
+           "hash",
+           "layout",
+           "keys",
+           "insert ns",
+           "lookup ns",
+           "mean",
+           "max");
+    for (size_t count = 1000; count <= RG_BENCH_MAX_COUNT; count *= 100)
+    {
+        for (size_t h = 0; h < sizeof(hashes) / sizeof(hashes[0]); h++)
+        {
+            for (size_t l = 0; l < 4; l++)
+            {
+                rg_hash_map_create_info create_info = {
+                    .layout   = layouts[l],
+                    .pfn_hash = hashes[h].pfn_hash,
+                    .compact  = compact[l],
+                };
+                rg_hash_map *map = rg_create_hash_map_with_info(&create_info);
+                ASSERT_NOT_NULL(map);
+
+                uint64_t start = rg_bench_now_ns();
+                for (size_t i = 1; i <= count; i++)
+                {
+                    rg_hash_map_set(map, (rg_storage_id) i, (rg_hash_map_value_t) {.as_num = i});
+                }
+                double insert_ns = rg_bench_ns_per_op(start, count);
+
+                uint64_t sum = 0;
+                start        = rg_bench_now_ns();
+                for (size_t i = 1; i <= count; i++)
+                {
+                    sum += rg_hash_map_get(map, (rg_storage_id) i).value.as_num;
+                }
+                double lookup_ns = rg_bench_ns_per_op(start, count);
+                rg_bench_sink    = sum;
+
+                rg_hash_map_stats stats = rg_hash_map_get_stats(map);
+                printf("%-9s %-9s %9zu %10.2f %10.2f %6.2f %5zu  ",
+                       hashes[h].name,
+                       layout_names[l],
+                       count,
+                       insert_ns,
+                       lookup_ns,
+                       stats.mean_probe_length,
+                       stats.max_probe_length);
+                for (size_t i = 0; i < RG_HASH_MAP_PROBE_HISTOGRAM_SIZE && i <= stats.max_probe_length; i++)
+                {
+                    printf(" %zu", stats.probe_length_histogram[i]);
+                }
+                printf("\n");
+
+                EXPECT_TRUE(rg_hash_map_count(map) == count);
+                rg_destroy_hash_map(&map);
+            }
+        }
+    }
+}
+
+TEST(HashMapBench_WorstCaseLatency)
+{
+    // Measure every insertion separately, to see the cost of the resizes instead of amortizing it
+    const struct
+    {
+        const char             *name;
+        rg_hash_map_create_info info;
+    } configs[] = {
+        {"linear", {.layout = RG_HASH_MAP_LAYOUT_LINEAR}},
+        {"linear incremental", {.layout = RG_HASH_MAP_LAYOUT_LINEAR, .incremental_resize = true}},
+        {"grouped", {.layout = RG_HASH_MAP_LAYOUT_GROUPED}},
+        {"grouped incremental", {.layout = RG_HASH_MAP_LAYOUT_GROUPED, .incremental_resize = true}},
+    };
+    const size_t config_count = sizeof(configs) / sizeof(configs[0]);
+
+    printf("\n%-20s %10s %12s %14s %14s\n", "map", "keys", "mean ns", "worst ns", "lookup ns");
+    for (size_t count = 1000; count <= RG_BENCH_MAX_COUNT; count *= 10)
+    {
+        for (size_t c = 0; c < config_count; c++)
+        {
+            rg_hash_map *map = rg_create_hash_map_with_info(&configs[c].info);
+            ASSERT_NOT_NULL(map);
+
+            uint64_t total_ns = 0;
+            uint64_t worst_ns = 0;
+            for (size_t i = 1; i <= count; i++)
+            {
+                uint64_t start = rg_bench_now_ns();
+                rg_hash_map_set(map, (rg_storage_id) i, (rg_hash_map_value_t) {.as_num = i});
+                uint64_t duration = rg_bench_now_ns() - start;
+
+                total_ns += duration;
+                if (duration > worst_ns)
+                {
+                    worst_ns = duration;
+                }
+            }
+
+            // Lookups are slower while a migration is in progress, since both arrays may be checked
+            uint64_t sum   = 0;
+            uint64_t start = rg_bench_now_ns();
+            for (size_t i = 1; i <= count; i++)
+            {
+                sum += rg_hash_map_get(map, (rg_storage_id) i).value.as_num;
+            }
+            double lookup_ns = rg_bench_ns_per_op(start, count);
+            rg_bench_sink    = sum;
+
+            printf("%-20s %10zu %12.2f %14llu %14.2f\n",
+                   configs[c].name,
+                   count,
+                   (double) total_ns / (double) count,
+                   (unsigned long long) worst_ns,
+                   lookup_ns);
+
+            EXPECT_TRUE(rg_hash_map_count(map) == count);
+            rg_destroy_hash_map(&map);
+        }
+    }
+}
+
+TEST(HashMapBench_GetMany)
+{
+    // Resolve random ids one by one or in a batch, like the renderer does with the ids of the models
+    printf("\n%-10s %10s %12s %12s\n", "container", "keys", "get ns", "get_many ns");
+
+    rg_storage_id *ids    = malloc(RG_BENCH_MAX_COUNT * sizeof(rg_storage_id));
+    void          *values[256];
+    ASSERT_NOT_NULL(ids);
+
+    uint64_t state = 0x1234567;
+    for (size_t count = 1000; count <= RG_BENCH_MAX_COUNT; count *= 10)
+    {
+        rg_storage *storage = rg_create_storage(64);
+        ASSERT_NOT_NULL(storage);
+        char data[64] = {0};
+        for (size_t i = 0; i < count; i++)
+        {
+            rg_storage_push(storage, data);
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            ids[i] = (rg_storage_id) (rg_bench_random(&state) % count + 1);
+        }
+
+        // Read the values, otherwise the prefetch of get_many is useless
+        uint64_t sum   = 0;
+        uint64_t start = rg_bench_now_ns();
+        for (size_t i = 0; i < count; i++)
+        {
+            sum += *(char *) rg_storage_get(storage, ids[i]);
+        }
+        double get_ns = rg_bench_ns_per_op(start, count);
+
+        // Use the values by chunks, so that they are still in the cache when they are read
+        start = rg_bench_now_ns();
+        for (size_t offset = 0; offset < count; offset += 256)
+        {
+            size_t chunk_size = count - offset < 256 ? count - offset : 256;
+            rg_storage_get_many(storage, ids + offset, chunk_size, values);
+            for (size_t i = 0; i < chunk_size; i++)
+            {
+                sum += *(char *) values[i];
+            }
+        }
+        double get_many_ns = rg_bench_ns_per_op(start, count);
+        rg_bench_sink      = sum;
+
+        printf("%-10s %10zu %12.2f %12.2f\n", "storage", count, get_ns, get_many_ns);
+        rg_destroy_storage(&storage);
+    }
+
+    free(ids);
+}
+
+TEST(HashMapBench_SparseIteration)
+{
+    // Iterate maps that are mostly empty, like a map that grew during a loading and lost most of its entries.
+    // The reference is a scan that loads every slot to check if it is empty.
+    printf("\n%-8s %6s %10s %12s %12s\n", "layout", "load", "keys", "scan ns", "iterate ns");
+
+    // Power of two, so that the maps get the same number of slots as the scanned array
+    size_t slot_count = 1;
+    while (slot_count * 2 <= RG_BENCH_MAX_COUNT)
+    {
+        slot_count *= 2;
+    }
+    const float  loads[3]   = {0.1f, 0.5f, 0.85f};
+
+    typedef struct
+    {
+        uint64_t key;
+        uint64_t value;
+    } slot;
+    slot *slots = malloc(slot_count * sizeof(slot));
+    ASSERT_NOT_NULL(slots);
+
+    const rg_hash_map_layout layouts[2] = {RG_HASH_MAP_LAYOUT_LINEAR, RG_HASH_MAP_LAYOUT_GROUPED};
+    for (uint32_t l = 0; l < 2; l++)
+    {
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            size_t count = (size_t) ((float) slot_count * loads[i]);
+
+            // The initial capacity gives slot_count slots and prevents the map from shrinking at low load
+            rg_hash_map_create_info info = {.layout = layouts[l], .initial_capacity = slot_count * 4 / 5};
+            rg_hash_map            *map  = rg_create_hash_map_with_info(&info);
+            ASSERT_NOT_NULL(map);
+
+            uint64_t state = 0x1234567;
+            memset(slots, 0, slot_count * sizeof(slot));
+            for (size_t k = 0; k < count; k++)
+            {
+                uint64_t key = rg_bench_random(&state) | 1;
+                rg_hash_map_set(map, key, (rg_hash_map_value_t) {.as_num = k});
+                slots[key % slot_count] = (slot) {.key = key, .value = k};
+            }
+
+            uint64_t sum   = 0;
+            uint64_t start = rg_bench_now_ns();
+            for (size_t s = 0; s < slot_count; s++)
+            {
+                if (slots[s].key != RG_HASH_MAP_NULL_KEY)
+                {
+                    sum += slots[s].value;
+                }
+            }
+            double scan_ns = rg_bench_ns_per_op(start, count);
+
+            start             = rg_bench_now_ns();
+            rg_hash_map_it it = rg_hash_map_iterator(map);
+            while (rg_hash_map_next(&it))
+            {
+                sum += it.value.as_num;
+            }
+            double iterate_ns = rg_bench_ns_per_op(start, count);
+            rg_bench_sink     = sum;
+
+            printf("%-8s %6.2f %10zu %12.2f %12.2f\n",
+                   layouts[l] == RG_HASH_MAP_LAYOUT_LINEAR ? "linear" : "grouped",
+                   loads[i],
+                   count,
+                   scan_ns,
+                   iterate_ns);
+            rg_destroy_hash_map(&map);
+        }
+    }
+
+    free(slots);
+}
+
+TEST(HashMapBench_SmallMaps)
+{
+    // Create many short-lived maps with a handful of entries, like the per-swapchain maps of the renderer
+    printf("\n%-10s %8s %14s %12s\n", "storage", "entries", "lifetime ns", "lookup ns");
+
+    const size_t map_count = RG_BENCH_MAX_COUNT / 100;
+    for (uint32_t inline_entries = 0; inline_entries < 2; inline_entries++)
+    {
+        rg_hash_map_create_info info = {.disable_inline_entries = !inline_entries};
+        for (size_t entry_count = 1; entry_count <= 4; entry_count *= 2)
+        {
+            uint64_t sum   = 0;
+            uint64_t start = rg_bench_now_ns();
+            for (size_t m = 0; m < map_count; m++)
+            {
+                rg_hash_map *map = rg_create_hash_map_with_info(&info);
+                ASSERT_NOT_NULL(map);
+                for (size_t i = 1; i <= entry_count; i++)
+                {
+                    rg_hash_map_set(map, i * 0x9E3779B9, (rg_hash_map_value_t) {.as_num = i});
+                }
+                for (size_t i = 1; i <= entry_count; i++)
+                {
+                    sum += rg_hash_map_get(map, i * 0x9E3779B9).value.as_num;
+                }
+                rg_destroy_hash_map(&map);
+            }
+            double lifetime_ns = rg_bench_ns_per_op(start, map_count);
+
+            // Lookups alone in a single map
+            rg_hash_map *map = rg_create_hash_map_with_info(&info);
+            ASSERT_NOT_NULL(map);
+            for (size_t i = 1; i <= entry_count; i++)
+            {
+                rg_hash_map_set(map, i * 0x9E3779B9, (rg_hash_map_value_t) {.as_num = i});
+            }
+            start = rg_bench_now_ns();
+            for (size_t m = 0; m < map_count; m++)
+            {
+                sum += rg_hash_map_get(map, (m % entry_count + 1) * 0x9E3779B9).value.as_num;
+            }
+            double lookup_ns = rg_bench_ns_per_op(start, map_count);
+            rg_bench_sink    = sum;
+            rg_destroy_hash_map(&map);
+
+            printf("%-10s %8zu %14.2f %12.2f\n", inline_entries ? "inline" : "arrays", entry_count, lifetime_ns, lookup_ns);
+        }
+    }
+}
+
+TEST(StructMapBench_ValueScan)
+{
+    // Scan the values of a struct map without looking at the keys, like the renderer does with the materials.
+    // The reference interleaves the keys with the values, which is how the struct maps used to store them.
+    typedef struct
+    {
+        float    color[3];
+        float    roughness;
+        uint32_t texture_count;
+        uint32_t flags[2];
+    } value;
+    // 28 bytes, not a multiple of 8, so that the aligned values are padded
+    const size_t value_size = sizeof(value);
+    _Static_assert(sizeof(value) == 28, "the value should not be a multiple of 8 bytes");
+    const size_t count      = RG_BENCH_MAX_COUNT / 10;
+
+    printf("\n%-12s %10s %12s\n", "layout", "values", "scan ns");
+
+    // Interleaved values and keys
+    size_t interleaved_stride = value_size + sizeof(rg_hash_map_key_t);
+    char  *interleaved        = calloc(count, interleaved_stride);
+    ASSERT_NOT_NULL(interleaved);
+    for (size_t i = 0; i < count; i++)
+    {
+        value v = {.roughness = (float) i};
+        memcpy(interleaved + i * interleaved_stride, &v, value_size);
+        memcpy(interleaved + i * interleaved_stride + value_size, &(rg_hash_map_key_t) {i + 1}, sizeof(rg_hash_map_key_t));
+    }
+    double   sum   = 0;
+    uint64_t start = rg_bench_now_ns();
+    for (size_t i = 0; i < count; i++)
+    {
+        float roughness;
+        memcpy(&roughness, interleaved + i * interleaved_stride + offsetof(value, roughness), sizeof(float));
+        sum += roughness;
+    }
+    printf("%-12s %10zu %12.2f\n", "interleaved", count, rg_bench_ns_per_op(start, count));
+    free(interleaved);
+
+    // Struct map, with packed and aligned values
+    for (size_t alignment = 0; alignment <= 8; alignment += 8)
+    {
+        rg_struct_map *map = rg_create_struct_map_aligned(value_size, alignment, NULL);
+        ASSERT_NOT_NULL(map);
+        rg_struct_map_reserve(map, count);
+        for (size_t i = 0; i < count; i++)
+        {
+            value v = {.roughness = (float) i};
+            rg_struct_map_set(map, i + 1, &v);
+        }
+
+        size_t      stride = 0;
+        const char *values = rg_struct_map_values(map, &stride);
+        start              = rg_bench_now_ns();
+        for (size_t i = 0; i < count; i++)
+        {
+            float roughness;
+            memcpy(&roughness, values + i * stride + offsetof(value, roughness), sizeof(float));
+            sum += roughness;
+        }
+        printf("%-12s %10zu %12.2f\n", alignment == 0 ? "packed" : "aligned 8", count, rg_bench_ns_per_op(start, count));
+
+        // The iterator also gives the keys
+        start               = rg_bench_now_ns();
+        rg_struct_map_it it = rg_struct_map_iterator(map);
+        while (rg_struct_map_next(&it))
+        {
+            float roughness;
+            memcpy(&roughness, (char *) it.value + offsetof(value, roughness), sizeof(float));
+            sum += roughness;
+        }
+        printf("%-12s %10zu %12.2f\n", alignment == 0 ? "packed it" : "aligned 8 it", count, rg_bench_ns_per_op(start, count));
+        rg_destroy_struct_map(&map);
+    }
+    rg_bench_sink = (uint64_t) sum;
+}
+
+TEST(StorageBench_Lookup)
+{
+    // Resolve random ids, like the renderer does with the materials and the render nodes
+    printf("\n%-10s %10s %12s %12s\n", "mode", "elements", "get ns", "iterate ns");
+
+    rg_storage_id *ids     = malloc(RG_BENCH_MAX_COUNT * sizeof(rg_storage_id));
+    rg_storage_id *lookups = malloc(RG_BENCH_MAX_COUNT * sizeof(rg_storage_id));
+    ASSERT_NOT_NULL(ids);
+    ASSERT_NOT_NULL(lookups);
+
+    const rg_storage_mode modes[2] = {RG_STORAGE_MODE_HASHED, RG_STORAGE_MODE_SLOT_MAP};
+    for (uint32_t m = 0; m < 2; m++)
+    {
+        for (size_t count = 1000; count <= RG_BENCH_MAX_COUNT; count *= 10)
+        {
+            rg_storage_create_info info    = {.element_size = 64, .mode = modes[m]};
+            rg_storage            *storage = rg_create_storage_with_info(&info);
+            ASSERT_NOT_NULL(storage);
+            char data[64] = {0};
+            for (size_t i = 0; i < count; i++)
+            {
+                ids[i] = rg_storage_push(storage, data);
+            }
+            uint64_t state = 0x1234567;
+            for (size_t i = 0; i < count; i++)
+            {
+                lookups[i] = ids[rg_bench_random(&state) % count];
+            }
+
+            uint64_t sum   = 0;
+            uint64_t start = rg_bench_now_ns();
+            for (size_t i = 0; i < count; i++)
+            {
+                sum += *(char *) rg_storage_get(storage, lookups[i]);
+            }
+            double get_ns = rg_bench_ns_per_op(start, count);
+
+            start            = rg_bench_now_ns();
+            rg_storage_it it = rg_storage_iterator(storage);
+            while (rg_storage_next(&it))
+            {
+                sum += *(char *) it.value;
+            }
+            double iterate_ns = rg_bench_ns_per_op(start, count);
+            rg_bench_sink     = sum;
+
+            const char *mode_name = modes[m] == RG_STORAGE_MODE_HASHED ? "hashed" : "slot map";
+            printf("%-10s %10zu %12.2f %12.2f\n", mode_name, count, get_ns, iterate_ns);
+            rg_destroy_storage(&storage);
+        }
+    }
+
+    free(ids);
+    free(lookups);
+}
+
+TEST(StorageBench_MassErase)
+{
+    // Despawn half of the elements in a random order, one by one or with a deferred commit
+    printf("\n%-10s %10s %12s %12s\n", "mode", "elements", "erase ns", "deferred ns");
+
+    rg_storage_id *ids      = malloc(RG_BENCH_MAX_COUNT * sizeof(rg_storage_id));
+    rg_storage_id *erasures = malloc(RG_BENCH_MAX_COUNT * sizeof(rg_storage_id));
+    ASSERT_NOT_NULL(ids);
+    ASSERT_NOT_NULL(erasures);
+
+    const rg_storage_mode modes[2] = {RG_STORAGE_MODE_HASHED, RG_STORAGE_MODE_SLOT_MAP};
+    for (uint32_t m = 0; m < 2; m++)
+    {
+        for (size_t count = 1000; count <= RG_BENCH_MAX_COUNT; count *= 10)
+        {
+            double results[2];
+            for (int deferred = 0; deferred < 2; deferred++)
+            {
+                rg_storage_create_info info    = {.element_size = 64, .mode = modes[m]};
+                rg_storage            *storage = rg_create_storage_with_info(&info);
+                ASSERT_NOT_NULL(storage);
+                char data[64] = {0};
+                for (size_t i = 0; i < count; i++)
+                {
+                    ids[i] = rg_storage_push(storage, data);
+                }
+
+                // Shuffle the ids and erase the first half
+                uint64_t state = 0x1234567;
+                for (size_t i = 0; i < count; i++)
+                {
+                    erasures[i] = ids[i];
+                }
+                for (size_t i = count - 1; i > 0; i--)
+                {
+                    size_t        j   = rg_bench_random(&state) % (i + 1);
+                    rg_storage_id tmp = erasures[i];
+                    erasures[i]       = erasures[j];
+                    erasures[j]       = tmp;
+                }
+
+                uint64_t start = rg_bench_now_ns();
+                for (size_t i = 0; i < count / 2; i++)
+                {
+                    if (deferred)
+                    {
+                        rg_storage_erase_deferred(storage, erasures[i]);
+                    }
+                    else
+                    {
+                        rg_storage_erase(storage, erasures[i]);
+                    }
+                }
+                rg_storage_commit_erases(storage);
+                results[deferred] = rg_bench_ns_per_op(start, count / 2);
+
+                rg_destroy_storage(&storage);
+            }
+
+            const char *mode_name = modes[m] == RG_STORAGE_MODE_HASHED ? "hashed" : "slot map";
+            printf("%-10s %10zu %12.2f %12.2f\n", mode_name, count, results[0], results[1]);
+        }
+    }
+
+    free(ids);
+    free(erasures);
+}
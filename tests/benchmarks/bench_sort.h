@@ -0,0 +1,117 @@
+#pragma once
+
+#include "../framework/test_framework.h"
+#include "bench_utils.h"
+#include <railguard/utils/sort.h>
+#include <railguard/utils/threads.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+static int rg_bench_sort_qsort_compare32(const void *a, const void *b)
+{
+    uint32_t x = ((const rg_sort_key32 *) a)->key;
+    uint32_t y = ((const rg_sort_key32 *) b)->key;
+    return (x > y) - (x < y);
+}
+
+static int rg_bench_sort_compare32(const void *a, const void *b, void *user_data)
+{
+    (void) user_data;
+    return rg_bench_sort_qsort_compare32(a, b);
+}
+
+static int rg_bench_sort_qsort_compare64(const void *a, const void *b)
+{
+    uint64_t x = ((const rg_sort_key64 *) a)->key;
+    uint64_t y = ((const rg_sort_key64 *) b)->key;
+    return (x > y) - (x < y);
+}
+
+static int rg_bench_sort_compare64(const void *a, const void *b, void *user_data)
+{
+    (void) user_data;
+    return rg_bench_sort_qsort_compare64(a, b);
+}
+
+/**
+ * Sorts the same random keys with qsort, the introsort, the radix sort and the parallel radix sort, and prints the time per key.
+ * @param key_size size of the keys, 4 or 8 bytes
+ */
+static void rg_bench_sort_run(size_t key_size, rg_thread_pool *pool)
+{
+    size_t element_size = key_size == 4 ? sizeof(rg_sort_key32) : sizeof(rg_sort_key64);
+    const char *name = key_size == 4 ? "32-bit" : "64-bit";
+    printf("\n%-6s %10s %12s %12s %12s %12s\n", name, "elements", "qsort ns", "intro ns", "radix ns", "parallel ns");
+
+    void     *source = malloc(RG_BENCH_MAX_COUNT * element_size);
+    rg_vector keys   = {0};
+    if (source == NULL || !rg_create_vector(RG_BENCH_MAX_COUNT, element_size, &keys))
+    {
+        free(source);
+        return;
+    }
+
+    uint64_t state = 0x1234567;
+    for (size_t i = 0; i < RG_BENCH_MAX_COUNT; i++)
+    {
+        uint64_t key = rg_bench_random(&state);
+        if (key_size == 4)
+        {
+            ((rg_sort_key32 *) source)[i] = (rg_sort_key32) {.key = (uint32_t) key, .index = (uint32_t) i};
+        }
+        else
+        {
+            ((rg_sort_key64 *) source)[i] = (rg_sort_key64) {.key = key, .index = i};
+        }
+    }
+
+    for (size_t count = 1000; count <= RG_BENCH_MAX_COUNT; count *= 10)
+    {
+        double results[4];
+        for (int algorithm = 0; algorithm < 4; algorithm++)
+        {
+            memcpy(keys.data, source, count * element_size);
+            keys.count = count;
+
+            uint64_t start = rg_bench_now_ns();
+            switch (algorithm)
+            {
+                case 0:
+                    qsort(keys.data,
+                          count,
+                          element_size,
+                          key_size == 4 ? rg_bench_sort_qsort_compare32 : rg_bench_sort_qsort_compare64);
+                    break;
+                case 1:
+                    rg_sort(keys.data, count, element_size, key_size == 4 ? rg_bench_sort_compare32 : rg_bench_sort_compare64, NULL);
+                    break;
+                case 2:
+                    rg_bench_sink = key_size == 4 ? rg_sort_keys32(&keys) : rg_sort_keys64(&keys);
+                    break;
+                default:
+                    rg_bench_sink = key_size == 4 ? rg_sort_keys32_parallel(&keys, pool) : rg_sort_keys64_parallel(&keys, pool);
+                    break;
+            }
+            results[algorithm] = rg_bench_ns_per_op(start, count);
+            rg_bench_sink      = *(uint32_t *) keys.data;
+        }
+        printf("%-6s %10zu %12.2f %12.2f %12.2f %12.2f\n", "", count, results[0], results[1], results[2], results[3]);
+    }
+
+    rg_destroy_vector(&keys);
+    free(source);
+}
+
+TEST(SortBench_Keys)
+{
+    // The parallel sort only splits the work above RG_SORT_PARALLEL_MIN_COUNT, so it matches the radix sort below that
+    rg_thread_pool *pool = rg_create_thread_pool(0);
+    ASSERT_NOT_NULL(pool);
+    printf("\n%zu threads\n", rg_thread_pool_thread_count(pool));
+
+    rg_bench_sort_run(4, pool);
+    rg_bench_sort_run(8, pool);
+
+    rg_destroy_thread_pool(&pool);
+}
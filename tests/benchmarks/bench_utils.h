@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// --=== Settings ===--
+
+// Biggest number of elements used by the benchmarks. Can be lowered at compile time to get faster runs.
+#ifndef RG_BENCH_MAX_COUNT
+#define RG_BENCH_MAX_COUNT 10000000
+#endif
+
+// --=== Utils ===--
+
+/** Values written here are considered used by the compiler, so the measured code is not optimized away. */
+static volatile uint64_t rg_bench_sink;
+
+/** @return a monotonic-enough timestamp in nanoseconds. */
+static inline uint64_t rg_bench_now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+/** @return the number of nanoseconds per operation since the start timestamp. */
+static inline double rg_bench_ns_per_op(uint64_t start, size_t op_count)
+{
+    return (double) (rg_bench_now_ns() - start) / (double) (op_count > 0 ? op_count : 1);
+}
+
+/** Small xorshift64* generator, so that the benchmarks are reproducible on every platform. */
+static inline uint64_t rg_bench_random(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/** Shuffles an array of 64-bit values in place (Fisher-Yates). */
+static inline void rg_bench_shuffle(uint64_t *values, size_t count, uint64_t *state)
+{
+    for (size_t i = count; i > 1; i--)
+    {
+        size_t   j  = (size_t) (rg_bench_random(state) % i);
+        uint64_t tmp  = values[i - 1];
+        values[i - 1] = values[j];
+        values[j]     = tmp;
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "../framework/test_framework.h"
+#include "bench_utils.h"
+#include <railguard/utils/arrays.h>
+
+TEST(VectorBench_Growth)
+{
+    // Fill a vector one element at a time, then by chunks, with several growth factors
+    // A factor of 0 reserves the final count beforehand, which gives the cost without any growth
+    printf("\n%-8s %10s %12s %10s %12s %10s\n", "factor", "elements", "push ns", "reallocs", "extend ns", "reallocs");
+
+#define RG_BENCH_VECTOR_CHUNK 16
+    uint64_t chunk[RG_BENCH_VECTOR_CHUNK] = {0};
+    const float factors[] = {0.0f, RG_VECTOR_MIN_GROWTH_FACTOR, 1.5f, 2.0f, RG_VECTOR_MAX_GROWTH_FACTOR};
+    for (size_t f = 0; f < sizeof(factors) / sizeof(factors[0]); f++)
+    {
+        for (size_t count = 1000; count <= RG_BENCH_MAX_COUNT; count *= 10)
+        {
+            double push_ns;
+            size_t push_reallocs;
+            {
+                rg_vector vector = {0};
+                ASSERT_TRUE(rg_create_vector(1, sizeof(uint64_t), &vector));
+                if (factors[f] == 0.0f)
+                {
+                    ASSERT_TRUE(rg_vector_reserve(&vector, count));
+                }
+                else
+                {
+                    rg_vector_set_growth_factor(&vector, factors[f]);
+                }
+                size_t   reallocs_before = vector.realloc_count;
+                uint64_t start           = rg_bench_now_ns();
+                for (uint64_t i = 0; i < count; i++)
+                {
+                    rg_vector_push_back(&vector, &i);
+                }
+                push_ns       = rg_bench_ns_per_op(start, count);
+                push_reallocs = vector.realloc_count - reallocs_before;
+                rg_bench_sink = ((uint64_t *) vector.data)[count - 1];
+                rg_destroy_vector(&vector);
+            }
+
+            double extend_ns;
+            size_t extend_reallocs;
+            {
+                rg_vector vector = {0};
+                ASSERT_TRUE(rg_create_vector(1, sizeof(uint64_t), &vector));
+                if (factors[f] == 0.0f)
+                {
+                    ASSERT_TRUE(rg_vector_reserve(&vector, count));
+                }
+                else
+                {
+                    rg_vector_set_growth_factor(&vector, factors[f]);
+                }
+                size_t   reallocs_before = vector.realloc_count;
+                uint64_t start           = rg_bench_now_ns();
+                for (size_t i = 0; i < count; i += RG_BENCH_VECTOR_CHUNK)
+                {
+                    // The last chunk is cut so that the vector ends with count elements, like the reserved capacity
+                    rg_vector_extend(&vector, chunk, count - i < RG_BENCH_VECTOR_CHUNK ? count - i : RG_BENCH_VECTOR_CHUNK);
+                }
+                EXPECT_TRUE(vector.count == count);
+                extend_ns       = rg_bench_ns_per_op(start, count);
+                extend_reallocs = vector.realloc_count - reallocs_before;
+                rg_destroy_vector(&vector);
+            }
+
+            char name[16];
+            snprintf(name, sizeof(name), factors[f] == 0.0f ? "reserve" : "%.3g", factors[f]);
+            printf("%-8s %10zu %12.2f %10zu %12.2f %10zu\n", name, count, push_ns, push_reallocs, extend_ns, extend_reallocs);
+        }
+    }
+#undef RG_BENCH_VECTOR_CHUNK
+}
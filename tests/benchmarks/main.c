@@ -0,0 +1,21 @@
+#include "../framework/test_framework.h"
+
+// Import the benchmark files
+// The editor says that they are unused, but they are actually used by the RUN_ALL_TESTS macro
+#include "bench_hash_map.h"
+#include "bench_sort.h"
+#include "bench_vector.h"
+
+// Entry point for the benchmarks
+// They use the test framework so that a single benchmark can be run by giving its name as argument
+int main(int argc, char **argv)
+{
+    // If there is a benchmark name in the arguments, run only that benchmark
+    if (argc > 1)
+    {
+        return RUN_TEST(argv[1]);
+    }
+
+    // Run all the benchmarks
+    return RUN_ALL_TESTS();
+}
@@ -10,6 +10,9 @@
 #include "utils/test_storage.h"
 #include "utils/test_event_sender.h"
 #include "utils/test_string.h"
+#include "utils/test_threads.h"
+#include "utils/test_column_store.h"
+#include "utils/test_sort.h"
 #include "core/window.h"
 #include "core/renderer.h"
 
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Allocator that counts the live blocks, to check that a container only uses the allocator it was given
+// When fail is set, the allocations return NULL, to check how a container recovers from them
+typedef struct rg_test_counting_allocator
+{
+    size_t live_count;
+    size_t total_count;
+    bool   fail;
+} rg_test_counting_allocator;
+
+void *rg_test_counting_alloc(void *context, size_t size)
+{
+    rg_test_counting_allocator *counter = context;
+    if (counter->fail)
+    {
+        return NULL;
+    }
+    counter->live_count++;
+    counter->total_count++;
+    return malloc(size);
+}
+
+void *rg_test_counting_realloc(void *context, void *ptr, size_t old_size, size_t new_size)
+{
+    rg_test_counting_allocator *counter = context;
+    (void) old_size;
+    if (counter->fail)
+    {
+        return NULL;
+    }
+    counter->total_count++;
+    return realloc(ptr, new_size);
+}
+
+void rg_test_counting_free(void *context, void *ptr)
+{
+    rg_test_counting_allocator *counter = context;
+    counter->live_count--;
+    free(ptr);
+}
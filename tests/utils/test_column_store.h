@@ -0,0 +1,109 @@
+#pragma once
+
+#include "../framework/test_framework.h"
+#include <railguard/utils/column_store.h>
+
+typedef struct rg_test_column_store_bounds
+{
+    float center[3];
+    float radius;
+} rg_test_column_store_bounds;
+
+enum
+{
+    RG_TEST_COLUMN_STORE_INDEX  = 0,
+    RG_TEST_COLUMN_STORE_BOUNDS = 1,
+    RG_TEST_COLUMN_STORE_FLAGS  = 2,
+    RG_TEST_COLUMN_STORE_COLUMN_COUNT,
+};
+
+TEST(ColumnStore)
+{
+    size_t column_sizes[RG_TEST_COLUMN_STORE_COLUMN_COUNT] = {
+        sizeof(uint64_t),
+        sizeof(rg_test_column_store_bounds),
+        sizeof(uint8_t),
+    };
+    rg_column_store *store = rg_create_column_store(RG_TEST_COLUMN_STORE_COLUMN_COUNT, column_sizes);
+    ASSERT_NOT_NULL(store);
+    EXPECT_TRUE(rg_column_store_column_count(store) == RG_TEST_COLUMN_STORE_COLUMN_COUNT);
+    EXPECT_TRUE(rg_column_store_reserve(store, 100));
+
+    // Push rows, the flags are left to zero
+    rg_column_store_id ids[100];
+    for (uint64_t i = 0; i < 100; i++)
+    {
+        rg_test_column_store_bounds bounds = {.center = {(float) i, 0.0f, 0.0f}, .radius = (float) i};
+        const void                 *row[3] = {&i, &bounds, NULL};
+        ids[i]                             = rg_column_store_push(store, row);
+        EXPECT_TRUE(ids[i] != RG_COLUMN_STORE_NULL_ID);
+    }
+    EXPECT_TRUE(rg_column_store_count(store) == 100);
+
+    // Erase the even rows: the other ones must stay in sync in every column
+    for (uint64_t i = 0; i < 100; i += 2)
+    {
+        rg_column_store_erase(store, ids[i]);
+    }
+    rg_column_store_erase(store, ids[0]);
+    EXPECT_TRUE(rg_column_store_count(store) == 50);
+    for (uint64_t i = 0; i < 100; i++)
+    {
+        uint64_t                    *index  = rg_column_store_get(store, ids[i], RG_TEST_COLUMN_STORE_INDEX);
+        rg_test_column_store_bounds *bounds = rg_column_store_get(store, ids[i], RG_TEST_COLUMN_STORE_BOUNDS);
+        uint8_t                     *flags  = rg_column_store_get(store, ids[i], RG_TEST_COLUMN_STORE_FLAGS);
+        if (i % 2 == 0)
+        {
+            EXPECT_FALSE(rg_column_store_exists(store, ids[i]));
+            EXPECT_TRUE(rg_column_store_row(store, ids[i]) == SIZE_MAX);
+            EXPECT_NULL(index);
+        }
+        else
+        {
+            ASSERT_NOT_NULL(index);
+            ASSERT_NOT_NULL(bounds);
+            ASSERT_NOT_NULL(flags);
+            EXPECT_TRUE(*index == i);
+            EXPECT_TRUE(bounds->radius == (float) i);
+            EXPECT_TRUE(*flags == 0);
+        }
+    }
+    EXPECT_NULL(rg_column_store_get(store, ids[1], RG_TEST_COLUMN_STORE_COLUMN_COUNT));
+
+    // The packed columns follow the ids
+    const rg_column_store_id    *row_ids     = rg_column_store_ids(store);
+    rg_test_column_store_bounds *bounds_data = rg_column_store_column(store, RG_TEST_COLUMN_STORE_BOUNDS);
+    for (size_t row = 0; row < rg_column_store_count(store); row++)
+    {
+        EXPECT_TRUE(rg_column_store_row(store, row_ids[row]) == row);
+        EXPECT_TRUE(rg_column_store_get(store, row_ids[row], RG_TEST_COLUMN_STORE_BOUNDS) == &bounds_data[row]);
+    }
+
+    // Iterate on a single column
+    uint64_t           sum            = 0;
+    size_t             iterated_count = 0;
+    rg_column_store_it it             = rg_column_store_iterator(store, RG_TEST_COLUMN_STORE_INDEX);
+    while (rg_column_store_next(&it))
+    {
+        EXPECT_TRUE(rg_column_store_get(store, it.id, RG_TEST_COLUMN_STORE_INDEX) == it.value);
+        sum += *(uint64_t *) it.value;
+        iterated_count++;
+    }
+    EXPECT_TRUE(iterated_count == 50);
+    EXPECT_TRUE(sum == 2500);
+
+    // The freed slots are reused with a new generation
+    uint64_t           new_index = 1000;
+    const void        *row[3]    = {&new_index, NULL, NULL};
+    rg_column_store_id new_id    = rg_column_store_push(store, row);
+    EXPECT_TRUE(new_id != RG_COLUMN_STORE_NULL_ID);
+    for (uint64_t i = 0; i < 100; i += 2)
+    {
+        EXPECT_TRUE(new_id != ids[i]);
+    }
+    EXPECT_TRUE(*(uint64_t *) rg_column_store_get(store, new_id, RG_TEST_COLUMN_STORE_INDEX) == 1000);
+    EXPECT_TRUE(((rg_test_column_store_bounds *) rg_column_store_get(store, new_id, RG_TEST_COLUMN_STORE_BOUNDS))->radius == 0.0f);
+
+    rg_destroy_column_store(&store);
+    EXPECT_NULL(store);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../framework/test_framework.h"
+#include "test_allocator.h"
 #include "test_struct_map.h"
 #include <railguard/utils/maps.h>
 
@@ -118,6 +119,131 @@ TEST(HashFunction)
         uint64_t hash2 = rg_hash_map_hash(keys[i]);
         EXPECT_TRUE(hash1 == hash2);
     }
+
+    // Sequential keys should be spread uniformly: changing the lowest bit of the key should change about half of the bits of the hash
+    for (uint64_t key = 1; key < 1000; key++)
+    {
+        uint64_t diff      = rg_hash_map_hash(key) ^ rg_hash_map_hash(key + 1);
+        int      bit_count = 0;
+        for (; diff != 0; diff &= diff - 1)
+        {
+            bit_count++;
+        }
+        EXPECT_TRUE(bit_count > 12 && bit_count < 52);
+    }
+}
+
+// Hash function that puts every key in the same slot, to test the worst case
+uint64_t rg_test_hash_map_constant_hash(rg_hash_map_key_t key)
+{
+    (void) key;
+    return 42;
+}
+
+// Hash function that keeps sequential keys in sequential slots
+uint64_t rg_test_hash_map_identity_hash(rg_hash_map_key_t key)
+{
+    return key;
+}
+
+// Hash function that makes clusters of 8 keys, and counts how many times it is called
+static size_t rg_test_hash_map_hash_count = 0;
+
+uint64_t rg_test_hash_map_counting_hash(rg_hash_map_key_t key)
+{
+    rg_test_hash_map_hash_count++;
+    return key & ~7ULL;
+}
+
+TEST(HashMap_CustomHash)
+{
+    rg_hash_map_layout layouts[2] = {RG_HASH_MAP_LAYOUT_LINEAR, RG_HASH_MAP_LAYOUT_GROUPED};
+    for (uint32_t l = 0; l < 2; l++)
+    {
+        // Even if all the keys collide, the map should stay correct
+        rg_hash_map_create_info create_info = {
+            .layout   = layouts[l],
+            .pfn_hash = rg_test_hash_map_constant_hash,
+        };
+        rg_hash_map *map = rg_create_hash_map_with_info(&create_info);
+        ASSERT_NOT_NULL(map);
+
+        for (uint64_t i = 1; i <= 200; i++)
+        {
+            EXPECT_TRUE(rg_hash_map_set(map, i, (rg_hash_map_value_t) {.as_num = i * 2}));
+        }
+        for (uint64_t i = 1; i <= 200; i += 3)
+        {
+            rg_hash_map_erase(map, i);
+        }
+        for (uint64_t i = 1; i <= 200; i++)
+        {
+            rg_hash_map_get_result result = rg_hash_map_get(map, i);
+            EXPECT_TRUE(result.exists == ((i - 1) % 3 != 0));
+            if (result.exists)
+            {
+                EXPECT_TRUE(result.value.as_num == i * 2);
+            }
+        }
+
+        // Every key is stored after the previous ones, so the probe lengths are as bad as possible
+        rg_hash_map_stats stats = rg_hash_map_get_stats(map);
+        EXPECT_TRUE(stats.count == rg_hash_map_count(map));
+        EXPECT_TRUE(stats.max_probe_length > 0);
+
+        rg_destroy_hash_map(&map);
+        EXPECT_NULL(map);
+    }
+
+    // With the identity, sequential keys are all in their ideal slot
+    rg_hash_map_create_info create_info = {
+        .pfn_hash = rg_test_hash_map_identity_hash,
+    };
+    rg_hash_map *map = rg_create_hash_map_with_info(&create_info);
+    ASSERT_NOT_NULL(map);
+    for (uint64_t i = 1; i <= 500; i++)
+    {
+        EXPECT_TRUE(rg_hash_map_set(map, i, (rg_hash_map_value_t) {.as_num = i}));
+    }
+    rg_hash_map_stats stats = rg_hash_map_get_stats(map);
+    EXPECT_TRUE(stats.count == 500);
+    EXPECT_TRUE(stats.max_probe_length == 0);
+    EXPECT_TRUE(stats.probe_length_histogram[0] == 500);
+    rg_destroy_hash_map(&map);
+
+    // With the default hash, the probe lengths of sequential keys should stay short
+    map = rg_create_hash_map();
+    ASSERT_NOT_NULL(map);
+    for (uint64_t i = 1; i <= 10000; i++)
+    {
+        EXPECT_TRUE(rg_hash_map_set(map, i, (rg_hash_map_value_t) {.as_num = i}));
+    }
+    stats = rg_hash_map_get_stats(map);
+    EXPECT_TRUE(stats.count == 10000);
+    EXPECT_TRUE(stats.mean_probe_length < 2.0);
+    rg_destroy_hash_map(&map);
+
+    // The keys that are already in the map are not hashed again when the clusters are reordered by an insertion or an erasure
+    create_info = (rg_hash_map_create_info) {
+        .pfn_hash         = rg_test_hash_map_counting_hash,
+        .initial_capacity = 1000,
+    };
+    map = rg_create_hash_map_with_info(&create_info);
+    ASSERT_NOT_NULL(map);
+    rg_test_hash_map_hash_count = 0;
+    for (uint64_t i = 1; i <= 800; i++)
+    {
+        EXPECT_TRUE(rg_hash_map_set(map, i * 7919 % 1000 + 1, (rg_hash_map_value_t) {.as_num = i}));
+    }
+    EXPECT_TRUE(rg_test_hash_map_hash_count <= 2 * 800);
+    rg_test_hash_map_hash_count = 0;
+    for (uint64_t i = 1; i <= 800; i++)
+    {
+        rg_hash_map_erase(map, i * 7919 % 1000 + 1);
+    }
+    EXPECT_TRUE(rg_hash_map_count(map) == 0);
+    EXPECT_TRUE(rg_test_hash_map_hash_count <= 800);
+    rg_destroy_hash_map(&map);
 }
 
 TEST(HashMap_Stress)
@@ -189,7 +315,11 @@ TEST(HashMap_Erase)
     // Thus, the deletion was skipped, but the value still existed in the map, taking memory
 
     // Create a hash map
-    rg_hash_map *map = rg_create_hash_map();
+    // The keys must be in the arrays, otherwise they would be inline and never hashed
+    rg_hash_map_create_info create_info = {
+        .disable_inline_entries = true,
+    };
+    rg_hash_map *map = rg_create_hash_map_with_info(&create_info);
     ASSERT_NOT_NULL(map);
     EXPECT_TRUE(map->capacity == 1);
     EXPECT_TRUE(map->count == 0);
@@ -228,12 +358,13 @@ TEST(HashMap_Erase)
     }
 
     // Add the third one
+    // The map can be filled up to 85%, so it is not expanded this time
     success = rg_hash_map_set(map, keys[2], (rg_hash_map_value_t) {.as_num = 2});
     EXPECT_TRUE(success);
-    EXPECT_TRUE(map->capacity == 8);
+    EXPECT_TRUE(map->capacity == 4);
     EXPECT_TRUE(map->count == 3);
 
-    // It was expanded again, all three should be in the map
+    // All three should be in the map
     for (uint64_t i = 0; i < 3; i++)
     {
         result = rg_hash_map_get(map, keys[i]);
@@ -247,7 +378,7 @@ TEST(HashMap_Erase)
     EXPECT_TRUE(map->capacity == 8);
     EXPECT_TRUE(map->count == 4);
 
-    // It was not expanded again, but for completion's sake , all four should be in the map
+    // It was expanded again, all four should be in the map
     for (uint64_t i = 0; i < 4; i++)
     {
         result = rg_hash_map_get(map, keys[i]);
@@ -260,11 +391,7 @@ TEST(HashMap_Erase)
     // If a hole is created in the map array, some values can become inaccessible
     // The erase function should remove the values in such a way that everything stays accessible
 
-    // Currently, the array should look like this:
-    // [key4, key2, key3, NULL, NULL, NULL, NULL, key1]
-
-    // key1, key2 and key3 are at the right place (index returned by hash)
-    // key4 wants to be in the index 7, but there's already key1 there
+    // With a capacity of 8, key1 and key4 both want to be in the index 7, so one of them is displaced to the index 0
 
     // The bug was:
     // -> When key1 is removed, key4 becomes inaccessible (it should be moved to index 7)
@@ -296,4 +423,711 @@ TEST(HashMap_Erase)
     // Clean up
     rg_destroy_hash_map(&map);
     EXPECT_NULL(map);
-}
\ No newline at end of file
+}
+TEST(HashMap_Grouped)
+{
+    rg_hash_map_create_info create_info = {
+        .layout = RG_HASH_MAP_LAYOUT_GROUPED,
+    };
+    rg_hash_map *map = rg_create_hash_map_with_info(&create_info);
+    ASSERT_NOT_NULL(map);
+    EXPECT_TRUE(map->layout == RG_HASH_MAP_LAYOUT_GROUPED);
+    EXPECT_TRUE(rg_hash_map_count(map) == 0);
+
+    // The 0 key should not be allowed
+    EXPECT_FALSE(rg_hash_map_set(map, RG_HASH_MAP_NULL_KEY, (rg_hash_map_value_t) {.as_num = 1}));
+    EXPECT_FALSE(rg_hash_map_get(map, RG_HASH_MAP_NULL_KEY).exists);
+
+    // Add enough values to expand the map several times
+    for (uint64_t i = 1; i < 10000; i++)
+    {
+        EXPECT_TRUE(rg_hash_map_set(map, i * 7919, (rg_hash_map_value_t) {.as_num = i}));
+        EXPECT_TRUE(rg_hash_map_count(map) == i);
+    }
+    for (uint64_t i = 1; i < 10000; i++)
+    {
+        rg_hash_map_get_result result = rg_hash_map_get(map, i * 7919);
+        EXPECT_TRUE(result.exists);
+        EXPECT_TRUE(result.value.as_num == i);
+    }
+    EXPECT_FALSE(rg_hash_map_get(map, 5).exists);
+    EXPECT_FALSE(rg_hash_map_get(map, UINT64_MAX).exists);
+
+    // Edit an existing key: the count should not change
+    EXPECT_TRUE(rg_hash_map_set(map, 7919, (rg_hash_map_value_t) {.as_num = 42}));
+    EXPECT_TRUE(rg_hash_map_get(map, 7919).value.as_num == 42);
+    EXPECT_TRUE(rg_hash_map_count(map) == 9999);
+
+    // Erase half of the values
+    for (uint64_t i = 1; i < 10000; i += 2)
+    {
+        rg_hash_map_erase(map, i * 7919);
+        EXPECT_FALSE(rg_hash_map_get(map, i * 7919).exists);
+    }
+    EXPECT_TRUE(rg_hash_map_count(map) == 4999);
+
+    // Erasing a missing key should not do anything
+    rg_hash_map_erase(map, 7919);
+    rg_hash_map_erase(map, 123456789);
+    EXPECT_TRUE(rg_hash_map_count(map) == 4999);
+
+    // The other ones should still be there, even if they were inserted after a removed one
+    for (uint64_t i = 2; i < 10000; i += 2)
+    {
+        rg_hash_map_get_result result = rg_hash_map_get(map, i * 7919);
+        EXPECT_TRUE(result.exists);
+        EXPECT_TRUE(result.value.as_num == i);
+    }
+
+    // Erase and insert repeatedly: tombstones must be reused or cleaned, and the capacity must stay bounded
+    size_t capacity = map->capacity;
+    for (uint64_t round = 0; round < 20; round++)
+    {
+        for (uint64_t i = 1; i < 10000; i += 2)
+        {
+            EXPECT_TRUE(rg_hash_map_set(map, i * 7919 + round + 1, (rg_hash_map_value_t) {.as_num = i}));
+        }
+        for (uint64_t i = 1; i < 10000; i += 2)
+        {
+            rg_hash_map_erase(map, i * 7919 + round + 1);
+        }
+    }
+    EXPECT_TRUE(rg_hash_map_count(map) == 4999);
+    EXPECT_TRUE(map->capacity <= capacity * 2);
+
+    // Iterator: every remaining key should be found exactly once
+    size_t         iterated_count = 0;
+    rg_hash_map_it it             = rg_hash_map_iterator(map);
+    while (rg_hash_map_next(&it))
+    {
+        EXPECT_TRUE(it.key % 7919 == 0);
+        EXPECT_TRUE(it.value.as_num == it.key / 7919);
+        EXPECT_TRUE(it.value.as_num % 2 == 0);
+        iterated_count++;
+    }
+    EXPECT_TRUE(iterated_count == 4999);
+    EXPECT_TRUE(it.key == RG_HASH_MAP_NULL_KEY);
+
+    // Clear
+    rg_hash_map_clear(map);
+    EXPECT_TRUE(rg_hash_map_count(map) == 0);
+    EXPECT_FALSE(rg_hash_map_get(map, 2 * 7919).exists);
+    it = rg_hash_map_iterator(map);
+    EXPECT_FALSE(rg_hash_map_next(&it));
+
+    // It should still be usable after a clear
+    EXPECT_TRUE(rg_hash_map_set(map, 2 * 7919, (rg_hash_map_value_t) {.as_num = 2}));
+    EXPECT_TRUE(rg_hash_map_get(map, 2 * 7919).value.as_num == 2);
+
+    rg_destroy_hash_map(&map);
+    EXPECT_NULL(map);
+}
+
+TEST(HashMap_RobinHood)
+{
+    rg_hash_map *map = rg_create_hash_map();
+    ASSERT_NOT_NULL(map);
+
+    // The linear layout can be filled up to 85% before expanding
+    for (uint64_t i = 1; i <= 870; i++)
+    {
+        EXPECT_TRUE(rg_hash_map_set(map, i, (rg_hash_map_value_t) {.as_num = i}));
+    }
+    EXPECT_TRUE(map->capacity == 1024);
+    EXPECT_TRUE(rg_hash_map_set(map, 871, (rg_hash_map_value_t) {.as_num = 871}));
+    EXPECT_TRUE(map->capacity == 2048);
+    rg_destroy_hash_map(&map);
+
+    map = rg_create_hash_map();
+    ASSERT_NOT_NULL(map);
+
+    // Fill a small table near its maximum load, then erase and insert keys randomly while checking against a reference.
+    // Backward shift deletion must keep every remaining key reachable.
+#define ROBIN_HOOD_KEY_RANGE 110
+    bool     reference[ROBIN_HOOD_KEY_RANGE] = {0};
+    size_t   reference_count                 = 0;
+    uint64_t state                           = 0xC0FFEE;
+    for (uint32_t step = 0; step < 20000; step++)
+    {
+        // Simple LCG to pick the key
+        state        = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        uint64_t key = (state >> 33) % ROBIN_HOOD_KEY_RANGE;
+
+        if (reference[key])
+        {
+            rg_hash_map_erase(map, key + 1);
+            reference[key] = false;
+            reference_count--;
+        }
+        else
+        {
+            EXPECT_TRUE(rg_hash_map_set(map, key + 1, (rg_hash_map_value_t) {.as_num = key}));
+            reference[key] = true;
+            reference_count++;
+        }
+
+        EXPECT_TRUE(rg_hash_map_count(map) == reference_count);
+
+        // Periodically check all keys
+        if (step % 97 == 0)
+        {
+            for (uint64_t k = 0; k < ROBIN_HOOD_KEY_RANGE; k++)
+            {
+                rg_hash_map_get_result result = rg_hash_map_get(map, k + 1);
+                EXPECT_TRUE(result.exists == reference[k]);
+                if (result.exists)
+                {
+                    EXPECT_TRUE(result.value.as_num == k);
+                }
+            }
+        }
+    }
+#undef ROBIN_HOOD_KEY_RANGE
+
+    // The stored probe distances are the ones given by the hashes
+    rg_hash_map_entry *entries = map->data;
+    for (size_t i = 0; i < map->capacity; i++)
+    {
+        if (entries[i].key != RG_HASH_MAP_NULL_KEY)
+        {
+            size_t ideal_index = (size_t) rg_hash_map_hash(entries[i].key) & (map->capacity - 1);
+            EXPECT_TRUE(map->control[i] == (int8_t) ((i - ideal_index) & (map->capacity - 1)));
+        }
+    }
+
+    // Since there are never more than 110 keys, the map never needs more than 256 slots
+    EXPECT_TRUE(map->capacity <= 256);
+
+    rg_destroy_hash_map(&map);
+    EXPECT_NULL(map);
+}
+
+TEST(HashMap_Reserve)
+{
+    rg_hash_map_layout layouts[2] = {RG_HASH_MAP_LAYOUT_LINEAR, RG_HASH_MAP_LAYOUT_GROUPED};
+    for (uint32_t l = 0; l < 2; l++)
+    {
+        // With an initial capacity, the map should never need to rehash before it is reached
+        rg_hash_map_create_info create_info = {
+            .layout           = layouts[l],
+            .initial_capacity = 1000,
+        };
+        rg_hash_map *map = rg_create_hash_map_with_info(&create_info);
+        ASSERT_NOT_NULL(map);
+        size_t initial_capacity = map->capacity;
+        EXPECT_TRUE(initial_capacity >= 1000);
+
+        for (uint64_t i = 1; i <= 1000; i++)
+        {
+            EXPECT_TRUE(rg_hash_map_set(map, i, (rg_hash_map_value_t) {.as_num = i}));
+        }
+        EXPECT_TRUE(map->capacity == initial_capacity);
+
+        // Reserving more keeps the existing entries
+        EXPECT_TRUE(rg_hash_map_reserve(map, 5000));
+        size_t reserved_capacity = map->capacity;
+        EXPECT_TRUE(reserved_capacity > initial_capacity);
+        for (uint64_t i = 1001; i <= 5000; i++)
+        {
+            EXPECT_TRUE(rg_hash_map_set(map, i, (rg_hash_map_value_t) {.as_num = i}));
+        }
+        EXPECT_TRUE(map->capacity == reserved_capacity);
+        for (uint64_t i = 1; i <= 5000; i++)
+        {
+            rg_hash_map_get_result result = rg_hash_map_get(map, i);
+            EXPECT_TRUE(result.exists);
+            EXPECT_TRUE(result.value.as_num == i);
+        }
+
+        // Reserving less never shrinks the map
+        EXPECT_TRUE(rg_hash_map_reserve(map, 10));
+        EXPECT_TRUE(map->capacity == reserved_capacity);
+
+        rg_destroy_hash_map(&map);
+        EXPECT_NULL(map);
+    }
+
+    // The linear layout grows at 85% by default
+    rg_hash_map *map = rg_create_hash_map_with_capacity(870);
+    ASSERT_NOT_NULL(map);
+    EXPECT_TRUE(map->capacity == 1024);
+    rg_destroy_hash_map(&map);
+
+    // With a lower load factor, the same number of entries needs more slots
+    rg_hash_map_create_info create_info = {
+        .initial_capacity = 870,
+        .max_load_factor  = 0.5f,
+    };
+    map = rg_create_hash_map_with_info(&create_info);
+    ASSERT_NOT_NULL(map);
+    EXPECT_TRUE(map->capacity == 2048);
+    for (uint64_t i = 1; i <= 1024; i++)
+    {
+        EXPECT_TRUE(rg_hash_map_set(map, i, (rg_hash_map_value_t) {.as_num = i}));
+    }
+    EXPECT_TRUE(map->capacity == 2048);
+    EXPECT_TRUE(rg_hash_map_set(map, 1025, (rg_hash_map_value_t) {.as_num = 1025}));
+    EXPECT_TRUE(map->capacity == 4096);
+    rg_destroy_hash_map(&map);
+
+    // Out of range load factors are clamped, so that there is always an empty slot
+    create_info.max_load_factor = 2.0f;
+    map                         = rg_create_hash_map_with_info(&create_info);
+    ASSERT_NOT_NULL(map);
+    for (uint64_t i = 1; i <= 2000; i++)
+    {
+        EXPECT_TRUE(rg_hash_map_set(map, i, (rg_hash_map_value_t) {.as_num = i}));
+    }
+    EXPECT_TRUE(map->count < map->capacity);
+    EXPECT_FALSE(rg_hash_map_get(map, 3000).exists);
+    rg_destroy_hash_map(&map);
+    EXPECT_NULL(map);
+}
+
+TEST(HashMap_ReserveFailure)
+{
+    rg_test_counting_allocator counter   = {0};
+    rg_allocator               allocator = {
+        .pfn_alloc   = rg_test_counting_alloc,
+        .pfn_realloc = rg_test_counting_realloc,
+        .pfn_free    = rg_test_counting_free,
+        .context     = &counter,
+    };
+    rg_hash_map_create_info create_info = {.allocator = &allocator};
+    rg_hash_map            *map         = rg_create_hash_map_with_info(&create_info);
+    ASSERT_NOT_NULL(map);
+    for (uint64_t i = 1; i <= 2000; i++)
+    {
+        EXPECT_TRUE(rg_hash_map_set(map, i, (rg_hash_map_value_t) {.as_num = i}));
+    }
+    size_t peak_capacity = map->capacity;
+
+    // A reservation that can't be allocated leaves the map as it was
+    counter.fail = true;
+    EXPECT_FALSE(rg_hash_map_reserve(map, 100000));
+    counter.fail = false;
+    EXPECT_TRUE(map->capacity == peak_capacity);
+    EXPECT_TRUE(map->count == 2000);
+    for (uint64_t i = 1; i <= 2000; i++)
+    {
+        EXPECT_TRUE(rg_hash_map_get(map, i).value.as_num == i);
+    }
+
+    // Including the reserved capacity: the map can still shrink below what was asked
+    for (uint64_t i = 11; i <= 2000; i++)
+    {
+        rg_hash_map_erase(map, i);
+    }
+    EXPECT_TRUE(map->capacity < peak_capacity);
+
+    rg_destroy_hash_map(&map);
+    EXPECT_NULL(map);
+    EXPECT_TRUE(counter.live_count == 0);
+}
+
+TEST(HashMap_IncrementalResize)
+{
+    rg_hash_map_layout layouts[2] = {RG_HASH_MAP_LAYOUT_LINEAR, RG_HASH_MAP_LAYOUT_GROUPED};
+    for (uint32_t l = 0; l < 2; l++)
+    {
+        rg_hash_map_create_info create_info = {
+            .layout             = layouts[l],
+            .incremental_resize = true,
+        };
+        rg_hash_map *map = rg_create_hash_map_with_info(&create_info);
+        ASSERT_NOT_NULL(map);
+
+        // Insert more often than erase, so that the map grows several times while keys are erased during the migrations
+#define INCREMENTAL_KEY_RANGE 3000
+        bool     reference[INCREMENTAL_KEY_RANGE] = {0};
+        size_t   reference_count                  = 0;
+        bool     saw_migration                    = false;
+        uint64_t state                            = 0xBADC0DE;
+        for (uint32_t step = 0; step < 30000; step++)
+        {
+            state        = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            uint64_t key = (state >> 33) % INCREMENTAL_KEY_RANGE;
+
+            if (reference[key] && (state >> 20) % 3 == 0)
+            {
+                rg_hash_map_erase(map, key + 1);
+                reference[key] = false;
+                reference_count--;
+            }
+            else
+            {
+                EXPECT_TRUE(rg_hash_map_set(map, key + 1, (rg_hash_map_value_t) {.as_num = key}));
+                if (!reference[key])
+                {
+                    reference[key] = true;
+                    reference_count++;
+                }
+            }
+
+            EXPECT_TRUE(rg_hash_map_count(map) == reference_count);
+            saw_migration |= map->old_capacity > 0;
+
+            // Periodically check all keys, and the iterator, which must see the keys of both arrays exactly once
+            if (step % 211 == 0)
+            {
+                for (uint64_t k = 0; k < INCREMENTAL_KEY_RANGE; k++)
+                {
+                    rg_hash_map_get_result result = rg_hash_map_get(map, k + 1);
+                    EXPECT_TRUE(result.exists == reference[k]);
+                    if (result.exists)
+                    {
+                        EXPECT_TRUE(result.value.as_num == k);
+                    }
+                }
+
+                size_t         iterated_count = 0;
+                rg_hash_map_it it             = rg_hash_map_iterator(map);
+                while (rg_hash_map_next(&it))
+                {
+                    EXPECT_TRUE(reference[it.key - 1]);
+                    EXPECT_TRUE(it.value.as_num == it.key - 1);
+                    iterated_count++;
+                }
+                EXPECT_TRUE(iterated_count == reference_count);
+            }
+        }
+#undef INCREMENTAL_KEY_RANGE
+        EXPECT_TRUE(saw_migration);
+
+        // Clearing the map in the middle of a migration drops the old arrays
+        rg_hash_map_clear(map);
+        EXPECT_TRUE(rg_hash_map_count(map) == 0);
+        EXPECT_TRUE(map->old_capacity == 0);
+        EXPECT_FALSE(rg_hash_map_get(map, 1).exists);
+
+        rg_destroy_hash_map(&map);
+        EXPECT_NULL(map);
+    }
+}
+
+TEST(HashMap_GetMany)
+{
+    const rg_hash_map_create_info infos[3] = {
+        {.layout = RG_HASH_MAP_LAYOUT_LINEAR},
+        {.layout = RG_HASH_MAP_LAYOUT_GROUPED},
+        {.layout = RG_HASH_MAP_LAYOUT_LINEAR, .incremental_resize = true},
+    };
+    for (uint32_t c = 0; c < 3; c++)
+    {
+        rg_hash_map *map = rg_create_hash_map_with_info(&infos[c]);
+        ASSERT_NOT_NULL(map);
+
+        // Even keys exist, odd keys don't
+        for (uint64_t i = 2; i <= 2000; i += 2)
+        {
+            EXPECT_TRUE(rg_hash_map_set(map, i, (rg_hash_map_value_t) {.as_num = i * 3}));
+        }
+
+        // The null key must be handled, and the count is not a multiple of the prefetch distance
+        rg_hash_map_key_t      keys[1003];
+        rg_hash_map_get_result results[1003];
+        for (uint64_t i = 0; i < 1003; i++)
+        {
+            keys[i] = (i * 7919) % 2003;
+        }
+        rg_hash_map_get_many(map, keys, 1003, results);
+
+        for (uint64_t i = 0; i < 1003; i++)
+        {
+            bool should_exist = keys[i] != 0 && keys[i] % 2 == 0 && keys[i] <= 2000;
+            EXPECT_TRUE(results[i].exists == should_exist);
+            if (should_exist)
+            {
+                EXPECT_TRUE(results[i].value.as_num == keys[i] * 3);
+            }
+        }
+
+        // Less keys than the prefetch distance
+        rg_hash_map_get_many(map, keys, 3, results);
+        for (uint64_t i = 0; i < 3; i++)
+        {
+            EXPECT_TRUE(results[i].exists == rg_hash_map_get(map, keys[i]).exists);
+        }
+
+        rg_destroy_hash_map(&map);
+        EXPECT_NULL(map);
+    }
+}
+
+TEST(HashMap_Compact)
+{
+    const rg_hash_map_create_info infos[3] = {
+        {.layout = RG_HASH_MAP_LAYOUT_LINEAR, .compact = true},
+        {.layout = RG_HASH_MAP_LAYOUT_GROUPED, .compact = true},
+        {.layout = RG_HASH_MAP_LAYOUT_LINEAR, .compact = true, .incremental_resize = true},
+    };
+    for (uint32_t c = 0; c < 3; c++)
+    {
+        rg_hash_map *map = rg_create_hash_map_with_info(&infos[c]);
+        ASSERT_NOT_NULL(map);
+
+        // Keys and values that fit in 32 bits keep the map compact, including the biggest ones
+        for (uint64_t i = 1; i <= 1000; i++)
+        {
+            EXPECT_TRUE(rg_hash_map_set(map, i, (rg_hash_map_value_t) {.as_num = i + 5}));
+        }
+        EXPECT_TRUE(rg_hash_map_set(map, UINT32_MAX, (rg_hash_map_value_t) {.as_num = UINT32_MAX}));
+        for (uint64_t i = 1; i <= 1000; i += 2)
+        {
+            rg_hash_map_erase(map, i);
+        }
+        EXPECT_TRUE(map->compact);
+        EXPECT_TRUE(rg_hash_map_count(map) == 501);
+        EXPECT_TRUE(rg_hash_map_get(map, UINT32_MAX).value.as_num == UINT32_MAX);
+
+        // A bigger value converts the map, without losing any entry
+        EXPECT_TRUE(rg_hash_map_set(map, 2, (rg_hash_map_value_t) {.as_num = (size_t) UINT32_MAX + 1}));
+        EXPECT_FALSE(map->compact);
+        EXPECT_TRUE(rg_hash_map_get(map, 2).value.as_num == (size_t) UINT32_MAX + 1);
+
+        // Then bigger keys can be used too
+        EXPECT_TRUE(rg_hash_map_set(map, 0x123456789ULL, (rg_hash_map_value_t) {.as_num = 7}));
+        EXPECT_TRUE(rg_hash_map_get(map, 0x123456789ULL).value.as_num == 7);
+        EXPECT_FALSE(rg_hash_map_get(map, 0x23456789ULL).exists);
+        for (uint64_t i = 3; i <= 1000; i++)
+        {
+            rg_hash_map_get_result result = rg_hash_map_get(map, i);
+            EXPECT_TRUE(result.exists == (i % 2 == 0));
+            if (result.exists)
+            {
+                EXPECT_TRUE(result.value.as_num == i + 5);
+            }
+        }
+        EXPECT_TRUE(rg_hash_map_count(map) == 502);
+
+        rg_destroy_hash_map(&map);
+        EXPECT_NULL(map);
+    }
+
+    // A compact map whose first key is big is converted right away
+    rg_hash_map_create_info create_info = {.compact = true};
+    rg_hash_map            *map         = rg_create_hash_map_with_info(&create_info);
+    ASSERT_NOT_NULL(map);
+    EXPECT_TRUE(rg_hash_map_set(map, UINT64_MAX, (rg_hash_map_value_t) {.as_num = 1}));
+    EXPECT_FALSE(map->compact);
+    EXPECT_TRUE(rg_hash_map_get(map, UINT64_MAX).exists);
+    rg_destroy_hash_map(&map);
+    EXPECT_NULL(map);
+}
+
+TEST(HashMap_Shrink)
+{
+    const rg_hash_map_create_info infos[3] = {
+        {.layout = RG_HASH_MAP_LAYOUT_LINEAR},
+        {.layout = RG_HASH_MAP_LAYOUT_GROUPED},
+        {.layout = RG_HASH_MAP_LAYOUT_LINEAR, .incremental_resize = true},
+    };
+    for (uint32_t c = 0; c < 3; c++)
+    {
+        rg_hash_map *map = rg_create_hash_map_with_info(&infos[c]);
+        ASSERT_NOT_NULL(map);
+
+        // Fill the map, then erase almost everything, like when a level is unloaded
+        for (uint64_t i = 1; i <= 20000; i++)
+        {
+            EXPECT_TRUE(rg_hash_map_set(map, i, (rg_hash_map_value_t) {.as_num = i}));
+        }
+        size_t peak_capacity = map->capacity;
+        for (uint64_t i = 101; i <= 20000; i++)
+        {
+            rg_hash_map_erase(map, i);
+        }
+
+        // Let the migration finish if there is one
+        for (uint64_t i = 0; i < 100; i++)
+        {
+            rg_hash_map_erase(map, 30000);
+        }
+
+        // The map shrank automatically, and the iteration only visits a small array
+        EXPECT_TRUE(map->capacity <= 1024);
+        EXPECT_TRUE(map->capacity < peak_capacity / 16);
+        EXPECT_TRUE(map->old_capacity == 0);
+        size_t         iterated_count = 0;
+        rg_hash_map_it it             = rg_hash_map_iterator(map);
+        while (rg_hash_map_next(&it))
+        {
+            EXPECT_TRUE(it.key <= 100 && it.value.as_num == it.key);
+            iterated_count++;
+        }
+        EXPECT_TRUE(iterated_count == 100);
+
+        // Shrink to fit gives the smallest capacity
+        EXPECT_TRUE(rg_hash_map_shrink_to_fit(map));
+        EXPECT_TRUE(map->capacity == 128);
+        for (uint64_t i = 1; i <= 100; i++)
+        {
+            EXPECT_TRUE(rg_hash_map_get(map, i).value.as_num == i);
+        }
+
+        rg_destroy_hash_map(&map);
+        EXPECT_NULL(map);
+    }
+
+    // Reserved capacity is not shrunk automatically
+    rg_hash_map *map = rg_create_hash_map();
+    ASSERT_NOT_NULL(map);
+    EXPECT_TRUE(rg_hash_map_reserve(map, 5000));
+    size_t reserved_capacity = map->capacity;
+    for (uint64_t i = 1; i <= 5000; i++)
+    {
+        EXPECT_TRUE(rg_hash_map_set(map, i, (rg_hash_map_value_t) {.as_num = i}));
+    }
+    for (uint64_t i = 1; i <= 5000; i++)
+    {
+        rg_hash_map_erase(map, i);
+    }
+    EXPECT_TRUE(map->capacity == reserved_capacity);
+
+    // Unless asked explicitly, then the map goes back to the inline entries
+    EXPECT_TRUE(rg_hash_map_shrink_to_fit(map));
+    EXPECT_TRUE(map->capacity == 0);
+    rg_destroy_hash_map(&map);
+    EXPECT_NULL(map);
+}
+
+TEST(HashMap_SparseIteration)
+{
+    const rg_hash_map_create_info infos[3] = {
+        {.layout = RG_HASH_MAP_LAYOUT_LINEAR, .initial_capacity = 4000},
+        {.layout = RG_HASH_MAP_LAYOUT_GROUPED, .initial_capacity = 4000},
+        {.layout = RG_HASH_MAP_LAYOUT_LINEAR, .initial_capacity = 64, .incremental_resize = true},
+    };
+    for (uint32_t c = 0; c < 3; c++)
+    {
+        rg_hash_map *map = rg_create_hash_map_with_info(&infos[c]);
+        ASSERT_NOT_NULL(map);
+
+        // Few entries spread in a big array, including the first and last slots of the words and groups
+        for (uint64_t i = 1; i <= 400; i++)
+        {
+            EXPECT_TRUE(rg_hash_map_set(map, i * 37, (rg_hash_map_value_t) {.as_num = i}));
+        }
+        for (uint64_t i = 1; i <= 400; i += 2)
+        {
+            rg_hash_map_erase(map, i * 37);
+        }
+
+        // Each remaining entry is visited exactly once, even in the middle of a migration
+        bool           found[201]     = {0};
+        size_t         iterated_count = 0;
+        rg_hash_map_it it             = rg_hash_map_iterator(map);
+        while (rg_hash_map_next(&it))
+        {
+            EXPECT_TRUE(it.key == it.value.as_num * 37);
+            EXPECT_TRUE(it.value.as_num % 2 == 0);
+            EXPECT_FALSE(found[it.value.as_num / 2]);
+            found[it.value.as_num / 2] = true;
+            iterated_count++;
+        }
+        EXPECT_TRUE(iterated_count == 200);
+
+        // An emptied map has nothing to iterate
+        rg_hash_map_clear(map);
+        it = rg_hash_map_iterator(map);
+        EXPECT_FALSE(rg_hash_map_next(&it));
+
+        rg_destroy_hash_map(&map);
+        EXPECT_NULL(map);
+    }
+}
+
+TEST(HashMap_InlineEntries)
+{
+    const rg_hash_map_create_info infos[4] = {
+        {.layout = RG_HASH_MAP_LAYOUT_LINEAR},
+        {.layout = RG_HASH_MAP_LAYOUT_GROUPED},
+        {.layout = RG_HASH_MAP_LAYOUT_LINEAR, .compact = true},
+        {.layout = RG_HASH_MAP_LAYOUT_GROUPED, .incremental_resize = true},
+    };
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        rg_hash_map *map = rg_create_hash_map_with_info(&infos[c]);
+        ASSERT_NOT_NULL(map);
+
+        // A small map doesn't allocate any array
+        for (uint64_t i = 1; i <= 4; i++)
+        {
+            EXPECT_TRUE(rg_hash_map_set(map, i * 1000, (rg_hash_map_value_t) {.as_num = i}));
+        }
+        EXPECT_TRUE(map->capacity == 0);
+        EXPECT_TRUE(rg_hash_map_count(map) == 4);
+        EXPECT_TRUE(rg_hash_map_reserve(map, 4));
+        EXPECT_TRUE(map->capacity == 0);
+
+        // Update, erase in the middle, and look up
+        EXPECT_TRUE(rg_hash_map_set(map, 3000, (rg_hash_map_value_t) {.as_num = 33}));
+        rg_hash_map_erase(map, 2000);
+        rg_hash_map_erase(map, 2000);
+        EXPECT_TRUE(rg_hash_map_count(map) == 3);
+        EXPECT_FALSE(rg_hash_map_get(map, 2000).exists);
+        EXPECT_FALSE(rg_hash_map_get(map, RG_HASH_MAP_NULL_KEY).exists);
+        EXPECT_TRUE(rg_hash_map_get(map, 3000).value.as_num == 33);
+        EXPECT_TRUE(rg_hash_map_get(map, 4000).value.as_num == 4);
+
+        rg_hash_map_key_t      keys[3] = {1000, 2000, 4000};
+        rg_hash_map_get_result results[3];
+        rg_hash_map_get_many(map, keys, 3, results);
+        EXPECT_TRUE(results[0].exists && results[0].value.as_num == 1);
+        EXPECT_FALSE(results[1].exists);
+        EXPECT_TRUE(results[2].exists && results[2].value.as_num == 4);
+
+        size_t         iterated_count = 0;
+        rg_hash_map_it it             = rg_hash_map_iterator(map);
+        while (rg_hash_map_next(&it))
+        {
+            EXPECT_TRUE(it.key != 2000);
+            iterated_count++;
+        }
+        EXPECT_TRUE(iterated_count == 3);
+
+        // Past the threshold, the entries are moved to the arrays
+        for (uint64_t i = 5; i <= 100; i++)
+        {
+            EXPECT_TRUE(rg_hash_map_set(map, i * 1000, (rg_hash_map_value_t) {.as_num = i}));
+        }
+        EXPECT_TRUE(map->capacity > 0);
+        EXPECT_NOT_NULL(map->data);
+        EXPECT_TRUE(rg_hash_map_count(map) == 99);
+        EXPECT_TRUE(rg_hash_map_get(map, 3000).value.as_num == 33);
+        EXPECT_FALSE(rg_hash_map_get(map, 2000).exists);
+
+        // Shrinking brings them back
+        for (uint64_t i = 6; i <= 100; i++)
+        {
+            rg_hash_map_erase(map, i * 1000);
+        }
+        EXPECT_TRUE(rg_hash_map_shrink_to_fit(map));
+        EXPECT_TRUE(map->capacity == 0);
+        EXPECT_TRUE(rg_hash_map_count(map) == 4);
+        for (uint64_t i = 1; i <= 6; i++)
+        {
+            EXPECT_TRUE(rg_hash_map_get(map, i * 1000).exists == (i != 2 && i != 6));
+        }
+
+        // Inline entries can hold anything, but the arrays must be wide if they do
+        rg_hash_map_erase(map, 5000);
+        EXPECT_TRUE(rg_hash_map_set(map, 1ULL << 40, (rg_hash_map_value_t) {.as_num = 1ULL << 41}));
+        EXPECT_TRUE(map->capacity == 0);
+        EXPECT_FALSE(map->compact);
+        EXPECT_TRUE(rg_hash_map_reserve(map, 100));
+        EXPECT_TRUE(map->capacity > 0);
+        EXPECT_TRUE(rg_hash_map_get(map, 1ULL << 40).value.as_num == 1ULL << 41);
+
+        rg_hash_map_clear(map);
+        EXPECT_TRUE(rg_hash_map_count(map) == 0);
+        rg_destroy_hash_map(&map);
+        EXPECT_NULL(map);
+    }
+
+    // A bigger initial capacity allocates the arrays directly
+    rg_hash_map *map = rg_create_hash_map_with_capacity(5);
+    ASSERT_NOT_NULL(map);
+    EXPECT_TRUE(map->capacity > 0);
+    rg_destroy_hash_map(&map);
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "../framework/test_framework.h"
+#include "test_allocator.h"
+#include <railguard/utils/sort.h>
+
+static uint64_t rg_test_sort_random(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static int rg_test_sort_compare_int(const void *a, const void *b, void *user_data)
+{
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+    (void) user_data;
+    return (x > y) - (x < y);
+}
+
+// Checks that the keys are sorted, and that the ones with the same key kept the order of their index
+static bool rg_test_sort_is_sorted32(const rg_vector *keys)
+{
+    const rg_sort_key32 *data = keys->data;
+    for (size_t i = 1; i < keys->count; i++)
+    {
+        if (data[i - 1].key > data[i].key || (data[i - 1].key == data[i].key && data[i - 1].index >= data[i].index))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool rg_test_sort_is_sorted64(const rg_vector *keys)
+{
+    const rg_sort_key64 *data = keys->data;
+    for (size_t i = 1; i < keys->count; i++)
+    {
+        if (data[i - 1].key > data[i].key || (data[i - 1].key == data[i].key && data[i - 1].index >= data[i].index))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST(Sort)
+{
+    // Introsort, on several patterns that are hard for a naive quicksort
+    int    values[1000];
+    size_t counts[4] = {0, 1, 17, 1000};
+    for (int pattern = 0; pattern < 5; pattern++)
+    {
+        for (size_t c = 0; c < 4; c++)
+        {
+            uint64_t state = 0x9E3779B97F4A7C15ULL;
+            int64_t  sum   = 0;
+            for (size_t i = 0; i < counts[c]; i++)
+            {
+                int values_by_pattern[5] = {
+                    (int) (rg_test_sort_random(&state) % 100000), // Random
+                    (int) i,                                      // Sorted
+                    (int) (counts[c] - i),                        // Reversed
+                    42,                                           // All equal
+                    (int) (i % 3),                                // Few distinct values
+                };
+                values[i] = values_by_pattern[pattern];
+                sum += values[i];
+            }
+
+            rg_sort(values, counts[c], sizeof(int), rg_test_sort_compare_int, NULL);
+            bool sorted = true;
+            for (size_t i = 1; i < counts[c]; i++)
+            {
+                sorted &= values[i - 1] <= values[i];
+                sum -= values[i];
+            }
+            if (counts[c] > 0)
+            {
+                sum -= values[0];
+            }
+            EXPECT_TRUE(sorted);
+            EXPECT_TRUE(sum == 0);
+        }
+    }
+
+    // Radix sorts, with a lot of duplicated keys to check the stability
+    rg_vector keys32 = {0};
+    ASSERT_TRUE(rg_create_vector(10000, sizeof(rg_sort_key32), &keys32));
+    uint64_t state = 12345;
+    for (uint32_t i = 0; i < 10000; i++)
+    {
+        rg_sort_key32 key = {.key = (uint32_t) rg_test_sort_random(&state) % 5000, .index = i};
+        rg_vector_push_back(&keys32, &key);
+    }
+    EXPECT_TRUE(rg_sort_keys32(&keys32));
+    EXPECT_TRUE(keys32.count == 10000);
+    EXPECT_TRUE(rg_test_sort_is_sorted32(&keys32));
+
+    // Keys that only differ in their high digits, so that the low passes are skipped
+    for (uint32_t i = 0; i < keys32.count; i++)
+    {
+        ((rg_sort_key32 *) keys32.data)[i] = (rg_sort_key32) {.key = (uint32_t) (rg_test_sort_random(&state) % 7) << 24, .index = i};
+    }
+    EXPECT_TRUE(rg_sort_keys32(&keys32));
+    EXPECT_TRUE(rg_test_sort_is_sorted32(&keys32));
+
+    rg_vector keys64 = {0};
+    ASSERT_TRUE(rg_create_vector(10000, sizeof(rg_sort_key64), &keys64));
+    for (uint64_t i = 0; i < 10000; i++)
+    {
+        rg_sort_key64 key = {.key = rg_test_sort_random(&state) & 0xFFFF0000000000FFULL, .index = i};
+        rg_vector_push_back(&keys64, &key);
+    }
+    EXPECT_TRUE(rg_sort_keys64(&keys64));
+    EXPECT_TRUE(rg_test_sort_is_sorted64(&keys64));
+
+    // The key type must match the vector
+    EXPECT_FALSE(rg_sort_keys32(&keys64));
+
+    // Parallel radix sorts, above the threshold
+    rg_thread_pool *pool = rg_create_thread_pool(3);
+    ASSERT_NOT_NULL(pool);
+    rg_vector_clear(&keys32);
+    for (uint32_t i = 0; i < RG_SORT_PARALLEL_MIN_COUNT + 1000; i++)
+    {
+        rg_sort_key32 key = {.key = (uint32_t) rg_test_sort_random(&state) % 100000, .index = i};
+        rg_vector_push_back(&keys32, &key);
+    }
+    EXPECT_TRUE(rg_sort_keys32_parallel(&keys32, pool));
+    EXPECT_TRUE(keys32.count == RG_SORT_PARALLEL_MIN_COUNT + 1000);
+    EXPECT_TRUE(rg_test_sort_is_sorted32(&keys32));
+
+    rg_vector_clear(&keys64);
+    for (uint64_t i = 0; i < RG_SORT_PARALLEL_MIN_COUNT + 1000; i++)
+    {
+        rg_sort_key64 key = {.key = rg_test_sort_random(&state) % 1000000 << 32, .index = i};
+        rg_vector_push_back(&keys64, &key);
+    }
+    EXPECT_TRUE(rg_sort_keys64_parallel(&keys64, pool));
+    EXPECT_TRUE(rg_test_sort_is_sorted64(&keys64));
+
+    // Below the threshold or without a pool, it sorts on the calling thread
+    rg_vector_resize(&keys64, 100);
+    EXPECT_TRUE(rg_sort_keys64_parallel(&keys64, pool));
+    EXPECT_TRUE(rg_test_sort_is_sorted64(&keys64));
+    EXPECT_TRUE(rg_sort_keys64_parallel(&keys64, NULL));
+
+    rg_destroy_thread_pool(&pool);
+    rg_destroy_vector(&keys32);
+    rg_destroy_vector(&keys64);
+}
+
+TEST(Sort_Allocator)
+{
+    rg_test_counting_allocator counter   = {0};
+    rg_allocator               allocator = {
+        .pfn_alloc   = rg_test_counting_alloc,
+        .pfn_realloc = rg_test_counting_realloc,
+        .pfn_free    = rg_test_counting_free,
+        .context     = &counter,
+    };
+    rg_vector keys = {0};
+    ASSERT_TRUE(rg_create_vector_with_allocator(1000, sizeof(rg_sort_key32), &allocator, &keys));
+    uint64_t state = 777;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        rg_sort_key32 key = {.key = (uint32_t) rg_test_sort_random(&state) % 100, .index = i};
+        rg_vector_push_back(&keys, &key);
+    }
+
+    // The scratch buffer comes from the allocator of the vector, and is given back to it
+    size_t total_count = counter.total_count;
+    EXPECT_TRUE(rg_sort_keys32(&keys));
+    EXPECT_TRUE(rg_test_sort_is_sorted32(&keys));
+    EXPECT_TRUE(counter.total_count == total_count + 1);
+    EXPECT_TRUE(counter.live_count == 1);
+
+    // If the allocator fails, the sort fails and leaves the keys unchanged
+    ((rg_sort_key32 *) keys.data)[0].key = 1000;
+    counter.fail                         = true;
+    EXPECT_FALSE(rg_sort_keys32(&keys));
+    EXPECT_TRUE(((rg_sort_key32 *) keys.data)[0].key == 1000);
+    counter.fail = false;
+
+    rg_destroy_vector(&keys);
+    EXPECT_TRUE(counter.live_count == 0);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../framework/test_framework.h"
+#include "test_allocator.h"
 #include <railguard/utils/storage.h>
 
 typedef struct rg_test_storage_data {
@@ -66,8 +67,8 @@ TEST(Storage)
     EXPECT_TRUE(rg_storage_exists(storage, id3));
 
     // Check if all the data is located in a packed array
-    EXPECT_TRUE((char*) data2 == ((char*) data1) + sizeof(rg_test_storage_data) + sizeof(rg_hash_map_key_t));
-    EXPECT_TRUE((char*) data3 == ((char*) data2) + sizeof(rg_test_storage_data) + sizeof(rg_hash_map_key_t));
+    EXPECT_TRUE((char*) data2 == ((char*) data1) + sizeof(rg_test_storage_data));
+    EXPECT_TRUE((char*) data3 == ((char*) data2) + sizeof(rg_test_storage_data));
 
     // Try to get data that does not exist
     rg_test_storage_data *invalid_data = rg_storage_get(storage, 0xDEADBEEF);
@@ -143,6 +144,592 @@ TEST(Storage)
     EXPECT_NULL(storage);
 }
 
+TEST(Storage_GetMany)
+{
+    rg_storage *storage = rg_create_storage(sizeof(rg_test_storage_data));
+    ASSERT_NOT_NULL(storage);
+
+    // Use more elements than a batch, to check the boundaries
+    for (uint64_t i = 0; i < 300; i++)
+    {
+        rg_test_storage_data data = {.a = i, .b = (double) i / 2};
+        EXPECT_TRUE(rg_storage_push(storage, &data) == i + 1);
+    }
+    for (rg_storage_id id = 1; id <= 300; id += 7)
+    {
+        rg_storage_erase(storage, id);
+    }
+
+    // Look up existing, erased and unknown ids in a random order
+    rg_storage_id ids[500];
+    void         *values[500];
+    uint64_t      state = 0x5EED;
+    for (size_t i = 0; i < 500; i++)
+    {
+        state  = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        ids[i] = (rg_storage_id) ((state >> 33) % 400);
+    }
+    rg_storage_get_many(storage, ids, 500, values);
+
+    for (size_t i = 0; i < 500; i++)
+    {
+        EXPECT_TRUE(values[i] == rg_storage_get(storage, ids[i]));
+        if (ids[i] >= 1 && ids[i] <= 300 && (ids[i] - 1) % 7 != 0)
+        {
+            ASSERT_NOT_NULL(values[i]);
+            EXPECT_TRUE(((rg_test_storage_data *) values[i])->a == ids[i] - 1);
+        }
+        else
+        {
+            EXPECT_NULL(values[i]);
+        }
+    }
+
+    // An empty batch does nothing
+    rg_storage_get_many(storage, ids, 0, values);
+
+    rg_destroy_storage(&storage);
+    EXPECT_NULL(storage);
+}
+
+TEST(Storage_ShrinkToFit)
+{
+    rg_storage *storage = rg_create_storage(sizeof(rg_test_storage_data));
+    ASSERT_NOT_NULL(storage);
+
+    for (uint64_t i = 0; i < 5000; i++)
+    {
+        rg_test_storage_data data = {.a = i};
+        EXPECT_TRUE(rg_storage_push(storage, &data) != RG_STORAGE_NULL_ID);
+    }
+    for (rg_storage_id id = 11; id <= 5000; id++)
+    {
+        rg_storage_erase(storage, id);
+    }
+    EXPECT_TRUE(rg_storage_shrink_to_fit(storage));
+
+    // The remaining elements are still there, and new ones can be pushed
+    EXPECT_TRUE(rg_storage_count(storage) == 10);
+    for (rg_storage_id id = 1; id <= 10; id++)
+    {
+        rg_test_storage_data *data = rg_storage_get(storage, id);
+        ASSERT_NOT_NULL(data);
+        EXPECT_TRUE(data->a == id - 1);
+    }
+    rg_test_storage_data data = {.a = 12345};
+    rg_storage_id        id   = rg_storage_push(storage, &data);
+    EXPECT_TRUE(id != RG_STORAGE_NULL_ID);
+    EXPECT_TRUE(((rg_test_storage_data *) rg_storage_get(storage, id))->a == 12345);
+
+    rg_destroy_storage(&storage);
+    EXPECT_NULL(storage);
+}
+
+TEST(Storage_SlotMap)
+{
+    rg_storage_create_info create_info = {
+        .element_size = sizeof(rg_test_storage_data),
+        .mode         = RG_STORAGE_MODE_SLOT_MAP,
+    };
+    rg_storage *storage = rg_create_storage_with_info(&create_info);
+    ASSERT_NOT_NULL(storage);
+
+    rg_storage_id ids[1000];
+    for (uint64_t i = 0; i < 1000; i++)
+    {
+        rg_test_storage_data data = {.a = i, .b = (double) i};
+        ids[i]                    = rg_storage_push(storage, &data);
+        EXPECT_TRUE(ids[i] != RG_STORAGE_NULL_ID);
+    }
+    EXPECT_FALSE(rg_storage_exists(storage, RG_STORAGE_NULL_ID));
+    EXPECT_NULL(rg_storage_get(storage, RG_STORAGE_NULL_ID));
+
+    // Erase every third element
+    for (size_t i = 0; i < 1000; i += 3)
+    {
+        rg_storage_erase(storage, ids[i]);
+    }
+    EXPECT_TRUE(rg_storage_count(storage) == 666);
+
+    // The erased ids don't exist anymore, even when their slots are reused
+    rg_storage_id reused_ids[334];
+    for (uint64_t i = 0; i < 334; i++)
+    {
+        rg_test_storage_data data = {.a = 1000 + i};
+        reused_ids[i]             = rg_storage_push(storage, &data);
+        EXPECT_TRUE(reused_ids[i] != RG_STORAGE_NULL_ID);
+    }
+    EXPECT_TRUE(rg_storage_count(storage) == 1000);
+    for (size_t i = 0; i < 1000; i++)
+    {
+        rg_test_storage_data *data = rg_storage_get(storage, ids[i]);
+        if (i % 3 == 0)
+        {
+            EXPECT_NULL(data);
+            EXPECT_FALSE(rg_storage_exists(storage, ids[i]));
+        }
+        else
+        {
+            ASSERT_NOT_NULL(data);
+            EXPECT_TRUE(data->a == i);
+        }
+    }
+    for (size_t i = 0; i < 334; i++)
+    {
+        for (size_t j = 0; j < 1000; j++)
+        {
+            EXPECT_TRUE(reused_ids[i] != ids[j]);
+        }
+        EXPECT_TRUE(((rg_test_storage_data *) rg_storage_get(storage, reused_ids[i]))->a == 1000 + i);
+    }
+
+    // The elements are packed, and the iteration gives the right ids
+    size_t        iterated_count = 0;
+    rg_storage_it it             = rg_storage_iterator(storage);
+    while (rg_storage_next(&it))
+    {
+        EXPECT_TRUE(rg_storage_get(storage, it.id) == it.value);
+        iterated_count++;
+    }
+    EXPECT_TRUE(iterated_count == 1000);
+
+    void *values[3];
+    rg_storage_get_many(storage, (rg_storage_id[]) {ids[0], ids[1], reused_ids[0]}, 3, values);
+    EXPECT_NULL(values[0]);
+    EXPECT_TRUE(values[1] == rg_storage_get(storage, ids[1]));
+    EXPECT_TRUE(values[2] == rg_storage_get(storage, reused_ids[0]));
+
+    // A slot reused many times never gives back an old id
+    rg_storage_id first_id = reused_ids[0];
+    for (uint32_t i = 0; i < 300; i++)
+    {
+        rg_test_storage_data data = {.a = i};
+        rg_storage_erase(storage, reused_ids[0]);
+        reused_ids[0] = rg_storage_push(storage, &data);
+        EXPECT_TRUE(reused_ids[0] != RG_STORAGE_NULL_ID);
+        EXPECT_FALSE(rg_storage_exists(storage, first_id) && reused_ids[0] != first_id);
+    }
+
+    EXPECT_TRUE(rg_storage_shrink_to_fit(storage));
+    rg_destroy_storage(&storage);
+    EXPECT_NULL(storage);
+}
+
+TEST(Storage_IdRecycling)
+{
+    // Only 16 bits are left for the index, so 65535 elements at most
+    rg_storage_create_info create_info = {
+        .element_size    = sizeof(rg_test_storage_data),
+        .recycle_ids     = true,
+        .generation_bits = 16,
+    };
+    rg_storage *storage = rg_create_storage_with_info(&create_info);
+    ASSERT_NOT_NULL(storage);
+
+    rg_test_storage_data data = {.a = 0};
+    for (uint32_t i = 1; i <= 0xFFFF; i++)
+    {
+        EXPECT_TRUE(rg_storage_push(storage, &data) == i);
+    }
+
+    // The ids are exhausted, the counter must not wrap
+    EXPECT_TRUE(rg_storage_push(storage, &data) == RG_STORAGE_NULL_ID);
+    EXPECT_TRUE(rg_storage_count(storage) == 0xFFFF);
+
+    // An erased id is recycled with a new generation
+    rg_storage_erase(storage, 42);
+    data.a                 = 1;
+    rg_storage_id recycled = rg_storage_push(storage, &data);
+    EXPECT_TRUE(recycled == ((1u << 16) | 42));
+    EXPECT_FALSE(rg_storage_exists(storage, 42));
+    EXPECT_NULL(rg_storage_get(storage, 42));
+    EXPECT_TRUE(((rg_test_storage_data *) rg_storage_get(storage, recycled))->a == 1);
+    EXPECT_TRUE(rg_storage_push(storage, &data) == RG_STORAGE_NULL_ID);
+
+    // Erasing the stale id doesn't erase the new element
+    rg_storage_erase(storage, 42);
+    EXPECT_TRUE(rg_storage_exists(storage, recycled));
+    EXPECT_TRUE(rg_storage_count(storage) == 0xFFFF);
+
+    rg_destroy_storage(&storage);
+
+    // Without generation bits, the same ids are given back
+    create_info.generation_bits = 0;
+    storage                     = rg_create_storage_with_info(&create_info);
+    ASSERT_NOT_NULL(storage);
+    rg_storage_id id1 = rg_storage_push(storage, &data);
+    rg_storage_id id2 = rg_storage_push(storage, &data);
+    rg_storage_erase(storage, id1);
+    EXPECT_TRUE(rg_storage_push(storage, &data) == id1);
+    EXPECT_TRUE(rg_storage_push(storage, &data) == id2 + 1);
+    rg_destroy_storage(&storage);
+
+    // Too many generation bits
+    create_info.generation_bits = 17;
+    EXPECT_NULL(rg_create_storage_with_info(&create_info));
+}
+
+TEST(Storage_StableAddresses)
+{
+    rg_storage_mode modes[2] = {RG_STORAGE_MODE_HASHED, RG_STORAGE_MODE_SLOT_MAP};
+    for (size_t m = 0; m < 2; m++)
+    {
+        rg_storage_create_info create_info = {
+            .element_size     = sizeof(rg_test_storage_data),
+            .mode             = modes[m],
+            .stable_addresses = true,
+        };
+        rg_storage *storage = rg_create_storage_with_info(&create_info);
+        ASSERT_NOT_NULL(storage);
+
+        rg_storage_id         ids[300];
+        rg_test_storage_data *pointers[300];
+        for (uint64_t i = 0; i < 300; i++)
+        {
+            rg_test_storage_data data = {.a = i};
+            ids[i]                    = rg_storage_push(storage, &data);
+            pointers[i]               = rg_storage_get(storage, ids[i]);
+            ASSERT_NOT_NULL(pointers[i]);
+        }
+
+        // The erasures and the next pushes don't move the other elements
+        for (size_t i = 0; i < 300; i += 3)
+        {
+            rg_storage_erase(storage, ids[i]);
+        }
+        for (uint64_t i = 0; i < 200; i++)
+        {
+            rg_test_storage_data data = {.a = 1000 + i};
+            EXPECT_TRUE(rg_storage_push(storage, &data) != RG_STORAGE_NULL_ID);
+        }
+        EXPECT_TRUE(rg_storage_count(storage) == 400);
+        for (size_t i = 1; i < 300; i++)
+        {
+            if (i % 3 != 0)
+            {
+                EXPECT_TRUE(rg_storage_get(storage, ids[i]) == pointers[i]);
+                EXPECT_TRUE(pointers[i]->a == i);
+            }
+        }
+
+        // The iteration gives every element once
+        size_t        iterated_count = 0;
+        rg_storage_it it             = rg_storage_iterator(storage);
+        while (rg_storage_next(&it))
+        {
+            EXPECT_TRUE(rg_storage_get(storage, it.id) == it.value);
+            iterated_count++;
+        }
+        EXPECT_TRUE(iterated_count == 400);
+        EXPECT_TRUE(rg_storage_shrink_to_fit(storage));
+
+        rg_destroy_storage(&storage);
+    }
+}
+
+// Sums the elements of a chunk, and checks that they are given in order
+void rg_test_storage_sum_chunk(rg_storage_it *it, size_t chunk_index, uint64_t *chunk_sums)
+{
+    uint64_t sum = 0;
+    while (rg_storage_next(it))
+    {
+        rg_test_storage_data *data = it->value;
+        sum += data->a;
+        data->b = (double) chunk_index;
+    }
+    chunk_sums[chunk_index] = sum;
+}
+
+TEST(Storage_ParallelFor)
+{
+    rg_thread_pool *pool = rg_create_thread_pool(3);
+    ASSERT_NOT_NULL(pool);
+
+    rg_storage_mode modes[2] = {RG_STORAGE_MODE_HASHED, RG_STORAGE_MODE_SLOT_MAP};
+    for (size_t m = 0; m < 4; m++)
+    {
+        rg_storage_create_info create_info = {
+            .element_size     = sizeof(rg_test_storage_data),
+            .mode             = modes[m % 2],
+            .stable_addresses = m >= 2,
+            .thread_pool      = pool,
+        };
+        rg_storage *storage = rg_create_storage_with_info(&create_info);
+        ASSERT_NOT_NULL(storage);
+
+        rg_storage_id ids[10000];
+        for (uint64_t i = 0; i < 10000; i++)
+        {
+            rg_test_storage_data data = {.a = i};
+            ids[i]                    = rg_storage_push(storage, &data);
+        }
+        for (size_t i = 0; i < 10000; i += 7)
+        {
+            rg_storage_erase(storage, ids[i]);
+        }
+
+        // Every element is in exactly one chunk
+        size_t chunk_count = rg_storage_chunk_count(storage, 100);
+        EXPECT_TRUE(chunk_count >= 85 && chunk_count <= 100);
+        uint64_t chunk_sums[100] = {0};
+        rg_storage_parallel_for(storage, (rg_storage_chunk_function) rg_test_storage_sum_chunk, chunk_sums, 100);
+
+        uint64_t expected_sum = 0;
+        for (uint64_t i = 0; i < 10000; i++)
+        {
+            expected_sum += i % 7 != 0 ? i : 0;
+        }
+        uint64_t sum = 0;
+        for (size_t i = 0; i < chunk_count; i++)
+        {
+            sum += chunk_sums[i];
+        }
+        EXPECT_TRUE(sum == expected_sum);
+
+        // The chunks are the same as the ones of the serial iteration
+        size_t        place = 0;
+        rg_storage_it it    = rg_storage_iterator(storage);
+        while (rg_storage_next(&it))
+        {
+            rg_test_storage_data *data = it.value;
+            EXPECT_TRUE(data->b >= 0 && (size_t) data->b < chunk_count);
+            EXPECT_TRUE((size_t) data->b >= place / 100);
+            place++;
+        }
+        EXPECT_TRUE(place == rg_storage_count(storage));
+
+        rg_destroy_storage(&storage);
+    }
+
+    rg_destroy_thread_pool(&pool);
+}
+
+TEST(Storage_DeferredErase)
+{
+    rg_storage_mode modes[2] = {RG_STORAGE_MODE_HASHED, RG_STORAGE_MODE_SLOT_MAP};
+    for (size_t m = 0; m < 4; m++)
+    {
+        rg_storage_create_info create_info = {
+            .element_size     = sizeof(rg_test_storage_data),
+            .mode             = modes[m % 2],
+            .stable_addresses = m >= 2,
+        };
+        rg_storage *storage = rg_create_storage_with_info(&create_info);
+        ASSERT_NOT_NULL(storage);
+
+        rg_storage_id ids[1000];
+        for (uint64_t i = 0; i < 1000; i++)
+        {
+            rg_test_storage_data data = {.a = i};
+            ids[i]                    = rg_storage_push(storage, &data);
+        }
+
+        // Queue erasures while iterating: every element is still visited once
+        size_t        iterated_count = 0;
+        rg_storage_it it             = rg_storage_iterator(storage);
+        while (rg_storage_next(&it))
+        {
+            rg_test_storage_data *data = it.value;
+            if (data->a % 3 == 0)
+            {
+                rg_storage_erase_deferred(storage, it.id);
+            }
+            iterated_count++;
+        }
+        EXPECT_TRUE(iterated_count == 1000);
+        EXPECT_TRUE(rg_storage_count(storage) == 1000);
+
+        // Duplicates and unknown ids are ignored
+        rg_storage_erase_deferred(storage, ids[3]);
+        rg_storage_erase_deferred(storage, 0xDEADBEEF);
+        rg_storage_commit_erases(storage);
+        EXPECT_TRUE(rg_storage_count(storage) == 666);
+
+        for (uint64_t i = 0; i < 1000; i++)
+        {
+            rg_test_storage_data *data = rg_storage_get(storage, ids[i]);
+            if (i % 3 == 0)
+            {
+                EXPECT_NULL(data);
+            }
+            else
+            {
+                ASSERT_NOT_NULL(data);
+                EXPECT_TRUE(data->a == i);
+            }
+        }
+        iterated_count = 0;
+        it             = rg_storage_iterator(storage);
+        while (rg_storage_next(&it))
+        {
+            EXPECT_TRUE(((rg_test_storage_data *) it.value)->a % 3 != 0);
+            EXPECT_TRUE(rg_storage_get(storage, it.id) == it.value);
+            iterated_count++;
+        }
+        EXPECT_TRUE(iterated_count == 666);
+
+        // Nothing is queued anymore
+        rg_storage_commit_erases(storage);
+        EXPECT_TRUE(rg_storage_count(storage) == 666);
+
+        // A few erasures in a big storage are compacted differently
+        rg_storage_erase_deferred(storage, ids[1]);
+        rg_storage_erase_deferred(storage, ids[998]);
+        rg_storage_commit_erases(storage);
+        EXPECT_TRUE(rg_storage_count(storage) == 664);
+        EXPECT_FALSE(rg_storage_exists(storage, ids[1]) || rg_storage_exists(storage, ids[998]));
+        for (uint64_t i = 2; i < 998; i += 3)
+        {
+            rg_test_storage_data *data = rg_storage_get(storage, ids[i]);
+            ASSERT_NOT_NULL(data);
+            EXPECT_TRUE(data->a == i);
+        }
+
+        rg_destroy_storage(&storage);
+    }
+}
+
+TEST(Storage_ChangeJournal)
+{
+    rg_storage_mode modes[2] = {RG_STORAGE_MODE_HASHED, RG_STORAGE_MODE_SLOT_MAP};
+    for (size_t m = 0; m < 2; m++)
+    {
+        rg_storage_create_info create_info = {
+            .element_size  = sizeof(rg_test_storage_data),
+            .mode          = modes[m],
+            .track_changes = true,
+        };
+        rg_storage *storage = rg_create_storage_with_info(&create_info);
+        ASSERT_NOT_NULL(storage);
+        uint64_t first_epoch = rg_storage_current_epoch(storage);
+        EXPECT_TRUE(first_epoch != 0);
+
+        rg_storage_id ids[100];
+        for (uint64_t i = 0; i < 100; i++)
+        {
+            rg_test_storage_data data = {.a = i};
+            ids[i]                    = rg_storage_push(storage, &data);
+        }
+
+        // A modification right after the creation is not recorded again
+        rg_storage_mark_modified(storage, ids[0]);
+        rg_storage_changes changes = rg_storage_changes_since(storage, first_epoch);
+        EXPECT_TRUE(changes.complete);
+        ASSERT_TRUE(changes.count == 100);
+        for (size_t i = 0; i < changes.count; i++)
+        {
+            EXPECT_TRUE(changes.changes[i].id == ids[i]);
+            EXPECT_TRUE(changes.changes[i].type == RG_STORAGE_CHANGE_CREATED);
+        }
+
+        // In the next epoch, each element is recorded once when modified
+        uint64_t second_epoch = rg_storage_begin_epoch(storage);
+        EXPECT_TRUE(second_epoch > first_epoch);
+        EXPECT_TRUE(rg_storage_changes_since(storage, second_epoch).count == 0);
+        rg_storage_mark_modified(storage, ids[5]);
+        rg_storage_mark_modified(storage, ids[5]);
+        rg_storage_mark_modified(storage, ids[7]);
+        rg_storage_mark_modified(storage, 0xDEADBEEF);
+        rg_storage_erase(storage, ids[5]);
+        rg_storage_erase(storage, ids[5]);
+        rg_storage_erase_deferred(storage, ids[9]);
+        rg_storage_erase_deferred(storage, ids[9]);
+        rg_storage_commit_erases(storage);
+
+        changes = rg_storage_changes_since(storage, second_epoch);
+        ASSERT_TRUE(changes.count == 4);
+        EXPECT_TRUE(changes.changes[0].id == ids[5] && changes.changes[0].type == RG_STORAGE_CHANGE_MODIFIED);
+        EXPECT_TRUE(changes.changes[1].id == ids[7] && changes.changes[1].type == RG_STORAGE_CHANGE_MODIFIED);
+        EXPECT_TRUE(changes.changes[2].id == ids[5] && changes.changes[2].type == RG_STORAGE_CHANGE_ERASED);
+        EXPECT_TRUE(changes.changes[3].id == ids[9] && changes.changes[3].type == RG_STORAGE_CHANGE_ERASED);
+        EXPECT_TRUE(changes.changes[3].epoch == second_epoch);
+        EXPECT_TRUE(rg_storage_changes_since(storage, first_epoch).count == 104);
+
+        // The dirty ids are cleared by the next epoch
+        uint64_t third_epoch = rg_storage_begin_epoch(storage);
+        rg_storage_mark_modified(storage, ids[7]);
+        changes = rg_storage_changes_since(storage, third_epoch);
+        ASSERT_TRUE(changes.count == 1);
+        EXPECT_TRUE(changes.changes[0].id == ids[7] && changes.changes[0].epoch == third_epoch);
+
+        // Discarding the old changes keeps the recent ones
+        rg_storage_discard_changes_before(storage, third_epoch);
+        EXPECT_TRUE(rg_storage_changes_since(storage, first_epoch).count == 1);
+        rg_storage_mark_modified(storage, ids[7]);
+        EXPECT_TRUE(rg_storage_changes_since(storage, third_epoch).count == 1);
+
+        rg_destroy_storage(&storage);
+    }
+
+    // Without tracking, nothing is recorded
+    rg_storage *storage = rg_create_storage(sizeof(rg_test_storage_data));
+    ASSERT_NOT_NULL(storage);
+    rg_test_storage_data data = {.a = 1};
+    rg_storage_id        id   = rg_storage_push(storage, &data);
+    rg_storage_mark_modified(storage, id);
+    EXPECT_TRUE(rg_storage_current_epoch(storage) == 0);
+    EXPECT_TRUE(rg_storage_begin_epoch(storage) == 0);
+    EXPECT_TRUE(rg_storage_changes_since(storage, 0).count == 0);
+    rg_destroy_storage(&storage);
+}
+
+TEST(Storage_Allocator)
+{
+    rg_test_counting_allocator counter   = {0};
+    rg_allocator               allocator = {
+        .pfn_alloc   = rg_test_counting_alloc,
+        .pfn_realloc = rg_test_counting_realloc,
+        .pfn_free    = rg_test_counting_free,
+        .context     = &counter,
+    };
+
+    // Every mode allocates all of its memory with the allocator, and gives it all back
+    rg_storage_mode modes[2] = {RG_STORAGE_MODE_HASHED, RG_STORAGE_MODE_SLOT_MAP};
+    for (size_t m = 0; m < 4; m++)
+    {
+        rg_storage_create_info create_info = {
+            .element_size     = sizeof(rg_test_storage_data),
+            .mode             = modes[m % 2],
+            .recycle_ids      = true,
+            .stable_addresses = m >= 2,
+            .track_changes    = true,
+            .allocator        = &allocator,
+        };
+        rg_storage *storage = rg_create_storage_with_info(&create_info);
+        ASSERT_NOT_NULL(storage);
+
+        size_t total_before_pushes = counter.total_count;
+        for (uint64_t i = 0; i < 1000; i++)
+        {
+            rg_test_storage_data data = {.a = i};
+            rg_storage_id        id   = rg_storage_push(storage, &data);
+            rg_storage_mark_modified(storage, id);
+            if (i % 3 == 0)
+            {
+                rg_storage_erase_deferred(storage, id);
+            }
+        }
+        rg_storage_commit_erases(storage);
+        rg_storage_shrink_to_fit(storage);
+        EXPECT_TRUE(rg_storage_count(storage) == 666);
+        EXPECT_TRUE(counter.total_count > total_before_pushes);
+
+        rg_destroy_storage(&storage);
+        EXPECT_TRUE(counter.live_count == 0);
+    }
+
+    // Handle storages too
+    rg_handle_storage *handle_storage = rg_create_handle_storage_with_allocator(&allocator);
+    ASSERT_NOT_NULL(handle_storage);
+    for (size_t i = 0; i < 100; i++)
+    {
+        rg_handle_storage_push(handle_storage, &counter);
+    }
+    EXPECT_TRUE(counter.live_count > 0);
+    rg_destroy_handle_storage(&handle_storage);
+    EXPECT_TRUE(counter.live_count == 0);
+}
+
 TEST(HandleStorage) {
     // Create storage
     rg_handle_storage *storage = rg_create_handle_storage();
@@ -193,4 +780,81 @@ TEST(HandleStorage) {
     rg_destroy_handle_storage(&storage);
     EXPECT_NULL(storage);
 
-}
\ No newline at end of file
+}
+TEST(HandleStorage_Slots)
+{
+    rg_handle_storage *storage = rg_create_handle_storage();
+    ASSERT_NOT_NULL(storage);
+
+    // The handles are only pointers, use fake ones
+    rg_storage_id ids[100];
+    for (uintptr_t i = 0; i < 100; i++)
+    {
+        ids[i] = rg_handle_storage_push(storage, (void *) (i + 1));
+        EXPECT_TRUE(ids[i] != RG_STORAGE_NULL_ID);
+    }
+
+    // The slots of the erased handles are reused with new ids
+    for (size_t i = 0; i < 100; i += 2)
+    {
+        rg_handle_storage_erase(storage, ids[i]);
+    }
+    rg_handle_storage_erase(storage, ids[0]);
+    EXPECT_TRUE(rg_handle_storage_count(storage) == 50);
+    for (uintptr_t i = 0; i < 50; i++)
+    {
+        rg_storage_id id = rg_handle_storage_push(storage, (void *) (1000 + i));
+        EXPECT_TRUE(id != RG_STORAGE_NULL_ID);
+        for (size_t j = 0; j < 100; j++)
+        {
+            EXPECT_TRUE(id != ids[j]);
+        }
+        rg_handle_storage_get_result result = rg_handle_storage_get(storage, id);
+        EXPECT_TRUE(result.exists && result.value == (void *) (1000 + i));
+    }
+    EXPECT_TRUE(rg_handle_storage_count(storage) == 100);
+    for (size_t i = 0; i < 100; i++)
+    {
+        rg_handle_storage_get_result result = rg_handle_storage_get(storage, ids[i]);
+        EXPECT_TRUE(result.exists == (i % 2 == 1));
+        EXPECT_TRUE(result.value == (i % 2 == 1 ? (void *) (i + 1) : NULL));
+    }
+    EXPECT_FALSE(rg_handle_storage_get(storage, RG_STORAGE_NULL_ID).exists);
+
+    // The iteration gives every handle with its id
+    size_t               iterated_count = 0;
+    rg_handle_storage_it it             = rg_handle_storage_iterator(storage);
+    while (rg_handle_storage_next(&it))
+    {
+        EXPECT_TRUE(rg_handle_storage_get(storage, it.id).value == it.value);
+        iterated_count++;
+    }
+    EXPECT_TRUE(iterated_count == 100);
+
+    // The ids follow the same rules as the ones of the slot map storages
+    rg_storage_create_info create_info = {
+        .element_size = sizeof(uint32_t),
+        .mode         = RG_STORAGE_MODE_SLOT_MAP,
+    };
+    rg_storage        *slot_map       = rg_create_storage_with_info(&create_info);
+    rg_handle_storage *handle_storage = rg_create_handle_storage();
+    ASSERT_NOT_NULL(slot_map);
+    ASSERT_NOT_NULL(handle_storage);
+    bool same_ids = true;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        rg_storage_id slot_map_id = rg_storage_push(slot_map, &i);
+        rg_storage_id handle_id   = rg_handle_storage_push(handle_storage, &create_info);
+        same_ids &= slot_map_id == handle_id;
+        if (i % 3 != 0)
+        {
+            rg_storage_erase(slot_map, slot_map_id);
+            rg_handle_storage_erase(handle_storage, handle_id);
+        }
+    }
+    EXPECT_TRUE(same_ids);
+    rg_destroy_storage(&slot_map);
+    rg_destroy_handle_storage(&handle_storage);
+
+    rg_destroy_handle_storage(&storage);
+}
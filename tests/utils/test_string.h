@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../framework/test_framework.h"
+#include "test_allocator.h"
 #include <railguard/utils/string.h>
 
 TEST(String)
@@ -210,4 +211,57 @@ TEST(String)
     rg_free(s4.data);
     rg_free(s5.data);
     rg_free(s6.data);
-}
\ No newline at end of file
+}
+TEST(String_Allocator)
+{
+    rg_test_counting_allocator counter   = {0};
+    rg_allocator               allocator = {
+        .pfn_alloc   = rg_test_counting_alloc,
+        .pfn_realloc = rg_test_counting_realloc,
+        .pfn_free    = rg_test_counting_free,
+        .context     = &counter,
+    };
+    rg_string hello = RG_CSTR_CONST("Hello");
+    rg_string world = RG_CSTR_CONST("World");
+
+    // Each function allocates its data with the allocator
+    rg_string clone = rg_clone_string_with_allocator(hello, &allocator);
+    EXPECT_TRUE(counter.live_count == 1);
+    EXPECT_TRUE(clone.data != hello.data);
+    EXPECT_TRUE(rg_string_equals(clone, hello));
+
+    char      buffer[5]   = {'W', 'o', 'r', 'l', 'd'};
+    rg_string from_buffer = rg_create_string_from_buffer_with_allocator(buffer, 5, &allocator);
+    EXPECT_TRUE(counter.live_count == 2);
+    EXPECT_TRUE(rg_string_equals(from_buffer, world));
+    EXPECT_TRUE(from_buffer.data[5] == '\0');
+
+    rg_string concat = rg_string_concat_with_allocator(hello, world, &allocator);
+    EXPECT_TRUE(counter.live_count == 3);
+    EXPECT_TRUE(rg_string_equals(concat, RG_CSTR_CONST("HelloWorld")));
+
+    // Empty strings are not allocated
+    rg_string empty_clone  = rg_clone_string_with_allocator(RG_EMPTY_STRING, &allocator);
+    rg_string empty_buffer = rg_create_string_from_buffer_with_allocator(buffer, 0, &allocator);
+    rg_string empty_concat = rg_string_concat_with_allocator(RG_EMPTY_STRING, RG_EMPTY_STRING, &allocator);
+    EXPECT_TRUE(rg_string_is_empty(empty_clone) && rg_string_is_empty(empty_buffer) && rg_string_is_empty(empty_concat));
+    EXPECT_TRUE(counter.total_count == 3);
+
+    // rg_free_string gives the memory back to the allocator, and ignores the empty strings
+    rg_free_string(clone, &allocator);
+    rg_free_string(from_buffer, &allocator);
+    rg_free_string(concat, &allocator);
+    EXPECT_TRUE(counter.live_count == 0);
+    rg_free_string(empty_clone, &allocator);
+    rg_free_string(empty_buffer, &allocator);
+    rg_free_string(empty_concat, &allocator);
+    rg_free_string(RG_EMPTY_STRING, &allocator);
+    EXPECT_TRUE(counter.live_count == 0);
+    EXPECT_TRUE(counter.total_count == 3);
+
+    // If the allocator fails, the result is empty
+    counter.fail = true;
+    EXPECT_TRUE(rg_string_is_empty(rg_clone_string_with_allocator(hello, &allocator)));
+    EXPECT_TRUE(rg_string_is_empty(rg_string_concat_with_allocator(hello, world, &allocator)));
+    EXPECT_TRUE(counter.live_count == 0);
+}
@@ -2,6 +2,7 @@
 
 #include "../framework/test_framework.h"
 #include "string.h"
+#include "test_allocator.h"
 #include <railguard/utils/arrays.h>
 #include <railguard/utils/maps.h>
 
@@ -16,15 +17,40 @@ typedef struct rg_hash_map_entry
 
 typedef struct rg_hash_map
 {
-    rg_hash_map_entry *data;
-    size_t             capacity;
-    size_t             count;
+    size_t                    capacity;
+    size_t                    count;
+    rg_hash_map_layout        layout;
+    rg_hash_map_hash_function pfn_hash;
+    float                     max_load_factor;
+    bool                      compact;
+    size_t                    growth_left;
+    size_t                    min_capacity;
+    bool                      incremental_resize;
+    size_t                    migration_index;
+    bool                      use_inline_entries;
+    union
+    {
+        struct
+        {
+            void     *data;
+            uint64_t *occupancy;
+            int8_t   *control;
+            void     *old_data;
+            int8_t   *old_control;
+            uint64_t *old_occupancy;
+            size_t    old_capacity;
+            size_t    old_count;
+        };
+        rg_hash_map_entry inline_entries[4];
+    };
+    const rg_allocator *allocator;
 } rg_hash_map;
 
 typedef struct rg_struct_map
 {
     rg_hash_map hash_map; // We take advantage of the fact that we are in the same c file to avoid a pointer here
-    rg_vector   storage;
+    rg_vector   values;
+    rg_vector   keys;
     size_t      value_size;
 } rg_struct_map;
 
@@ -35,6 +61,13 @@ typedef struct rg_test_struct_map_data
     double pos[3];
 } rg_test_struct_map_data;
 
+// Test struct that fills a cache line, so that it needs more than the fundamental alignment
+typedef struct rg_test_struct_map_cache_line
+{
+    _Alignas(RG_CACHE_LINE_SIZE) uint64_t counter;
+    char name[24];
+} rg_test_struct_map_cache_line;
+
 TEST(StructMap)
 {
     // Creation
@@ -42,16 +75,16 @@ TEST(StructMap)
     ASSERT_NOT_NULL(struct_map);
 
     EXPECT_TRUE(rg_struct_map_count(struct_map) == 0);
-    EXPECT_TRUE(struct_map->storage.count == struct_map->hash_map.count);
-    EXPECT_TRUE(struct_map->storage.count == 0);
+    EXPECT_TRUE(struct_map->values.count == struct_map->hash_map.count);
+    EXPECT_TRUE(struct_map->values.count == 0);
 
     // Populate it
     rg_test_struct_map_data  data        = {.number = 42, .pos = {7, -9.5, 2}};
     rg_test_struct_map_data *key1_in_map = rg_struct_map_set(struct_map, 1, &data);
     ASSERT_NOT_NULL(key1_in_map);
     EXPECT_TRUE(rg_struct_map_count(struct_map) == 1);
-    EXPECT_TRUE(struct_map->storage.count == struct_map->hash_map.count);
-    EXPECT_TRUE(struct_map->storage.count == 1);
+    EXPECT_TRUE(struct_map->values.count == struct_map->hash_map.count);
+    EXPECT_TRUE(struct_map->values.count == 1);
 
     // Update data and save another
     data.number                          = 89;
@@ -60,8 +93,8 @@ TEST(StructMap)
     ASSERT_NOT_NULL(key2_in_map);
     EXPECT_TRUE(key1_in_map != key2_in_map);
     EXPECT_TRUE(rg_struct_map_count(struct_map) == 2);
-    EXPECT_TRUE(struct_map->storage.count == struct_map->hash_map.count);
-    EXPECT_TRUE(struct_map->storage.count == 2);
+    EXPECT_TRUE(struct_map->values.count == struct_map->hash_map.count);
+    EXPECT_TRUE(struct_map->values.count == 2);
 
     // Since the data is copied, the value should stay unchanged even if the original struct is modified
     data.pos[1] = 88;
@@ -75,28 +108,26 @@ TEST(StructMap)
     EXPECT_TRUE(key2_in_map->pos[2] == 2);
 
     // Memory should be packed together
-    // key1_in_map should be the first, then key2_in_map should follow
-    // In between, there is the pointer to 1
-    rg_hash_map_key_t key1 = *(rg_hash_map_key_t *) ((char *) key1_in_map + sizeof(rg_test_struct_map_data));
-    EXPECT_TRUE(key1 == 1);
-    EXPECT_TRUE((rg_test_struct_map_data *) ((char *) key1_in_map + sizeof(rg_test_struct_map_data) + sizeof(const char *))
-                == key2_in_map);
-    rg_hash_map_key_t key2 = *(rg_hash_map_key_t *) ((char *) key2_in_map + sizeof(rg_test_struct_map_data));
-    EXPECT_TRUE(key2 == 2);
+    // key1_in_map should be the first, then key2_in_map should follow directly
+    // The keys are in a parallel array, in the same order
+    EXPECT_TRUE(key1_in_map + 1 == key2_in_map);
+    rg_hash_map_key_t *keys = struct_map->keys.data;
+    EXPECT_TRUE(keys[0] == 1);
+    EXPECT_TRUE(keys[1] == 2);
 
     // Erasing
     rg_struct_map_erase(struct_map, 1);
     EXPECT_TRUE(rg_struct_map_count(struct_map) == 1);
-    EXPECT_TRUE(struct_map->storage.count == struct_map->hash_map.count);
-    EXPECT_TRUE(struct_map->storage.count == 1);
+    EXPECT_TRUE(struct_map->values.count == struct_map->hash_map.count);
+    EXPECT_TRUE(struct_map->values.count == 1);
 
     // Now, key1_in_map should point to key2 because it was moved at the beginning of the array
     EXPECT_TRUE(key1_in_map->number == 89);
     EXPECT_TRUE(key1_in_map->pos[0] == 78);
     EXPECT_TRUE(key1_in_map->pos[1] == -9.5);
     EXPECT_TRUE(key1_in_map->pos[2] == 2);
-    key1 = *(rg_hash_map_key_t *) ((char *) key1_in_map + sizeof(rg_test_struct_map_data));
-    EXPECT_TRUE(key1 == 2);
+    keys = struct_map->keys.data;
+    EXPECT_TRUE(keys[0] == 2);
 
     // Add some more values
     data.number                               = 789;
@@ -105,8 +136,8 @@ TEST(StructMap)
     rg_test_struct_map_data *other_key_in_map = rg_struct_map_set(struct_map, 987654, &data);
     ASSERT_NOT_NULL(other_key_in_map);
     EXPECT_TRUE(rg_struct_map_count(struct_map) == 2);
-    EXPECT_TRUE(struct_map->storage.count == struct_map->hash_map.count);
-    EXPECT_TRUE(struct_map->storage.count == 2);
+    EXPECT_TRUE(struct_map->values.count == struct_map->hash_map.count);
+    EXPECT_TRUE(struct_map->values.count == 2);
     // The slot that was used before for key2 should now be reused
     EXPECT_TRUE(other_key_in_map == key2_in_map);
     EXPECT_TRUE(other_key_in_map->number == 789);
@@ -117,8 +148,8 @@ TEST(StructMap)
     // Try to erase a non-existing key
     rg_struct_map_erase(struct_map, 7777777);
     EXPECT_TRUE(rg_struct_map_count(struct_map) == 2);
-    EXPECT_TRUE(struct_map->storage.count == struct_map->hash_map.count);
-    EXPECT_TRUE(struct_map->storage.count == 2);
+    EXPECT_TRUE(struct_map->values.count == struct_map->hash_map.count);
+    EXPECT_TRUE(struct_map->values.count == 2);
 
     // Add even more values
     data.number                          = 542;
@@ -128,8 +159,8 @@ TEST(StructMap)
     rg_test_struct_map_data *key3_in_map = rg_struct_map_set(struct_map, 3, &data);
     ASSERT_NOT_NULL(key3_in_map);
     EXPECT_TRUE(rg_struct_map_count(struct_map) == 3);
-    EXPECT_TRUE(struct_map->storage.count == struct_map->hash_map.count);
-    EXPECT_TRUE(struct_map->storage.count == 3);
+    EXPECT_TRUE(struct_map->values.count == struct_map->hash_map.count);
+    EXPECT_TRUE(struct_map->values.count == 3);
 
     data = (rg_test_struct_map_data) {0};
 
@@ -187,8 +218,8 @@ TEST(StructMap)
 
     // That shouldn't have changed
     EXPECT_TRUE(rg_struct_map_count(struct_map) == 3);
-    EXPECT_TRUE(struct_map->storage.count == struct_map->hash_map.count);
-    EXPECT_TRUE(struct_map->storage.count == 3);
+    EXPECT_TRUE(struct_map->values.count == struct_map->hash_map.count);
+    EXPECT_TRUE(struct_map->values.count == 3);
 
     // Update a value
     data.number                                       = 77777;
@@ -198,8 +229,8 @@ TEST(StructMap)
     rg_test_struct_map_data *updated_other_key_in_map = rg_struct_map_set(struct_map, 987654, &data);
     EXPECT_NOT_NULL(updated_other_key_in_map);
     EXPECT_TRUE(rg_struct_map_count(struct_map) == 3);
-    EXPECT_TRUE(struct_map->storage.count == struct_map->hash_map.count);
-    EXPECT_TRUE(struct_map->storage.count == 3);
+    EXPECT_TRUE(struct_map->values.count == struct_map->hash_map.count);
+    EXPECT_TRUE(struct_map->values.count == 3);
     EXPECT_TRUE(updated_other_key_in_map == new_other_key_in_map);
     EXPECT_TRUE(updated_other_key_in_map->number == 77777);
     EXPECT_TRUE(updated_other_key_in_map->pos[0] == 1.6180339887);
@@ -233,8 +264,8 @@ TEST(StructMap_Stress)
         EXPECT_TRUE(data_in_map->pos[2] == i - 2);
         EXPECT_TRUE(data_in_map->number == i + 3);
         EXPECT_TRUE(rg_struct_map_count(struct_map) == i + 1);
-        EXPECT_TRUE(struct_map->storage.count == struct_map->hash_map.count);
-        EXPECT_TRUE(struct_map->storage.count == i + 1);
+        EXPECT_TRUE(struct_map->values.count == struct_map->hash_map.count);
+        EXPECT_TRUE(struct_map->values.count == i + 1);
     }
 
     ASSERT_TRUE(rg_struct_map_count(struct_map) == 100000);
@@ -264,8 +295,8 @@ TEST(StructMap_Stress)
         rg_struct_map_erase(struct_map, (rg_hash_map_key_t) (i * 4) + 1);
         count -= 1;
         EXPECT_TRUE(rg_struct_map_count(struct_map) == count);
-        EXPECT_TRUE(struct_map->storage.count == struct_map->hash_map.count);
-        EXPECT_TRUE(struct_map->storage.count == count);
+        EXPECT_TRUE(struct_map->values.count == struct_map->hash_map.count);
+        EXPECT_TRUE(struct_map->values.count == count);
 
         // Get the last element
         rg_test_struct_map_data *new_last_data_in_map = rg_struct_map_get(struct_map, count + 1);
@@ -290,4 +321,220 @@ TEST(StructMap_Stress)
     // Cleanup
     rg_destroy_struct_map(&struct_map);
     EXPECT_NULL(struct_map);
-}
\ No newline at end of file
+}
+
+TEST(StructMap_WideKeys)
+{
+    rg_struct_map *struct_map = rg_create_struct_map(sizeof(rg_test_struct_map_data));
+    ASSERT_NOT_NULL(struct_map);
+
+    // Struct maps use a compact hash map by default
+    rg_test_struct_map_data data = {.number = 1};
+    EXPECT_NOT_NULL(rg_struct_map_set(struct_map, 1, &data));
+    EXPECT_TRUE(struct_map->hash_map.compact);
+
+    // But keys like pointers can still be used
+    data.number = 2;
+    EXPECT_NOT_NULL(rg_struct_map_set(struct_map, 0xFFFF00001234ULL, &data));
+    EXPECT_FALSE(struct_map->hash_map.compact);
+
+    rg_test_struct_map_data *value = rg_struct_map_get(struct_map, 1);
+    ASSERT_NOT_NULL(value);
+    EXPECT_TRUE(value->number == 1);
+    value = rg_struct_map_get(struct_map, 0xFFFF00001234ULL);
+    ASSERT_NOT_NULL(value);
+    EXPECT_TRUE(value->number == 2);
+
+    rg_struct_map_erase(struct_map, 1);
+    EXPECT_TRUE(rg_struct_map_count(struct_map) == 1);
+    EXPECT_TRUE(rg_struct_map_exists(struct_map, 0xFFFF00001234ULL));
+
+    rg_destroy_struct_map(&struct_map);
+    EXPECT_NULL(struct_map);
+}
+
+TEST(StructMap_Reserve)
+{
+    rg_struct_map *struct_map = rg_create_struct_map(sizeof(rg_test_struct_map_data));
+    ASSERT_NOT_NULL(struct_map);
+
+    // After a reservation, filling the map should not need any reallocation
+    EXPECT_TRUE(rg_struct_map_reserve(struct_map, 1000));
+    size_t hash_map_capacity = struct_map->hash_map.capacity;
+    void  *values_data       = struct_map->values.data;
+    void  *keys_data         = struct_map->keys.data;
+    EXPECT_TRUE(struct_map->values.capacity >= 1000);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        rg_test_struct_map_data data = {.number = i, .pos = {i, 0, 0}};
+        EXPECT_NOT_NULL(rg_struct_map_set(struct_map, i + 1, &data));
+    }
+    EXPECT_TRUE(struct_map->hash_map.capacity == hash_map_capacity);
+    EXPECT_TRUE(struct_map->values.data == values_data);
+    EXPECT_TRUE(struct_map->keys.data == keys_data);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        rg_test_struct_map_data *data = rg_struct_map_get(struct_map, i + 1);
+        ASSERT_NOT_NULL(data);
+        EXPECT_TRUE(data->number == i);
+    }
+
+    rg_destroy_struct_map(&struct_map);
+    EXPECT_NULL(struct_map);
+}
+
+TEST(StructMap_Aligned)
+{
+    // 12-byte values padded to 16 bytes
+    rg_struct_map *struct_map = rg_create_struct_map_aligned(12, 16, NULL);
+    ASSERT_NOT_NULL(struct_map);
+    EXPECT_TRUE(struct_map->values.element_size == 16);
+
+    char data[12] = "abcdefghijk";
+    for (uint64_t i = 1; i <= 100; i++)
+    {
+        data[0]     = (char) i;
+        char *value = rg_struct_map_set(struct_map, i * 3, data);
+        ASSERT_NOT_NULL(value);
+        EXPECT_TRUE((uintptr_t) value % 16 == 0);
+    }
+    for (uint64_t i = 1; i <= 100; i += 2)
+    {
+        rg_struct_map_erase(struct_map, i * 3);
+    }
+
+    // The keys follow the values when they are moved
+    size_t           iterated_count = 0;
+    rg_struct_map_it it             = rg_struct_map_iterator(struct_map);
+    while (rg_struct_map_next(&it))
+    {
+        EXPECT_TRUE((uintptr_t) it.value % 16 == 0);
+        EXPECT_TRUE(*(char *) it.value == (char) (it.key / 3));
+        EXPECT_TRUE(memcmp((char *) it.value + 1, data + 1, 11) == 0);
+        EXPECT_TRUE(rg_struct_map_get(struct_map, it.key) == it.value);
+        iterated_count++;
+    }
+    EXPECT_TRUE(iterated_count == 50);
+    rg_destroy_struct_map(&struct_map);
+
+    // Values aligned on cache lines, in both storages
+    const size_t cache_line_size      = sizeof(rg_test_struct_map_cache_line);
+    const size_t cache_line_alignment = _Alignof(rg_test_struct_map_cache_line);
+    for (int paged = 0; paged < 2; paged++)
+    {
+        struct_map = paged ? rg_create_struct_map_paged(cache_line_size, cache_line_alignment, NULL)
+                           : rg_create_struct_map_aligned(cache_line_size, cache_line_alignment, NULL);
+        ASSERT_NOT_NULL(struct_map);
+
+        rg_test_struct_map_cache_line line = {.name = "cache line"};
+        for (uint64_t i = 1; i <= 200; i++)
+        {
+            line.counter                         = i;
+            rg_test_struct_map_cache_line *value = rg_struct_map_set(struct_map, i, &line);
+            ASSERT_NOT_NULL(value);
+            EXPECT_TRUE((uintptr_t) value % RG_CACHE_LINE_SIZE == 0);
+        }
+        for (uint64_t i = 1; i <= 200; i += 2)
+        {
+            rg_struct_map_erase(struct_map, i);
+        }
+
+        iterated_count = 0;
+        it             = rg_struct_map_iterator(struct_map);
+        while (rg_struct_map_next(&it))
+        {
+            rg_test_struct_map_cache_line *value = it.value;
+            EXPECT_TRUE((uintptr_t) value % RG_CACHE_LINE_SIZE == 0);
+            EXPECT_TRUE(value->counter == it.key && strcmp(value->name, "cache line") == 0);
+            iterated_count++;
+        }
+        EXPECT_TRUE(iterated_count == 100);
+        EXPECT_TRUE(rg_struct_map_shrink_to_fit(struct_map));
+        EXPECT_TRUE((uintptr_t) rg_struct_map_get(struct_map, 2) % RG_CACHE_LINE_SIZE == 0);
+        rg_destroy_struct_map(&struct_map);
+    }
+
+    // Unsupported alignments: not a power of 2, or bigger than the fundamental one with an allocator that can't guarantee it
+    EXPECT_NULL(rg_create_struct_map_aligned(12, 3, NULL));
+    rg_test_counting_allocator counter   = {0};
+    rg_allocator               allocator = {
+        .pfn_alloc   = rg_test_counting_alloc,
+        .pfn_realloc = rg_test_counting_realloc,
+        .pfn_free    = rg_test_counting_free,
+        .context     = &counter,
+    };
+    rg_hash_map_create_info create_info = {.compact = true, .allocator = &allocator};
+    EXPECT_NULL(rg_create_struct_map_aligned(cache_line_size, cache_line_alignment, &create_info));
+    EXPECT_NULL(rg_create_struct_map_paged(cache_line_size, cache_line_alignment, &create_info));
+    EXPECT_TRUE(counter.total_count == 0);
+}
+
+TEST(StructMap_Paged)
+{
+    rg_struct_map *struct_map = rg_create_struct_map_paged(sizeof(rg_test_struct_map_data), 8, NULL);
+    ASSERT_NOT_NULL(struct_map);
+    EXPECT_NULL(rg_struct_map_values(struct_map, NULL));
+
+    // Keep the pointers given by the insertions
+    rg_test_struct_map_data *pointers[1000];
+    for (int i = 0; i < 1000; i++)
+    {
+        rg_test_struct_map_data data = {.number = i, .pos = {(double) i, 0, 0}};
+        pointers[i]                  = rg_struct_map_set(struct_map, (rg_hash_map_key_t) i + 1, &data);
+        ASSERT_NOT_NULL(pointers[i]);
+    }
+
+    // Erase half of the values and insert new ones in the holes
+    for (int i = 0; i < 1000; i += 2)
+    {
+        rg_struct_map_erase(struct_map, (rg_hash_map_key_t) i + 1);
+    }
+    for (int i = 0; i < 500; i++)
+    {
+        rg_test_struct_map_data data = {.number = 5000 + i};
+        ASSERT_NOT_NULL(rg_struct_map_set(struct_map, 5000 + (rg_hash_map_key_t) i, &data));
+    }
+    EXPECT_TRUE(rg_struct_map_count(struct_map) == 1000);
+
+    // The remaining values didn't move
+    for (int i = 1; i < 1000; i += 2)
+    {
+        EXPECT_TRUE(rg_struct_map_get(struct_map, (rg_hash_map_key_t) i + 1) == pointers[i]);
+        EXPECT_TRUE(pointers[i]->number == i && pointers[i]->pos[0] == (double) i);
+    }
+
+    // The iteration skips the holes
+    size_t           iterated_count = 0;
+    rg_struct_map_it it             = rg_struct_map_iterator(struct_map);
+    while (rg_struct_map_next(&it))
+    {
+        rg_test_struct_map_data *value = it.value;
+        EXPECT_TRUE(rg_struct_map_get(struct_map, it.key) == value);
+        EXPECT_TRUE(value->number == (int) (it.key >= 5000 ? it.key : it.key - 1));
+        iterated_count++;
+    }
+    EXPECT_TRUE(iterated_count == 1000);
+
+    // Erasing everything but the first value leaves only the first page
+    for (int i = 1; i < 1000; i += 2)
+    {
+        rg_struct_map_erase(struct_map, (rg_hash_map_key_t) i + 1);
+    }
+    for (int i = 1; i < 500; i++)
+    {
+        rg_struct_map_erase(struct_map, 5000 + (rg_hash_map_key_t) i);
+    }
+    EXPECT_TRUE(rg_struct_map_count(struct_map) == 1);
+    EXPECT_TRUE(rg_struct_map_shrink_to_fit(struct_map));
+    rg_test_struct_map_data *last = rg_struct_map_get(struct_map, 5000);
+    ASSERT_NOT_NULL(last);
+    EXPECT_TRUE(last->number == 5000);
+
+    it = rg_struct_map_iterator(struct_map);
+    EXPECT_TRUE(rg_struct_map_next(&it) && it.key == 5000 && it.value == last);
+    EXPECT_FALSE(rg_struct_map_next(&it));
+
+    rg_destroy_struct_map(&struct_map);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "../framework/test_framework.h"
+#include <railguard/utils/memory.h>
+#include <railguard/utils/threads.h>
+
+#define RG_TEST_THREAD_POOL_TASK_COUNT 1000
+
+// Each task writes its own result, so that no synchronization is needed
+void rg_test_thread_pool_task(size_t task_index, uint64_t *results)
+{
+    results[task_index] += task_index * task_index;
+}
+
+// Each task allocates, grows and frees its own buffer, so that the memory watcher is used by several threads at once
+void rg_test_thread_pool_allocating_task(size_t task_index, uint64_t *results)
+{
+    size_t    count  = task_index % 16 + 1;
+    uint64_t *buffer = rg_malloc(count * sizeof(uint64_t));
+    if (buffer == NULL)
+    {
+        return;
+    }
+    uint64_t *grown_buffer = rg_realloc(buffer, 2 * count * sizeof(uint64_t));
+    if (grown_buffer == NULL)
+    {
+        rg_free(buffer);
+        return;
+    }
+    for (size_t i = 0; i < 2 * count; i++)
+    {
+        grown_buffer[i] = task_index;
+    }
+    results[task_index] += grown_buffer[2 * count - 1];
+    rg_free(grown_buffer);
+}
+
+TEST(ThreadPool)
+{
+    rg_thread_pool *pool = rg_create_thread_pool(4);
+    ASSERT_NOT_NULL(pool);
+    EXPECT_TRUE(rg_thread_pool_thread_count(pool) == 5);
+
+    // Run several jobs in a row, every task must run exactly once in each of them
+    uint64_t results[RG_TEST_THREAD_POOL_TASK_COUNT] = {0};
+    for (int job = 0; job < 20; job++)
+    {
+        rg_thread_pool_run(pool,
+                           RG_TEST_THREAD_POOL_TASK_COUNT,
+                           (rg_thread_pool_task_function) rg_test_thread_pool_task,
+                           results);
+    }
+    for (uint64_t i = 0; i < RG_TEST_THREAD_POOL_TASK_COUNT; i++)
+    {
+        EXPECT_TRUE(results[i] == 20 * i * i);
+    }
+    rg_destroy_thread_pool(&pool);
+    EXPECT_NULL(pool);
+
+    // Without a pool, the tasks run on the calling thread
+    rg_thread_pool_run(NULL, RG_TEST_THREAD_POOL_TASK_COUNT, (rg_thread_pool_task_function) rg_test_thread_pool_task, results);
+    EXPECT_TRUE(results[3] == 21 * 9);
+    EXPECT_TRUE(rg_thread_pool_thread_count(NULL) == 1);
+
+    // A pool with a worker for each processor
+    pool = rg_create_thread_pool(0);
+    ASSERT_NOT_NULL(pool);
+    EXPECT_TRUE(rg_thread_pool_thread_count(pool) >= 2);
+    rg_destroy_thread_pool(&pool);
+}
+
+TEST(ThreadPool_Allocations)
+{
+    rg_thread_pool *pool = rg_create_thread_pool(4);
+    ASSERT_NOT_NULL(pool);
+
+    // With MEMORY_CHECKS, the watcher would report leaks or crash if the tasks raced on its maps
+    uint64_t results[RG_TEST_THREAD_POOL_TASK_COUNT] = {0};
+    for (int job = 0; job < 20; job++)
+    {
+        rg_thread_pool_run(pool,
+                           RG_TEST_THREAD_POOL_TASK_COUNT,
+                           (rg_thread_pool_task_function) rg_test_thread_pool_allocating_task,
+                           results);
+    }
+    for (uint64_t i = 0; i < RG_TEST_THREAD_POOL_TASK_COUNT; i++)
+    {
+        EXPECT_TRUE(results[i] == 20 * i);
+    }
+    rg_destroy_thread_pool(&pool);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../framework/test_framework.h"
+#include "test_allocator.h"
 #include <railguard/utils/arrays.h>
 
 TEST(Vector)
@@ -33,32 +34,27 @@ TEST(Vector)
     EXPECT_TRUE(vec.count == 4);
     EXPECT_FALSE(rg_vector_is_empty(&vec));
 
-    // This one should resize the vector by 1
+    // This one should double the capacity
     uint32_t *res = rg_vector_push_back(&vec, &values[4]);
     EXPECT_NOT_NULL(res);
     EXPECT_TRUE(*res == values[4]);
-    EXPECT_TRUE(vec.capacity == 5);
+    EXPECT_TRUE(vec.capacity == 8);
     EXPECT_TRUE(vec.count == 5);
+    EXPECT_TRUE(vec.realloc_count == 1);
 
-    // This one by 2
-    res = rg_vector_push_back(&vec, &values[5]);
-    EXPECT_NOT_NULL(res);
-    EXPECT_TRUE(*res == values[5]);
-    EXPECT_TRUE(vec.capacity == 7);
-    EXPECT_TRUE(vec.count == 6);
-
-    // These 2 by 4
-    for (uint32_t i = 6; i < 8; i++)
+    // These ones fit in the new capacity
+    for (uint32_t i = 5; i < 8; i++)
     {
         res = rg_vector_push_back(&vec, &values[i]);
         EXPECT_NOT_NULL(res);
         EXPECT_TRUE(*res == values[i]);
         EXPECT_TRUE(vec.count == i + 1);
     }
-    EXPECT_TRUE(vec.capacity == 11);
+    EXPECT_TRUE(vec.capacity == 8);
     EXPECT_TRUE(vec.count == 8);
+    EXPECT_TRUE(vec.realloc_count == 1);
 
-    // These 4 by 8
+    // These 4 double it again
     for (uint32_t i = 8; i < 12; i++)
     {
         res = rg_vector_push_back(&vec, &values[i]);
@@ -66,10 +62,10 @@ TEST(Vector)
         EXPECT_TRUE(*res == values[i]);
         EXPECT_TRUE(vec.count == i + 1);
     }
-    EXPECT_TRUE(vec.capacity == 19);
+    EXPECT_TRUE(vec.capacity == 16);
     EXPECT_TRUE(vec.count == 12);
 
-    // These 8 by 16
+    // These 8 as well
     for (uint32_t i = 12; i < 20; i++)
     {
         res = rg_vector_push_back(&vec, &values[i]);
@@ -77,7 +73,7 @@ TEST(Vector)
         EXPECT_TRUE(*res == values[i]);
         EXPECT_TRUE(vec.count == i + 1);
     }
-    EXPECT_TRUE(vec.capacity == 35);
+    EXPECT_TRUE(vec.capacity == 32);
     EXPECT_TRUE(vec.count == 20);
 
     // And so on until the end of our value array
@@ -88,8 +84,9 @@ TEST(Vector)
         EXPECT_TRUE(*res == values[i]);
         EXPECT_TRUE(vec.count == i + 1);
     }
-    EXPECT_TRUE(vec.capacity == 67);
+    EXPECT_TRUE(vec.capacity == 64);
     EXPECT_TRUE(vec.count == VALUE_COUNT);
+    EXPECT_TRUE(vec.realloc_count == 4);
 
     // Test iterator
     rg_vector_it it = rg_vector_iterator(&vec);
@@ -137,8 +134,8 @@ TEST(Vector)
 
     // Check pop_back
     rg_vector_pop_back(&vec);
-    EXPECT_TRUE(vec.count = VALUE_COUNT);
-    EXPECT_TRUE(vec.capacity = 67);
+    EXPECT_TRUE(vec.count == VALUE_COUNT);
+    EXPECT_TRUE(vec.capacity == 64);
 
     // Check set
     uint32_t value = 873287343;
@@ -162,7 +159,7 @@ TEST(Vector)
     void *old_data = vec.data;
     rg_vector_clear(&vec);
     EXPECT_TRUE(vec.count == 0);
-    EXPECT_TRUE(vec.capacity == 67);
+    EXPECT_TRUE(vec.capacity == 64);
     EXPECT_TRUE(vec.data == old_data);
     EXPECT_TRUE(vec.element_size == sizeof(uint32_t));
 
@@ -173,9 +170,416 @@ TEST(Vector)
     EXPECT_TRUE(*(uint32_t *) vec.data == 789678);
     EXPECT_TRUE(vec.count == 1);
 
+    // Shrink it, the remaining element is kept
+    EXPECT_TRUE(rg_vector_shrink_to_fit(&vec));
+    EXPECT_TRUE(vec.capacity == 1);
+    EXPECT_TRUE(vec.count == 1);
+    EXPECT_TRUE(*(uint32_t *) vec.data == 789678);
+
+    // It can still grow after that
+    value = 42;
+    EXPECT_NOT_NULL(rg_vector_push_back(&vec, &value));
+    EXPECT_TRUE(vec.count == 2);
+    EXPECT_TRUE(vec.capacity >= 2);
+    EXPECT_TRUE(*((uint32_t *) vec.data + 1) == 42);
+
+    // Reserve allocates exactly what is asked, and nothing if there is already enough room
+    EXPECT_TRUE(rg_vector_reserve(&vec, 100));
+    EXPECT_TRUE(vec.capacity == 100);
+    size_t realloc_count = vec.realloc_count;
+    EXPECT_TRUE(rg_vector_reserve(&vec, 50));
+    EXPECT_TRUE(vec.capacity == 100);
+    EXPECT_TRUE(vec.realloc_count == realloc_count);
+    EXPECT_TRUE(*((uint32_t *) vec.data + 1) == 42);
+
+    // A custom growth factor is applied, within its bounds
+    rg_vector_set_growth_factor(&vec, 1.5f);
+    EXPECT_TRUE(rg_vector_ensure_capacity(&vec, 101));
+    EXPECT_TRUE(vec.capacity == 150);
+    rg_vector_set_growth_factor(&vec, 100.0f);
+    EXPECT_TRUE(vec.growth_factor == RG_VECTOR_MAX_GROWTH_FACTOR);
+
+    // Extensions grow geometrically as well
+    rg_vector_set_growth_factor(&vec, 2.0f);
+    vec.count = vec.capacity;
+    EXPECT_NOT_NULL(rg_vector_extend(&vec, values, VALUE_COUNT));
+    EXPECT_TRUE(vec.capacity == 300);
+    EXPECT_TRUE(vec.count == 150 + VALUE_COUNT);
+    EXPECT_TRUE(*((uint32_t *) vec.data + 150) == values[0]);
+
     // Destruction
     rg_destroy_vector(&vec);
     EXPECT_NULL(vec.data);
     EXPECT_TRUE(vec.count == 0);
     EXPECT_TRUE(vec.capacity == 0);
-}
\ No newline at end of file
+}
+typedef struct rg_test_small_vector_owner
+{
+    uint32_t owner_id;
+    RG_SMALL_VECTOR(uint32_t, 4) ids;
+} rg_test_small_vector_owner;
+
+TEST(SmallVector)
+{
+    // The owner keeps the first elements inline
+    rg_test_small_vector_owner owner = {.owner_id = 7};
+    RG_SMALL_VECTOR_CREATE(owner.ids);
+    rg_small_vector *vec = &owner.ids.vector;
+    EXPECT_TRUE(vec->count == 0);
+    EXPECT_TRUE(vec->capacity == 4);
+    EXPECT_TRUE(vec->element_size == sizeof(uint32_t));
+    EXPECT_TRUE(rg_small_vector_data(vec) == owner.ids.inline_elements);
+
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        uint32_t *res = rg_small_vector_push_back(vec, &i);
+        EXPECT_NOT_NULL(res);
+        EXPECT_TRUE(*res == i);
+    }
+    EXPECT_NULL(vec->heap_data);
+    EXPECT_TRUE(owner.ids.inline_elements[3] == 3);
+
+    // A copy of the owner has its own inline elements
+    rg_test_small_vector_owner moved = owner;
+    EXPECT_TRUE(rg_small_vector_data(&moved.ids.vector) == moved.ids.inline_elements);
+    EXPECT_TRUE(*(uint32_t *) rg_small_vector_get_element(&moved.ids.vector, 2) == 2);
+
+    // The fifth one spills to the heap, and the elements follow
+    uint32_t value = 4;
+    EXPECT_NOT_NULL(rg_small_vector_push_back(vec, &value));
+    EXPECT_NOT_NULL(vec->heap_data);
+    EXPECT_TRUE(vec->capacity >= 5);
+    uint32_t values[20] = {0};
+    for (uint32_t i = 0; i < 20; i++)
+    {
+        values[i] = 5 + i;
+    }
+    EXPECT_NOT_NULL(rg_small_vector_extend(vec, values, 20));
+    EXPECT_TRUE(vec->count == 25);
+
+    size_t             i  = 0;
+    rg_small_vector_it it = rg_small_vector_iterator(vec);
+    while (rg_small_vector_next(&it))
+    {
+        EXPECT_TRUE(it.index == i);
+        EXPECT_TRUE(*(uint32_t *) it.value == i);
+        i++;
+    }
+    EXPECT_TRUE(i == 25);
+    EXPECT_NULL(rg_small_vector_get_element(vec, 25));
+
+    // Find and swap-remove the first element
+    uint32_t first = 0;
+    EXPECT_TRUE(rg_small_vector_find(vec, &first) == 0);
+    EXPECT_TRUE(rg_small_vector_swap_remove(vec, 0));
+    EXPECT_TRUE(vec->count == 24);
+    EXPECT_TRUE(*(uint32_t *) rg_small_vector_get_element(vec, 0) == 24);
+    EXPECT_TRUE(rg_small_vector_find(vec, &first) == SIZE_MAX);
+    EXPECT_FALSE(rg_small_vector_swap_remove(vec, SIZE_MAX));
+
+    // Copy an element
+    EXPECT_TRUE(rg_small_vector_copy(vec, 1, 0));
+    EXPECT_TRUE(*(uint32_t *) rg_small_vector_get_element(vec, 0) == 1);
+
+    // Destroying it frees the heap, and it goes back to the inline storage
+    rg_destroy_small_vector(vec);
+    EXPECT_NULL(vec->heap_data);
+    EXPECT_TRUE(vec->count == 0);
+    EXPECT_TRUE(vec->capacity == 4);
+    EXPECT_NOT_NULL(rg_small_vector_push_back(vec, &value));
+    EXPECT_TRUE(owner.ids.inline_elements[0] == 4);
+    EXPECT_TRUE(owner.owner_id == 7);
+    rg_destroy_small_vector(vec);
+}
+
+TEST(SmallVector_Allocator)
+{
+    rg_test_counting_allocator counter   = {0};
+    rg_allocator               allocator = {
+        .pfn_alloc   = rg_test_counting_alloc,
+        .pfn_realloc = rg_test_counting_realloc,
+        .pfn_free    = rg_test_counting_free,
+        .context     = &counter,
+    };
+    rg_test_small_vector_owner owner = {0};
+    RG_SMALL_VECTOR_CREATE_WITH_ALLOCATOR(owner.ids, &allocator);
+    rg_small_vector *vec = &owner.ids.vector;
+    EXPECT_TRUE(vec->allocator == &allocator);
+
+    // Nothing is allocated while the elements fit inline
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        EXPECT_NOT_NULL(rg_small_vector_push_back(vec, &i));
+    }
+    EXPECT_TRUE(counter.total_count == 0);
+
+    // The heap storage comes from the allocator, including its reallocations
+    for (uint32_t i = 4; i < 100; i++)
+    {
+        EXPECT_NOT_NULL(rg_small_vector_push_back(vec, &i));
+    }
+    EXPECT_TRUE(counter.live_count == 1);
+    EXPECT_TRUE(counter.total_count > 1);
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        EXPECT_TRUE(*(uint32_t *) rg_small_vector_get_element(vec, i) == i);
+    }
+
+    rg_destroy_small_vector(vec);
+    EXPECT_TRUE(counter.live_count == 0);
+    EXPECT_TRUE(vec->allocator == &allocator);
+}
+
+static void rg_test_vector_move_place(size_t from, size_t to, void *user_data)
+{
+    uint32_t *values = user_data;
+    values[to]       = values[from];
+}
+
+TEST(Array_Allocator)
+{
+    rg_test_counting_allocator counter   = {0};
+    rg_allocator               allocator = {
+        .pfn_alloc   = rg_test_counting_alloc,
+        .pfn_realloc = rg_test_counting_realloc,
+        .pfn_free    = rg_test_counting_free,
+        .context     = &counter,
+    };
+
+    // Zeroed arrays
+    rg_array array = rg_create_array_zeroed_with_allocator(1000, sizeof(uint32_t), &allocator);
+    ASSERT_NOT_NULL(array.data);
+    EXPECT_TRUE(counter.live_count == 1);
+    uint32_t *values = array.data;
+    bool      zeroed = true;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        zeroed &= values[i] == 0;
+        values[i] = i;
+    }
+    EXPECT_TRUE(zeroed);
+
+    // The bitmap of a large compaction comes from the allocator, and is given back to it
+    size_t places[500];
+    for (size_t i = 0; i < 500; i++)
+    {
+        places[i] = i * 2;
+    }
+    size_t total_count = counter.total_count;
+    EXPECT_TRUE(rg_compact_places(1000, places, 500, rg_test_vector_move_place, values, &allocator) == 500);
+    EXPECT_TRUE(counter.total_count == total_count + 1);
+    EXPECT_TRUE(counter.live_count == 1);
+    bool compacted = true;
+    for (uint32_t i = 0; i < 500; i++)
+    {
+        compacted &= values[i] % 2 == 1;
+    }
+    EXPECT_TRUE(compacted);
+
+    rg_destroy_array(&array);
+    EXPECT_TRUE(counter.live_count == 0);
+}
+
+TEST(SlotTable)
+{
+    rg_test_counting_allocator counter   = {0};
+    rg_allocator               allocator = {
+        .pfn_alloc   = rg_test_counting_alloc,
+        .pfn_realloc = rg_test_counting_realloc,
+        .pfn_free    = rg_test_counting_free,
+        .context     = &counter,
+    };
+    rg_slot_table table = {0};
+    ASSERT_TRUE(rg_create_slot_table(&allocator, &table));
+
+    // The prepared id is the one given by the next acquisition, and it doesn't exist until then
+    uint32_t ids[100];
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        uint32_t prepared_id = rg_slot_table_prepare(&table);
+        EXPECT_TRUE(prepared_id != RG_SLOT_TABLE_NULL_ID);
+        EXPECT_TRUE(rg_slot_table_find(&table, prepared_id) == UINT32_MAX);
+        ids[i] = rg_slot_table_acquire(&table, i * 10);
+        EXPECT_TRUE(ids[i] == prepared_id);
+        EXPECT_TRUE(rg_slot_table_index(ids[i]) == i);
+    }
+    EXPECT_TRUE(rg_slot_table_find(&table, RG_SLOT_TABLE_NULL_ID) == UINT32_MAX);
+    rg_slot_table_set_value(&table, ids[5], 7);
+    EXPECT_TRUE(rg_slot_table_find(&table, ids[5]) == 7);
+    EXPECT_TRUE(rg_slot_table_find(&table, ids[6]) == 60);
+
+    // The released slots are reused first, with new ids
+    rg_slot_table_release(&table, ids[3]);
+    rg_slot_table_release(&table, ids[8]);
+    EXPECT_TRUE(rg_slot_table_find(&table, ids[3]) == UINT32_MAX);
+    uint32_t reused_id = rg_slot_table_acquire(&table, 1000);
+    EXPECT_TRUE(rg_slot_table_index(reused_id) == 8);
+    EXPECT_TRUE(reused_id != ids[8]);
+    EXPECT_TRUE(rg_slot_table_find(&table, ids[8]) == UINT32_MAX);
+    EXPECT_TRUE(rg_slot_table_find(&table, reused_id) == 1000);
+
+    // Even after the generation wraps, no id matches a free slot
+    uint32_t first_id = rg_slot_table_acquire(&table, 0);
+    EXPECT_TRUE(rg_slot_table_index(first_id) == 3);
+    uint32_t id = first_id;
+    for (uint32_t i = 0; i < 128; i++)
+    {
+        rg_slot_table_release(&table, id);
+        bool matched = false;
+        for (uint32_t generation = 0; generation < 256; generation++)
+        {
+            matched |= rg_slot_table_find(&table, (generation << RG_SLOT_TABLE_INDEX_BITS) | 3) != UINT32_MAX;
+        }
+        EXPECT_FALSE(matched);
+        id = rg_slot_table_acquire(&table, i);
+        EXPECT_TRUE(rg_slot_table_find(&table, id) == i);
+    }
+    EXPECT_TRUE(id == first_id);
+
+    rg_destroy_slot_table(&table);
+    EXPECT_TRUE(counter.live_count == 0);
+}
+
+TEST(Vector_Aligned)
+{
+    // The alignment is kept across the reallocations
+    rg_vector vec = {0};
+    ASSERT_TRUE(rg_create_vector_aligned(1, sizeof(uint32_t), RG_CACHE_LINE_SIZE, &vec));
+    EXPECT_TRUE((uintptr_t) vec.data % RG_CACHE_LINE_SIZE == 0);
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        EXPECT_NOT_NULL(rg_vector_push_back(&vec, &i));
+        EXPECT_TRUE((uintptr_t) vec.data % RG_CACHE_LINE_SIZE == 0);
+    }
+    EXPECT_TRUE(rg_vector_reserve(&vec, 5000));
+    EXPECT_TRUE((uintptr_t) vec.data % RG_CACHE_LINE_SIZE == 0);
+    EXPECT_TRUE(rg_vector_shrink_to_fit(&vec));
+    EXPECT_TRUE((uintptr_t) vec.data % RG_CACHE_LINE_SIZE == 0);
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        EXPECT_TRUE(((uint32_t *) vec.data)[i] == i);
+    }
+    rg_destroy_vector(&vec);
+    EXPECT_NULL(vec.data);
+
+    // The alignment must be a power of 2
+    EXPECT_FALSE(rg_create_vector_aligned(4, sizeof(uint32_t), 48, &vec));
+    EXPECT_NULL(rg_aligned_malloc(16, 0));
+
+    // Arrays
+    rg_array array = rg_create_array_aligned(100, sizeof(float), 32);
+    EXPECT_NOT_NULL(array.data);
+    EXPECT_TRUE(array.count == 100);
+    EXPECT_TRUE((uintptr_t) array.data % 32 == 0);
+    rg_destroy_array(&array);
+    EXPECT_NULL(array.data);
+
+    // Raw allocations, with an alignment bigger than the one of malloc
+    uint8_t *bytes = rg_aligned_malloc(10, 4096);
+    ASSERT_NOT_NULL(bytes);
+    EXPECT_TRUE((uintptr_t) bytes % 4096 == 0);
+    for (uint8_t i = 0; i < 10; i++)
+    {
+        bytes[i] = i;
+    }
+    bytes = rg_aligned_realloc(bytes, 100000, 4096);
+    ASSERT_NOT_NULL(bytes);
+    EXPECT_TRUE((uintptr_t) bytes % 4096 == 0);
+    for (uint8_t i = 0; i < 10; i++)
+    {
+        EXPECT_TRUE(bytes[i] == i);
+    }
+    rg_aligned_free(bytes);
+}
+
+TEST(Vector_Ranges)
+{
+    rg_vector vec = {0};
+    ASSERT_TRUE(rg_create_vector(2, sizeof(uint32_t), &vec));
+    uint32_t values[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    EXPECT_NOT_NULL(rg_vector_extend(&vec, values, 8));
+
+    // Insert in the middle: 0 1 2 10 11 12 3 4 5 6 7
+    uint32_t inserted[3] = {10, 11, 12};
+    uint32_t *res        = rg_vector_insert_range(&vec, 3, inserted, 3);
+    ASSERT_NOT_NULL(res);
+    EXPECT_TRUE(res == (uint32_t *) vec.data + 3);
+    EXPECT_TRUE(vec.count == 11);
+    uint32_t expected_insert[11] = {0, 1, 2, 10, 11, 12, 3, 4, 5, 6, 7};
+    EXPECT_TRUE(memcmp(vec.data, expected_insert, sizeof(expected_insert)) == 0);
+
+    // Insert at the end, and out of bounds
+    EXPECT_NOT_NULL(rg_vector_insert_range(&vec, vec.count, inserted, 1));
+    EXPECT_TRUE(((uint32_t *) vec.data)[11] == 10);
+    EXPECT_NULL(rg_vector_insert_range(&vec, vec.count + 1, inserted, 1));
+    EXPECT_TRUE(vec.count == 12);
+
+    // Erase a range, the order is kept: 0 1 5 6 7 10
+    EXPECT_TRUE(rg_vector_erase_range(&vec, 2, 6));
+    uint32_t expected_erase[6] = {0, 1, 5, 6, 7, 10};
+    EXPECT_TRUE(vec.count == 6);
+    EXPECT_TRUE(memcmp(vec.data, expected_erase, sizeof(expected_erase)) == 0);
+    EXPECT_FALSE(rg_vector_erase_range(&vec, 4, 3));
+    EXPECT_TRUE(vec.count == 6);
+
+    // Overlapping copy: 0 1 1 5 6 10
+    EXPECT_TRUE(rg_vector_copy_range(&vec, 1, 2, 3));
+    uint32_t expected_copy[6] = {0, 1, 1, 5, 6, 10};
+    EXPECT_TRUE(memcmp(vec.data, expected_copy, sizeof(expected_copy)) == 0);
+    EXPECT_FALSE(rg_vector_copy_range(&vec, 0, 4, 3));
+
+    // Find
+    uint32_t needle = 5;
+    EXPECT_TRUE(rg_vector_find(&vec, &needle) == 3);
+    needle = 1;
+    EXPECT_TRUE(rg_vector_find(&vec, &needle) == 1);
+    needle = 42;
+    EXPECT_TRUE(rg_vector_find(&vec, &needle) == SIZE_MAX);
+
+    // Swap remove: 0 10 1 5 6
+    EXPECT_TRUE(rg_vector_swap_remove(&vec, 1));
+    uint32_t expected_swap[5] = {0, 10, 1, 5, 6};
+    EXPECT_TRUE(vec.count == 5);
+    EXPECT_TRUE(memcmp(vec.data, expected_swap, sizeof(expected_swap)) == 0);
+    EXPECT_TRUE(rg_vector_swap_remove(&vec, 4));
+    EXPECT_TRUE(vec.count == 4);
+    EXPECT_FALSE(rg_vector_swap_remove(&vec, 4));
+
+    // Resize: the new elements are zeroed
+    EXPECT_TRUE(rg_vector_resize(&vec, 100));
+    EXPECT_TRUE(vec.count == 100);
+    EXPECT_TRUE(((uint32_t *) vec.data)[3] == 5);
+    for (size_t i = 4; i < 100; i++)
+    {
+        EXPECT_TRUE(((uint32_t *) vec.data)[i] == 0);
+    }
+    EXPECT_TRUE(rg_vector_resize(&vec, 2));
+    EXPECT_TRUE(vec.count == 2);
+
+    // Find in a long vector, to go through the SIMD path and the tail
+    rg_vector_clear(&vec);
+    for (uint32_t i = 0; i < 103; i++)
+    {
+        rg_vector_push_back(&vec, &i);
+    }
+    for (uint32_t i = 0; i < 103; i++)
+    {
+        EXPECT_TRUE(rg_vector_find(&vec, &i) == i);
+    }
+    rg_destroy_vector(&vec);
+
+    // Other element sizes
+    rg_vector wide = {0};
+    ASSERT_TRUE(rg_create_vector(4, sizeof(uint64_t), &wide));
+    uint64_t wide_values[3] = {UINT64_MAX, 3, 1ULL << 40};
+    rg_vector_extend(&wide, wide_values, 3);
+    EXPECT_TRUE(rg_vector_find(&wide, &wide_values[2]) == 2);
+    rg_destroy_vector(&wide);
+
+    rg_vector bytes = {0};
+    ASSERT_TRUE(rg_create_vector(4, 3, &bytes));
+    rg_vector_extend(&bytes, "abcdefghi", 3);
+    EXPECT_TRUE(rg_vector_find(&bytes, "def") == 1);
+    EXPECT_TRUE(rg_vector_find(&bytes, "xyz") == SIZE_MAX);
+    rg_destroy_vector(&bytes);
+}